@@ -2,6 +2,10 @@
 #include "common/cli_wrapper.h"
 #include "tensors/cpu/expression_graph_packable.h"
 #include "onnx/expression_graph_onnx_exporter.h"
+#include "data/corpus_binary.h"
+#include "data/shortlist.h"
+#include "data/vocab.h"
+#include "layers/lsh.h"
 
 #include <sstream>
 
@@ -18,20 +22,62 @@ int main(int argc, char** argv) {
         "Convert a model in the .npz format and normal memory layout to a mmap-able binary model which could be in normal memory layout or packed memory layout",
         "Allowed options",
         "Examples:\n"
-        "  ./marian-conv -f model.npz -t model.bin --gemm-type packed16");
+        "  ./marian-conv -f model.npz -t model.bin --gemm-type packed16\n"
+        "  ./marian-conv -f model.npz -t model.bin --add-lsh 1024\n"
+        "  ./marian-conv --shortlist lex.s2t 100 100 0 -V vocab.src.spm vocab.trg.spm -t lex.s2t.bin\n"
+        "  ./marian-conv --corpus train.src train.trg -V vocab.src.spm vocab.trg.spm -t train.bin");
     cli->add<std::string>("--from,-f", "Input model", "model.npz");
     cli->add<std::string>("--to,-t", "Output model", "model.bin");
     cli->add<std::string>("--export-as", "Kind of conversion: marian-bin or onnx-{encode,decoder-step,decoder-init,decoder-stop}", "marian-bin");
     cli->add<std::string>("--gemm-type,-g", "GEMM Type to be used: float32, packed16, packed8avx2, packed8avx512, "
                           "intgemm8, intgemm8ssse3, intgemm8avx2, intgemm8avx512, intgemm16, intgemm16sse2, intgemm16avx2, intgemm16avx512", 
                           "float32");
-    cli->add<std::vector<std::string>>("--vocabs,-V", "Vocabulary file, required for ONNX export");
+    cli->add<std::vector<std::string>>("--vocabs,-V", "Vocabulary file, required for ONNX export and shortlist conversion (source and target)");
+    cli->add<int>("--add-lsh", "Store an LSH index with this many bits for the output embeddings in the converted model. "
+                  "Has to match the bits of --output-approx-knn when decoding", 0);
+    cli->add<std::vector<std::string>>("--shortlist", "Convert a text lexical shortlist instead of a model: path first best threshold. "
+                                       "Writes a pruned binary shortlist to --to that can be memory-mapped with --shortlist when decoding");
+    cli->add<std::vector<std::string>>("--corpus", "Encode parallel training files with --vocabs instead of converting a model. "
+                                       "Writes a binary corpus to --to for training with --binary-corpus");
     cli->parse(argc, argv);
     options->merge(config);
   }
   auto modelFrom = options->get<std::string>("from");
   auto modelTo = options->get<std::string>("to");
 
+  if(options->hasAndNotEmpty("shortlist")) {
+    auto vocabPaths = options->get<std::vector<std::string>>("vocabs");
+    ABORT_IF(vocabPaths.size() != 2, "Shortlist conversion requires a source and a target vocabulary with --vocabs");
+
+    auto srcVocab = New<Vocab>(options, 0);
+    srcVocab->load(vocabPaths[0]);
+    auto trgVocab = New<Vocab>(options, 1);
+    trgVocab->load(vocabPaths[1]);
+
+    // reads and prunes the text shortlist according to the --shortlist parameters
+    auto lexical = New<data::LexicalShortlistGenerator>(options, srcVocab, trgVocab);
+    lexical->saveBinary(modelTo);
+
+    LOG(info, "Finished");
+    return 0;
+  }
+
+  if(options->hasAndNotEmpty("corpus")) {
+    auto paths = options->get<std::vector<std::string>>("corpus");
+    auto vocabPaths = options->get<std::vector<std::string>>("vocabs");
+    ABORT_IF(vocabPaths.size() != paths.size(), "Corpus conversion requires one vocabulary per file with --vocabs");
+
+    std::vector<Ptr<Vocab>> vocabs;
+    for(size_t i = 0; i < vocabPaths.size(); ++i) {
+      vocabs.push_back(New<Vocab>(options, i));
+      vocabs.back()->load(vocabPaths[i]);
+    }
+    data::CorpusBinary::save(modelTo, paths, vocabs);
+
+    LOG(info, "Finished");
+    return 0;
+  }
+
   auto exportAs = options->get<std::string>("export-as");
   auto vocabPaths = options->get<std::vector<std::string>>("vocabs");// , std::vector<std::string>());
   
@@ -55,6 +101,19 @@ int main(int argc, char** argv) {
   if (exportAs == "marian-bin") {
     auto graph = New<ExpressionGraphPackable>();
     load(graph);
+
+    int lshBits = options->get<int>("add-lsh");
+    if(lshBits > 0) {
+      auto outputName = LSH::outputMatrixName(New<Options>(config));
+
+      auto W = graph->get(outputName);
+      ABORT_IF(!W, "Output matrix {} not found, cannot add LSH index", outputName);
+
+      graph->setReloaded(false); // allow adding a new parameter to a loaded graph
+      LSH::addIndex(graph, W, lshBits);
+      graph->forward(); // run the initializer of the index
+    }
+
     // added a flag if the weights needs to be packed or not
     graph->packAndSave(modelTo, configStr.str(), /* --gemm-type */ saveGemmType, Type::float32);
   }
@@ -1,5 +1,7 @@
 #include "marian.h"
 #include "translator/beam_search.h"
+#include "translator/greedy_search.h"
+#include "translator/speculative_search.h"
 #include "translator/translator.h"
 #include "common/timer.h"
 #include "common/utils.h"
@@ -13,12 +15,19 @@ int main(int argc, char **argv) {
 
   // Initialize translation task
   auto options = parseOptions(argc, argv, cli::mode::server, true);
-  auto task = New<TranslateService<BeamSearch>>(options);
+  Ptr<ModelServiceTask> task;
+  if(SpeculativeSearch::isEnabled(options))
+    task = New<TranslateService<SpeculativeSearch>>(options);
+  else if(options->get<size_t>("beam-size") == 1)
+    task = New<TranslateService<GreedySearch>>(options);
+  else
+    task = New<TranslateService<BeamSearch>>(options);
   auto quiet = options->get<bool>("quiet-translation");
 
   // Initialize web server
   WSServer server;
   server.config.port = (short)options->get<size_t>("port", 8080);
+  server.config.thread_pool_size = options->get<size_t>("server-threads", 8);
 
   auto &translate = server.endpoint["^/translate/?$"];
 
@@ -1,11 +1,21 @@
 #include "common/binary.h"
 #include "common/definitions.h"
 #include "common/file_stream.h"
+#include "common/filesystem.h"
+#include "common/io.h"
 #include "common/io_item.h"
 #include "common/types.h"
+#include "common/utils.h"
 #include "tensors/cpu/integer_common.h"
 
+#include "3rd_party/mio/mio.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 
 namespace marian {
 namespace io {
@@ -27,7 +37,7 @@ const T* get(const void*& current, size_t num = 1) {
   return ptr;
 }
 
-void loadItems(const void* current, std::vector<io::Item>& items, bool mapped) {
+void loadItemHeaders(const void* current, std::vector<io::Item>& items, std::vector<size_t>& dataLengths) {
   size_t binaryFileVersion = *get<size_t>(current);
   ABORT_IF(binaryFileVersion != BINARY_FILE_VERSION,
            "Binary file versions do not match: {} (file) != {} (expected)",
@@ -39,10 +49,12 @@ void loadItems(const void* current, std::vector<io::Item>& items, bool mapped) {
 
   // prepopulate items with meta data from headers
   items.resize(numHeaders);
+  dataLengths.resize(numHeaders);
   for(int i = 0; i < numHeaders; ++i) {
     items[i].type = (Type)headers[i].type;
     items[i].name = get<char>(current, headers[i].nameLength);
-    items[i].mapped = mapped;
+    items[i].mapped = true;
+    dataLengths[i] = headers[i].dataLength;
   }
 
   // read in actual shape and data
@@ -63,28 +75,145 @@ void loadItems(const void* current, std::vector<io::Item>& items, bool mapped) {
     if (items[i].type == Type::intgemm8avx512) {
       items[i].type = cpu::integer::getIntgemmType(Type::intgemm8);
     }
-    if(items[i].mapped) { // memory-mapped, hence only set pointer
-      // @TOOD: verify this actually works for the hardware-specific ones like intgemm8avx2
-      ABORT_IF(items[i].type == Type::intgemm8 || items[i].type == Type::intgemm16, "mmap format not supported for hardware non-specific intgemm matrices");
-      items[i].ptr = get<char>(current, headers[i].dataLength);
-    } else { // reading into item data
-      size_t len = headers[i].dataLength;
-      items[i].bytes.resize(len);
-      const char* ptr = get<char>(current, len);
-      // Intgemm8/16 matrices in binary model are just quantized, however they also need to be reordered
-      // Reordering depends on the architecture (SSE/AVX2/AVX512) so we read in the quantized matrices and
-      // then reorder them before adding them as a parameter in the graph.
-      if (matchType<intgemm8>(items[i].type)) {
-        items[i].type = cpu::integer::getIntgemmType(Type::intgemm8);
-        cpu::integer::prepareAndTransposeB<Type::intgemm8>(items[i], ptr);
-      } else if (matchType<intgemm16>(items[i].type)) {
-        items[i].type = cpu::integer::getIntgemmType(Type::intgemm16);
-        cpu::integer::prepareAndTransposeB<Type::intgemm16>(items[i], ptr);
-      } else {
-        std::copy(ptr, ptr + len, items[i].bytes.begin());
-      }
-    }
+    items[i].ptr = get<char>(current, headers[i].dataLength);
+  }
+}
+
+bool needsReordering(Type type) {
+  return type == Type::intgemm8 || type == Type::intgemm16;
+}
+
+Type materializedType(Type type) {
+  // Intgemm8/16 matrices in binary model are just quantized, however they also need to be reordered
+  // Reordering depends on the architecture (SSE/AVX2/AVX512)
+  return needsReordering(type) ? cpu::integer::getIntgemmType(type) : type;
+}
+
+void materializeItem(io::Item& item, size_t dataLength) {
+  const char* ptr = item.ptr;
+  item.bytes.resize(dataLength);
+  item.mapped = false;
+  item.ptr = nullptr;
+  // we read in the quantized matrices and then reorder them before adding them as a parameter in the graph.
+  if (matchType<intgemm8>(item.type)) {
+    item.type = cpu::integer::getIntgemmType(Type::intgemm8);
+    cpu::integer::prepareAndTransposeB<Type::intgemm8>(item, ptr);
+  } else if (matchType<intgemm16>(item.type)) {
+    item.type = cpu::integer::getIntgemmType(Type::intgemm16);
+    cpu::integer::prepareAndTransposeB<Type::intgemm16>(item, ptr);
+  } else {
+    std::copy(ptr, ptr + dataLength, item.bytes.begin());
+  }
+}
+
+void loadItems(const void* current, std::vector<io::Item>& items, bool mapped) {
+  std::vector<size_t> dataLengths;
+  loadItemHeaders(current, items, dataLengths);
+
+  for(int i = 0; i < items.size(); ++i) {
+    // Hardware non-specific intgemm matrices have to be reordered for this CPU, which cannot happen
+    // in place. Only these are read into memory, all other items of a mapped model stay mapped.
+    if(mapped && needsReordering(items[i].type))
+      LOG_ONCE(info, "[memory] Hardware non-specific intgemm matrices are reordered into private memory, "
+               "convert the model with a hardware-specific --gemm-type to share them");
+    if(!mapped || needsReordering(items[i].type))
+      materializeItem(items[i], dataLengths[i]);
+  }
+}
+
+const std::string REORDERED_KEY_NAME = "special:intgemm-reordered";
+
+static std::string type2str(Type type) {
+  std::stringstream str;
+  str << type;
+  return str.str();
+}
+
+// Identifies the model file by size, modification time and a hash of its item headers, and the
+// layouts its intgemm matrices are reordered to.
+static std::string reorderedKey(const std::string& fileName,
+                                const mio::mmap_source& model,
+                                const std::vector<io::Item>& items) {
+  size_t headerBytes = items.front().ptr - model.data();
+  std::set<std::string> layouts;
+  for(const auto& item : items)
+    if(needsReordering(item.type))
+      layouts.insert(type2str(materializedType(item.type)));
+
+  std::stringstream key;
+  key << filesystem::fileSize(fileName) << " "
+      << filesystem::Path(fileName).getImpl().mtime() << " "
+      << std::hash<std::string>()(std::string(model.data(), headerBytes));
+  for(const auto& layout : layouts)
+    key << " " << layout;
+  return key.str();
+}
+
+// Key stored in a reordered copy written by reorderedModel(), empty if there is none
+static std::string storedReorderedKey(const std::string& cacheName) {
+  if(!filesystem::exists(cacheName))
+    return "";
+  mio::mmap_source cache(cacheName);
+  std::vector<io::Item> items;
+  std::vector<size_t> dataLengths;
+  loadItemHeaders(cache.data(), items, dataLengths);
+  for(const auto& item : items)
+    if(item.name == REORDERED_KEY_NAME)
+      return std::string(item.ptr);
+  return "";
+}
+
+std::string reorderedModel(const std::string& fileName) {
+  mio::mmap_source model(fileName);
+  std::vector<io::Item> items;
+  std::vector<size_t> dataLengths;
+  loadItemHeaders(model.data(), items, dataLengths);
+
+  auto it = std::find_if(items.begin(), items.end(), [](const io::Item& item) { return needsReordering(item.type); });
+  if(it == items.end())
+    return fileName;
+
+  // e.g. model.intgemm8avx2.bin next to model.bin
+  std::string cacheName = fileName.substr(0, fileName.size() - 4) + "." + type2str(materializedType(it->type)) + ".bin";
+  std::string key = reorderedKey(fileName, model, items);
+  if(storedReorderedKey(cacheName) == key) {
+    LOG(info, "[memory] Using intgemm matrices of {} reordered for this CPU from {}", fileName, cacheName);
+    return cacheName;
+  }
+
+  // Written under a temporary name and renamed, so that other processes never see a partial file.
+  // The name is unique per host, process and thread because several of them may reorder the same
+  // model at once (e.g. workers on a shared file system), and it is in the directory of the cache
+  // so that rename() does not cross file systems.
+  auto hostAndPid = utils::hostnameAndProcessId();
+  std::string tmpName = cacheName + "." + hostAndPid.first + "." + std::to_string(hostAndPid.second) + "."
+                        + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+  if(!std::ofstream(tmpName)) {
+    LOG(warn, "[memory] Cannot write {}, intgemm matrices of {} are reordered at every start", cacheName, fileName);
+    return fileName;
+  }
+
+  LOG(info, "[memory] Reordering intgemm matrices of {} for this CPU into {}", fileName, cacheName);
+  std::vector<io::Item> reordered;
+  loadItems(model.data(), reordered, /*mapped=*/false);
+  io::addMetaToItems(key, REORDERED_KEY_NAME, reordered);
+  binary::saveItems(tmpName, reordered);
+
+  // rename() replaces a stale copy atomically on POSIX systems. It fails if the cache exists on
+  // Windows, where a stale copy is removed first, and if another process has just renamed its copy.
+  bool renamed = std::rename(tmpName.c_str(), cacheName.c_str()) == 0;
+#ifdef _WIN32
+  if(!renamed && storedReorderedKey(cacheName) != key) {
+    std::remove(cacheName.c_str());
+    renamed = std::rename(tmpName.c_str(), cacheName.c_str()) == 0;
+  }
+#endif
+  if(!renamed) {
+    std::remove(tmpName.c_str());
+    // lost the race against another process writing the same copy, which is as good as ours
+    ABORT_IF(storedReorderedKey(cacheName) != key, "Could not rename {} to {}", tmpName, cacheName);
   }
+  return cacheName;
 }
 
 void loadItems(const std::string& fileName, std::vector<io::Item>& items) {
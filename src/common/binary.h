@@ -15,8 +15,25 @@ namespace binary {
 void loadItems(const void* current,
                std::vector<io::Item>& items,
                bool mapped = false);
+
+// Reads only the headers of the items in the buffer at current. The items point into the buffer
+// like mapped items and can be turned into items that own their data with materializeItem().
+void loadItemHeaders(const void* current,
+                     std::vector<io::Item>& items,
+                     std::vector<size_t>& dataLengths);
+
+// Copies the data of an item from loadItemHeaders() into the item itself. Hardware non-specific
+// intgemm matrices are reordered for the current CPU, which changes the type to materializedType().
+void materializeItem(io::Item& item, size_t dataLength);
+Type materializedType(Type type);
 void loadItems(const std::string& fileName, std::vector<io::Item>& items);
 
+// Returns a copy of the .bin model fileName in which hardware non-specific intgemm matrices are
+// reordered for the current CPU, e.g. model.intgemm8avx2.bin, so that they can be loaded or mapped
+// as they are. The copy is written on first use and rewritten when the model changes. Returns
+// fileName if there is nothing to reorder or the copy cannot be written.
+std::string reorderedModel(const std::string& fileName);
+
 io::Item getItem(const void* current, const std::string& vName);
 io::Item getItem(const std::string& fileName, const std::string& vName);
 
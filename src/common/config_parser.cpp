@@ -159,6 +159,17 @@ void ConfigParser::addOptionsServer(cli::CLIWrapper& cli) {
   cli.add<size_t>("--port,-p",
       "Port number for web socket server",
       8080);
+  cli.add<size_t>("--server-threads",
+      "Number of threads handling web socket messages. Sentences from concurrent requests are "
+      "translated in shared batches of up to --mini-batch sentences",
+      8);
+  cli.add<size_t>("--cache-size",
+      "Memory budget in MB for a cache of translated sentences, which answers repeated sentences "
+      "without decoding them. 0 disables the cache",
+      0);
+  cli.add<size_t>("--cache-shards",
+      "Number of independently locked parts of the --cache-size cache",
+      16);
   cli.switchGroup(previous_group);
   // clang-format on
 }
@@ -353,6 +364,17 @@ void ConfigParser::addOptionsTraining(cli::CLIWrapper& cli) {
   cli.add<bool>("--overwrite",
       "Do not create model checkpoints, only overwrite main model file with last checkpoint. "
       "Reduces disk usage");
+  cli.add<bool>("--async-save",
+      "Write model checkpoints and optimizer state in a background thread, training only pauses "
+      "to copy them to host memory");
+  cli.add<size_t>("--async-save-memory",
+      "Maximum host memory in MB held by checkpoints waiting to be written with --async-save, "
+      "saving blocks when it is exceeded",
+      4096);
+  cli.add<size_t>("--overlap-communication",
+      "Reduce gradients across CPU threads in buckets of arg MB while the backward pass is still running. "
+      "0 reduces them after the backward pass",
+      0);
   cli.add<bool>("--no-reload",
       "Do not load existing model specified in --model arg");
   cli.add<std::vector<std::string>>("--train-sets,-t",
@@ -422,6 +444,9 @@ void ConfigParser::addOptionsTraining(cli::CLIWrapper& cli) {
     ->implicit_val("temporary");
   cli.add<bool>("--sqlite-drop",
       "Drop existing tables in sqlite3 database");
+  cli.add<std::string>("--binary-corpus",
+      "Read training sentences from this pre-encoded corpus created with marian-conv --corpus "
+      "instead of the text files of --train-sets, which are still used for vocabulary creation");
 
   addSuboptionsDevices(cli);
   addSuboptionsBatching(cli);
@@ -669,6 +694,40 @@ void ConfigParser::addOptionsTranslation(cli::CLIWrapper& cli) {
   addSuboptionsDevices(cli);
   addSuboptionsBatching(cli);
 
+  cli.add<std::vector<size_t>>("--cpu-affinity",
+      "Pin the decoding thread of each device to these CPU cores, cycling through the list (Linux only)");
+  cli.add<size_t>("--capture-steps",
+      "Record the tensor allocations of decoder steps for up to N distinct batch/beam/shortlist shapes "
+      "and replay them in later steps instead of going through the workspace allocator. Only "
+      "allocations are replayed, the graph of every step is still built and run",
+      0);
+  cli.add<std::string>("--tensor-allocator",
+      "Allocator for the tensors of a step: default (best-fit gaps in one workspace) "
+      "or size-classes (per-size free lists and a bump arena, constant-time allocate and free)",
+      "default");
+  cli.add<bool>("--model-mmap",
+      "Memory-map models in .bin format instead of loading them (CPU only). The read-only parameters "
+      "are shared by all CPU threads and, through the page cache, by all processes using the same file");
+  cli.add<bool>("--intgemm-cache",
+      "Write a copy of .bin models with intgemm matrices reordered for this CPU next to the model "
+      "(e.g. model.intgemm8avx2.bin) and use it on later starts instead of reordering them again");
+  cli.add<bool>("--parallel-ensemble",
+      "Evaluate the models of an ensemble concurrently, each in a graph and thread of its own (CPU only). "
+      "Needs one workspace per model");
+  cli.add<std::string>("--speculative-draft",
+      "Path to a small transformer model with the same target vocabulary that proposes words for "
+      "--beam-size 1, which the models given with --models verify several positions at a time. "
+      "Translations may differ from those without a draft in rare cases, when the scores of the best "
+      "words differ only by the rounding of multi-position and single-position matrix products");
+  cli.add<size_t>("--speculative-tokens",
+      "Number of words proposed by the --speculative-draft model per verification step",
+      4);
+  cli.add<bool>("--lazy-load",
+      "Load models in .bin format on demand: parameters are copied and converted (e.g. intgemm "
+      "reordering) on a background thread pool and the first batch only waits for those not done yet");
+  cli.add<bool>("--startup-report",
+      "Log the time spent in each start-up phase (vocabularies, shortlist, model loading, ...)");
+
   cli.add<bool>("--fp16",
       "Shortcut for mixed precision inference with float16, corresponds to: --precision float16");
   cli.add<std::vector<std::string>>("--precision",
@@ -678,7 +737,8 @@ void ConfigParser::addOptionsTranslation(cli::CLIWrapper& cli) {
     "Ignore model cost during translation, not recommended for beam-size > 1");
 
   cli.add<std::vector<std::string>>("--shortlist",
-     "Use softmax shortlist: path first best prune");
+     "Use softmax shortlist: path first best prune. "
+     "Binary shortlists created with marian-conv --shortlist are memory-mapped and need only the path");
   cli.add<std::vector<float>>("--weights",
       "Scorer weights");
   cli.add<bool>("--output-sampling",
@@ -821,6 +881,13 @@ void ConfigParser::addSuboptionsBatching(cli::CLIWrapper& cli) {
                defaultMiniBatch);
   cli.add<int>("--mini-batch-words",
       "Set mini-batch size based on words instead of sentences");
+  if(mode_ == cli::mode::translation) {
+    cli.add<size_t>("--mini-batch-tokens",
+      "Cut batches of sentences sorted by source length so that batch size x longest source sentence "
+      "stays within arg tokens. Batch sizes adapt to the length, use --mini-batch x --maxi-batch "
+      "to set how many sentences are sorted together. Maxi-batches are always sorted by source length, "
+      "--maxi-batch-sort is ignored");
+  }
 
   if(mode_ == cli::mode::training) {
     cli.add<bool>("--mini-batch-fit",
@@ -842,6 +909,15 @@ void ConfigParser::addSuboptionsBatching(cli::CLIWrapper& cli) {
   if(mode_ == cli::mode::training) {
     cli.add<bool>("--shuffle-in-ram",
         "Keep shuffled corpus in RAM, do not write to temp file");
+    cli.add<size_t>("--data-threads",
+        "Number of threads that encode sentences and assemble batches. Results do not depend on it",
+        1);
+    cli.add<bool>("--shuffle-index",
+        "Shuffle uncompressed training files through a line index (stored as <file>.lineidx) in "
+        "random blocks of lines instead of reading them completely and writing temp files");
+    cli.add<size_t>("--shuffle-buffer",
+        "Number of sentences shuffled in memory with --shuffle-index",
+        1000000);
     // @TODO: Consider making the next two options options of the vocab instead, to make it more local in scope.
     cli.add<size_t>("--all-caps-every",
         "When forming minibatches, preprocess every Nth line on the fly to all-caps. Assumes UTF-8");
@@ -5,6 +5,7 @@
 #include "common/types.h"
 
 #include "common/binary.h"
+#include "common/file_stream.h"
 #include "common/io_item.h"
 
 namespace marian {
@@ -148,7 +149,48 @@ void saveItemsNpz(const std::string& fileName, const std::vector<Item>& items) {
   cnpy::npz_save(fileName, npzItems);
 }
 
+static thread_local SaveItemsHook saveItemsHook;
+
+ScopedSaveItemsHook::ScopedSaveItemsHook(SaveItemsHook hook) : previous_(saveItemsHook) {
+  saveItemsHook = hook;
+}
+
+ScopedSaveItemsHook::~ScopedSaveItemsHook() {
+  saveItemsHook = previous_;
+}
+
+static thread_local SaveTextHook saveTextHook;
+
+ScopedSaveTextHook::ScopedSaveTextHook(SaveTextHook hook) : previous_(saveTextHook) {
+  saveTextHook = hook;
+}
+
+ScopedSaveTextHook::~ScopedSaveTextHook() {
+  saveTextHook = previous_;
+}
+
+void saveText(const std::string& fileName, const std::string& text) {
+  if(saveTextHook) {
+    saveTextHook(fileName, text);
+    return;
+  }
+  io::OutputFileStream out(fileName);
+  out << text;
+}
+
+void saveItems(const std::string& fileName, std::vector<Item>&& items) {
+  if(saveItemsHook)
+    saveItemsHook(fileName, std::move(items));
+  else
+    saveItems(fileName, (const std::vector<Item>&)items);
+}
+
 void saveItems(const std::string& fileName, const std::vector<Item>& items) {
+  if(saveItemsHook) {
+    saveItemsHook(fileName, std::vector<Item>(items));
+    return;
+  }
+
   if(isNpz(fileName)) {
     saveItemsNpz(fileName, items);
   } else if(isBin(fileName)) {
@@ -3,6 +3,7 @@
 #include "3rd_party/yaml-cpp/yaml.h"
 #include "common/io_item.h"
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -32,6 +33,36 @@ std::vector<Item> loadItems(const void* ptr);
 std::vector<Item> mmapItems(const void* ptr);
 
 void saveItems(const std::string& fileName, const std::vector<Item>& items);
+void saveItems(const std::string& fileName, std::vector<Item>&& items);
+
+// If set for the current thread, saveItems() hands the items to the hook instead of writing the file.
+typedef std::function<void(const std::string& fileName, std::vector<Item>&& items)> SaveItemsHook;
+
+// Redirects saveItems() of the current thread while in scope, e.g. to write checkpoints in the background.
+class ScopedSaveItemsHook {
+private:
+  SaveItemsHook previous_;
+
+public:
+  ScopedSaveItemsHook(SaveItemsHook hook);
+  ~ScopedSaveItemsHook();
+};
+
+// Writes a text file that belongs to a model, e.g. the decoder config, or hands it to the hook of the
+// current thread if one is set.
+void saveText(const std::string& fileName, const std::string& text);
+
+typedef std::function<void(const std::string& fileName, const std::string& text)> SaveTextHook;
+
+// Redirects saveText() of the current thread while in scope, see ScopedSaveItemsHook.
+class ScopedSaveTextHook {
+private:
+  SaveTextHook previous_;
+
+public:
+  ScopedSaveTextHook(SaveTextHook hook);
+  ~ScopedSaveTextHook();
+};
 
 }  // namespace io
 }  // namespace marian
@@ -6,13 +6,15 @@
 #include "data/rng_engine.h"
 #include "training/training_state.h"
 #include "data/iterator_facade.h"
+#include "common/timer.h"
 #include "3rd_party/threadpool.h"
 
+#include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <functional>
 #include <mutex>
-#include <queue>
+#include <numeric>
 
 namespace marian {
 namespace data {
@@ -90,44 +92,69 @@ private:
   mutable UPtr<ThreadPool> threadPool_; // (we only use one thread, but keep it around)
   std::future<std::deque<BatchPtr>> futureBufferedBatches_; // next swath of batches is returned via this
 
-  // this runs on a bg thread; sequencing is handled by caller, but locking is done in here
-  std::deque<BatchPtr> fetchBatches() {
-    typedef typename Sample::value_type Item;
-    auto itemCmp = [](const Item& sa, const Item& sb) { return sa.size() < sb.size(); }; // sort by element length, not content
-
-    auto cmpSrc = [itemCmp](const Sample& a, const Sample& b) {
-      return std::lexicographical_compare(
-          a.begin(), a.end(), b.begin(), b.end(), itemCmp);
-    };
+  // workers for batch materialization with --data-threads N > 1
+  UPtr<ThreadPool> workers_;
 
-    auto cmpTrg = [itemCmp](const Sample& a, const Sample& b) {
-      return std::lexicographical_compare(
-          a.rbegin(), a.rend(), b.rbegin(), b.rend(), itemCmp);
-    };
+  // source tokens and padded source positions (batch size x longest sentence) of all batches so far
+  std::atomic<size_t> sourceTokens_{0};
+  std::atomic<size_t> paddedTokens_{0};
 
-    auto cmpNone = [](const Sample& a, const Sample& b) { return a.getId() < b.getId(); }; // sort in order of original ids = original data order unless shuffling
+  // Stable counting sort of the positions in order by the length of the given stream, ascending
+  static void sortByLength(const Samples& samples, size_t stream, std::vector<size_t>& order) {
+    size_t maxLength = 0;
+    for(const auto& sample : samples)
+      maxLength = std::max(maxLength, sample[stream].size());
 
-    typedef std::function<bool(const Sample&, const Sample&)> cmp_type;
-    typedef std::priority_queue<Sample, Samples, cmp_type> sample_queue;
+    std::vector<size_t> starts(maxLength + 2, 0); // [length + 1] number of samples with this length
+    for(auto k : order)
+      starts[samples[k][stream].size() + 1]++;
+    std::partial_sum(starts.begin(), starts.end(), starts.begin());
 
-    std::unique_ptr<sample_queue> maxiBatch; // priority queue, shortest first
+    std::vector<size_t> sorted(order.size());
+    for(auto k : order)
+      sorted[starts[samples[k][stream].size()]++] = k;
+    order.swap(sorted);
+  }
 
-    if(options_->has("maxi-batch-sort")) {
-      if(options_->get<std::string>("maxi-batch-sort") == "src")
-        maxiBatch.reset(new sample_queue(cmpSrc));
-      else if(options_->get<std::string>("maxi-batch-sort") == "none")
-        maxiBatch.reset(new sample_queue(cmpNone));
-      else
-        maxiBatch.reset(new sample_queue(cmpTrg));
-    } else {
-      maxiBatch.reset(new sample_queue(cmpNone));
+  // Sorts samples ascending in the order selected by --maxi-batch-sort: by source lengths (src),
+  // target lengths (trg) or sentence ids (none). Lengths are compared stream by stream, starting
+  // from the first (src) or last (trg) stream, which is a radix sort with one counting sort per
+  // stream. Samples with equal lengths keep their reading order. The samples are moved into the result.
+  Samples sortSamples(Samples&& samples) const {
+    std::string sortBy = options_->has("maxi-batch-sort") ? options_->get<std::string>("maxi-batch-sort") : "none";
+    if(options_->get<size_t>("mini-batch-tokens", 0) > 0) // token budgets need batches of similar length
+      sortBy = "src";
+
+    std::vector<size_t> order(samples.size());
+    std::iota(order.begin(), order.end(), 0);
+    if(sortBy == "none") { // sort in order of original ids = original data order unless shuffling
+      std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return samples[a].getId() < samples[b].getId();
+      });
+    } else if(!samples.empty()) {
+      size_t numStreams = samples.front().size();
+      for(size_t j = 0; j < numStreams; ++j) // least significant stream first
+        sortByLength(samples, sortBy == "src" ? numStreams - 1 - j : j, order);
     }
 
+    Samples sorted;
+    sorted.reserve(samples.size());
+    for(auto k : order)
+      sorted.push_back(std::move(samples[k]));
+    samples.clear();
+    return sorted;
+  }
+
+  // this runs on a bg thread; sequencing is handled by caller, but locking is done in here
+  // Stages: reading (and encoding, see Corpus with --data-threads), sorting the maxi-batch by
+  // length, splitting it into batches and materializing the batches (in parallel with --data-threads).
+  std::deque<BatchPtr> fetchBatches() {
+    timer::Timer timer;
+
     size_t maxBatchSize = options_->get<int>("mini-batch");
     size_t maxSize = maxBatchSize * options_->get<int>("maxi-batch");
 
     // consume data from corpus into maxi-batch (single sentences)
-    // sorted into specified order (due to queue)
     if(newlyPrepared_) {
       current_ = data_->begin();
       newlyPrepared_ = false;
@@ -135,40 +162,46 @@ private:
       if(current_ != data_->end())
         ++current_;
     }
+    Samples samples;
     size_t sets = 0;
-    while(current_ != data_->end() && maxiBatch->size() < maxSize) { // loop over data
+    while(current_ != data_->end() && samples.size() < maxSize) { // loop over data
       if (saveAndExitRequested()) // stop generating batches
         return std::deque<BatchPtr>();
-      maxiBatch->push(*current_);
+      samples.push_back(*current_);
       sets = current_->size();
       // do not consume more than required for the maxi batch as this causes
       // that line-by-line translation is delayed by one sentence
-      bool last = maxiBatch->size() == maxSize;
+      bool last = samples.size() == maxSize;
       if(!last)
         ++current_; // this actually reads the next line and pre-processes it
     }
-    size_t numSentencesRead = maxiBatch->size();
+    size_t numSentencesRead = samples.size();
+    double readTime = timer.elapsed();
+
+    // sorted ascending, batches are taken from the back, i.e. longest first
+    Samples maxiBatch = sortSamples(std::move(samples));
+    double sortTime = timer.elapsed() - readTime;
 
     // construct the actual batches and place them in the queue
     Samples batchVector;
     size_t currentWords = 0;
     std::vector<size_t> lengths(sets, 0); // records maximum length observed within current batch
 
-    std::deque<BatchPtr> tempBatches;
+    std::vector<Samples> batchVectors; // batches are materialized below
 
-    // process all loaded sentences in order of increasing length
-    // @TODO: we could just use a vector and do a sort() here; would make the cost more explicit
+    // process all loaded sentences in order of decreasing length
     const size_t mbWords = options_->get<size_t>("mini-batch-words", 0);
+    const size_t mbTokens = options_->get<size_t>("mini-batch-tokens", 0);
     const bool useDynamicBatching = options_->has("mini-batch-fit");
     BatchStats::const_iterator cachedStatsIter;
     if (stats_)
       cachedStatsIter = stats_->begin();
-    while(!maxiBatch->empty()) { // while there are sentences in the queue
+    while(!maxiBatch.empty()) { // while there are sentences in the queue
       if (saveAndExitRequested()) // stop generating batches
         return std::deque<BatchPtr>();
       // push item onto batch
-      batchVector.push_back(maxiBatch->top());
-      maxiBatch->pop(); // fetch next-shortest
+      batchVector.push_back(maxiBatch.back());
+      maxiBatch.pop_back(); // fetch next-longest
 
       // have we reached sufficient amount of data to form a batch?
       bool makeBatch;
@@ -187,10 +220,16 @@ private:
         makeBatch = batchVector.size() >= maxBatchSize;
         // if last added sentence caused a bump then we likely have bad padding, so rather move it into the next batch
         if(batchVector.size() > maxBatchSize) {
-          maxiBatch->push(batchVector.back());
+          maxiBatch.push_back(batchVector.back());
           batchVector.pop_back();
         }
       }
+      else if(mbTokens > 0) {
+        // Sentences come longest first, so the first one determines the padded length. The batch is
+        // cut when one more sentence would exceed the budget; short sentences form large batches.
+        size_t paddedLength = batchVector.front()[0].size();
+        makeBatch = (batchVector.size() + 1) * paddedLength > mbTokens;
+      }
       else if(mbWords > 0) {
         currentWords += batchVector.back()[0].size(); // count words based on first stream =source  --@TODO: shouldn't we count based on labels?
         makeBatch = currentWords > mbWords; // Batch size based on sentences
@@ -200,7 +239,7 @@ private:
 
       // if we reached the desired batch size then create a real batch
       if(makeBatch) {
-        tempBatches.push_back(data_->toBatch(batchVector));
+        batchVectors.push_back(std::move(batchVector));
 
         // prepare for next batch
         batchVector.clear();
@@ -216,7 +255,34 @@ private:
     // inflate the contribution of the sames in the batch, causing instability.
     // I think a good alternative would be to carry over the left-over sentences into the next round.
     if(!batchVector.empty())
-      tempBatches.push_back(data_->toBatch(batchVector));
+      batchVectors.push_back(std::move(batchVector));
+    double batchingTime = timer.elapsed() - readTime - sortTime;
+
+    for(const auto& samples : batchVectors) {
+      size_t maxLength = 0;
+      for(const auto& sample : samples) {
+        sourceTokens_ += sample[0].size();
+        maxLength = std::max(maxLength, sample[0].size());
+      }
+      paddedTokens_ += samples.size() * maxLength;
+    }
+
+    std::deque<BatchPtr> tempBatches(batchVectors.size());
+    if(workers_) { // the workers write to separate batches in the original order
+      std::vector<std::future<void>> tasks;
+      size_t numWorkers = options_->get<size_t>("data-threads", 1);
+      for(size_t w = 0; w < numWorkers; ++w)
+        tasks.push_back(workers_->enqueue([&, w]() {
+          for(size_t b = w; b < batchVectors.size(); b += numWorkers)
+            tempBatches[b] = data_->toBatch(batchVectors[b]);
+        }));
+      for(auto& task : tasks)
+        task.get(); // rethrows errors of the workers
+    } else {
+      for(size_t b = 0; b < batchVectors.size(); ++b)
+        tempBatches[b] = data_->toBatch(batchVectors[b]);
+    }
+    double materializeTime = timer.elapsed() - readTime - sortTime - batchingTime;
 
     // Shuffle the batches
     if(shuffleBatches_) {
@@ -231,6 +297,8 @@ private:
     LOG(debug, "[data] fetched {} batches with {} sentences. Per batch: {} sentences, {} labels.",
         tempBatches.size(), numSentencesRead,
         (double)totalSent / (double)totalDenom, (double)totalLabels / (double)totalDenom);
+    LOG(debug, "[data] stages: reading {:.3f}s, sorting {:.3f}s, batching {:.3f}s, materializing {:.3f}s",
+        readTime, sortTime, batchingTime, materializeTime);
     return tempBatches;
   }
 
@@ -281,9 +349,15 @@ public:
                  bool runAsync = true)
       : data_(data), options_(options), stats_(stats), 
         runAsync_(runAsync), threadPool_(runAsync ? new ThreadPool(1) : nullptr) {
+    size_t dataThreads = options_->get<size_t>("data-threads", 1);
+    if(dataThreads > 1)
+      workers_.reset(new ThreadPool(dataThreads));
     auto shuffle = options_->get<std::string>("shuffle", "none");
     shuffleData_ = shuffle == "data";
     shuffleBatches_ = shuffleData_ || shuffle == "batches";
+    auto sortBy = options_->get<std::string>("maxi-batch-sort", "src");
+    if(options_->get<size_t>("mini-batch-tokens", 0) > 0 && sortBy != "src")
+      LOG(warn, "[data] --mini-batch-tokens sorts maxi-batches by source length, ignoring --maxi-batch-sort {}", sortBy);
   }
 
   ~BatchGenerator() {
@@ -335,6 +409,11 @@ public:
     return true;
   }
 
+  // Fraction of the padded source positions of all batches so far that hold actual tokens
+  double paddingEfficiency() const {
+    return paddedTokens_ > 0 ? sourceTokens_ / (double)paddedTokens_ : 1.0;
+  }
+
   // this is needed for dynamic MB scaling. Returns 0 if size is not known in words.
   size_t estimateTypicalTrgBatchWords() const {
     const size_t mbWords = options_->get<size_t>("mini-batch-words", 0);
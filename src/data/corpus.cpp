@@ -14,26 +14,44 @@ namespace data {
 Corpus::Corpus(Ptr<Options> options, bool translate /*= false*/)
     : CorpusBase(options, translate),
         shuffleInRAM_(options_->get<bool>("shuffle-in-ram", false)),
+        shuffleIndex_(options_->get<bool>("shuffle-index", false)),
+        shuffleBufferSize_(options_->get<size_t>("shuffle-buffer", 1000000)),
         allCapsEvery_(options_->get<size_t>("all-caps-every", 0)),
-        titleCaseEvery_(options_->get<size_t>("english-title-case-every", 0)) {}
+        titleCaseEvery_(options_->get<size_t>("english-title-case-every", 0)),
+        dataThreads_(options_->get<size_t>("data-threads", 1)) {
+  initEncodePool();
+}
 
 Corpus::Corpus(std::vector<std::string> paths,
                std::vector<Ptr<Vocab>> vocabs,
                Ptr<Options> options)
     : CorpusBase(paths, vocabs, options),
         shuffleInRAM_(options_->get<bool>("shuffle-in-ram", false)),
+        shuffleIndex_(options_->get<bool>("shuffle-index", false)),
+        shuffleBufferSize_(options_->get<size_t>("shuffle-buffer", 1000000)),
         allCapsEvery_(options_->get<size_t>("all-caps-every", 0)),
-        titleCaseEvery_(options_->get<size_t>("english-title-case-every", 0)) {}
+        titleCaseEvery_(options_->get<size_t>("english-title-case-every", 0)),
+        dataThreads_(options_->get<size_t>("data-threads", 1)) {
+  initEncodePool();
+}
+
+void Corpus::initEncodePool() {
+  if(dataThreads_ <= 1)
+    return;
+  encodePool_.reset(new ThreadPool(dataThreads_));
+  if(!options_->get<std::vector<float>>("sentencepiece-alphas", {}).empty())
+    LOG(warn, "[data] SentencePiece sampling with --data-threads {} is not reproducible", dataThreads_);
+}
 
-void Corpus::preprocessLine(std::string& line, size_t streamId) {
-  if (allCapsEvery_ != 0 && pos_ % allCapsEvery_ == 0 && !inference_) {
+void Corpus::preprocessLine(std::string& line, size_t streamId, size_t pos) const {
+  if (allCapsEvery_ != 0 && pos % allCapsEvery_ == 0 && !inference_) {
     line = vocabs_[streamId]->toUpper(line);
     if (streamId == 0)
       LOG_ONCE(info, "[data] Source all-caps'ed line to: {}", line);
     else
       LOG_ONCE(info, "[data] Target all-caps'ed line to: {}", line);
   }
-  else if (titleCaseEvery_ != 0 && pos_ % titleCaseEvery_ == 1 && !inference_ && streamId == 0) {
+  else if (titleCaseEvery_ != 0 && pos % titleCaseEvery_ == 1 && !inference_ && streamId == 0) {
     // Only applied to stream 0 (source) since this feature is aimed at robustness against
     // title case in the source (and not at translating into title case).
     // Note: It is user's responsibility to not enable this if the source language is not English.
@@ -45,7 +63,54 @@ void Corpus::preprocessLine(std::string& line, size_t streamId) {
   }
 }
 
-SentenceTuple Corpus::next() {
+// Reads the lines of the next sentence tuple from all streams, returns false at the end of the data
+bool Corpus::readLines(/*out*/ size_t& curId, /*out*/ std::vector<std::string>& lines) {
+  // get index of the current sentence
+  curId = pos_; // note: at end, pos_  == total size
+  size_t bufferPos = 0;
+  if(readFromIndex_) {
+    // with --shuffle-index, sentences come from the shuffle buffer
+    if(bufferPos_ == bufferOrder_.size() && !fillShuffleBuffer())
+      return false;
+    bufferPos = bufferOrder_[bufferPos_++];
+    curId = bufferIds_[bufferPos];
+  }
+  // if corpus has been shuffled, ids_ contains sentence indexes
+  else if(pos_ < ids_.size())
+    curId = ids_[pos_];
+  pos_++;
+
+  size_t eofsHit = 0;
+  size_t numStreams = readFromIndex_ ? lineIndexes_.size()
+                                     : corpusInRAM_.empty() ? files_.size() : corpusInRAM_.size();
+  lines.resize(numStreams);
+  for(size_t i = 0; i < numStreams; ++i) {
+    // fetch line, from shuffle buffer, cached copy in RAM or actual file
+    if(readFromIndex_) {
+      lines[i] = std::move(bufferLines_[i][bufferPos]);
+    }
+    else if (!corpusInRAM_.empty()) {
+      if (curId < corpusInRAM_[i].size())
+        lines[i] = corpusInRAM_[i][curId];
+      else
+        eofsHit++;
+    }
+    else {
+      bool gotLine = io::getline(*files_[i], lines[i]).good();
+      if(!gotLine)
+        eofsHit++;
+    }
+  }
+
+  if (eofsHit == numStreams)
+    return false;
+  ABORT_IF(eofsHit != 0, "not all input files have the same number of lines");
+  return true;
+}
+
+// Converts the lines of one sentence tuple into words. pos is the position of the tuple in reading
+// order, which determines the on-the-fly preprocessing. Safe to call from multiple threads.
+SentenceTuple Corpus::encodeLines(size_t curId, size_t pos, std::vector<std::string>& lines) const {
   // Used for handling TSV inputs
   // Determine the total number of fields including alignments or weights
   auto tsvNumAllFields = tsvNumInputFields_;
@@ -55,84 +120,109 @@ SentenceTuple Corpus::next() {
     ++tsvNumAllFields;
   std::vector<std::string> fields(tsvNumAllFields);
 
-  for(;;) { // (this is a retry loop for skipping invalid sentences)
-    // get index of the current sentence
-    size_t curId = pos_; // note: at end, pos_  == total size
-    // if corpus has been shuffled, ids_ contains sentence indexes
-    if(pos_ < ids_.size())
-      curId = ids_[pos_];
-    pos_++;
-
-    // fill up the sentence tuple with sentences from all input files
-    SentenceTuple tup(curId);
-    size_t eofsHit = 0;
-    size_t numStreams = corpusInRAM_.empty() ? files_.size() : corpusInRAM_.size();
-    for(size_t i = 0; i < numStreams; ++i) {
-      std::string line;
-
-      // fetch line, from cached copy in RAM or actual file
-      if (!corpusInRAM_.empty()) {
-        if (curId < corpusInRAM_[i].size())
-          line = corpusInRAM_[i][curId];
-        else {
-          eofsHit++;
-          continue;
-        }
-      }
-      else {
-        bool gotLine = io::getline(*files_[i], line).good();
-        if(!gotLine) {
-          eofsHit++;
-          continue;
-        }
-      }
-
-      if(i > 0 && i == alignFileIdx_) {
-        addAlignmentToSentenceTuple(line, tup);
-      } else if(i > 0 && i == weightFileIdx_) {
-        addWeightsToSentenceTuple(line, tup);
-      } else {
-        if(tsv_) {  // split TSV input and add each field into the sentence tuple
-          utils::splitTsv(line, fields, tsvNumAllFields);
-          size_t shift = 0;
-          for(size_t j = 0; j < tsvNumAllFields; ++j) {
-            // index j needs to be shifted to get the proper vocab index if guided-alignment or
-            // data-weighting are preceding source or target sequences in TSV input
-            if(j == alignFileIdx_ || j == weightFileIdx_) {
-              ++shift;
-            } else {
-              size_t vocabId = j - shift;
-              preprocessLine(fields[j], vocabId);
-              addWordsToSentenceTuple(fields[j], vocabId, tup);
-            }
+  // fill up the sentence tuple with sentences from all input files
+  SentenceTuple tup(curId);
+  for(size_t i = 0; i < lines.size(); ++i) {
+    std::string& line = lines[i];
+    if(i > 0 && i == alignFileIdx_) {
+      addAlignmentToSentenceTuple(line, tup);
+    } else if(i > 0 && i == weightFileIdx_) {
+      addWeightsToSentenceTuple(line, tup);
+    } else {
+      if(tsv_) {  // split TSV input and add each field into the sentence tuple
+        utils::splitTsv(line, fields, tsvNumAllFields);
+        size_t shift = 0;
+        for(size_t j = 0; j < tsvNumAllFields; ++j) {
+          // index j needs to be shifted to get the proper vocab index if guided-alignment or
+          // data-weighting are preceding source or target sequences in TSV input
+          if(j == alignFileIdx_ || j == weightFileIdx_) {
+            ++shift;
+          } else {
+            size_t vocabId = j - shift;
+            preprocessLine(fields[j], vocabId, pos);
+            addWordsToSentenceTuple(fields[j], vocabId, tup);
           }
+        }
 
-          // weights are added last to the sentence tuple, because this runs a validation that needs
-          // length of the target sequence
-          if(alignFileIdx_ > -1)
-            addAlignmentToSentenceTuple(fields[alignFileIdx_], tup);
-          if(weightFileIdx_ > -1)
-            addWeightsToSentenceTuple(fields[weightFileIdx_], tup);
+        // weights are added last to the sentence tuple, because this runs a validation that needs
+        // length of the target sequence
+        if(alignFileIdx_ > -1)
+          addAlignmentToSentenceTuple(fields[alignFileIdx_], tup);
+        if(weightFileIdx_ > -1)
+          addWeightsToSentenceTuple(fields[weightFileIdx_], tup);
 
-        } else {
-          preprocessLine(line, i);
-          addWordsToSentenceTuple(line, i, tup);
-        }
+      } else {
+        preprocessLine(line, i, pos);
+        addWordsToSentenceTuple(line, i, tup);
       }
     }
+  }
+  return tup;
+}
+
+// check if all streams are valid, that is, non-empty and no longer than maximum allowed length
+bool Corpus::isValid(const SentenceTuple& tup) const {
+  return std::all_of(tup.begin(), tup.end(), [=](const Words& words) {
+    return words.size() > 0 && words.size() <= maxLength_;
+  });
+}
+
+// Reads the next block of sentence tuples and encodes them on dataThreads_ threads. Reading stays
+// sequential and the encoded tuples are queued in reading order, so the result does not depend on
+// the number of threads.
+bool Corpus::encodeBlock() {
+  struct Raw {
+    size_t id;
+    size_t pos;
+    std::vector<std::string> lines;
+  };
+  std::vector<Raw> raw;
+  Raw next;
+  while(raw.size() < ENCODE_BLOCK_SIZE && readLines(next.id, next.lines)) {
+    next.pos = pos_;
+    raw.push_back(std::move(next));
+  }
+  if(raw.empty())
+    return false;
+
+  std::vector<UPtr<SentenceTuple>> tuples(raw.size());
+  size_t chunk = (raw.size() + dataThreads_ - 1) / dataThreads_;
+  std::vector<std::future<void>> tasks;
+  for(size_t begin = 0; begin < raw.size(); begin += chunk) {
+    size_t end = std::min(begin + chunk, raw.size());
+    tasks.push_back(encodePool_->enqueue([&, begin, end]() {
+      for(size_t k = begin; k < end; ++k)
+        tuples[k].reset(new SentenceTuple(encodeLines(raw[k].id, raw[k].pos, raw[k].lines)));
+    }));
+  }
+  for(auto& task : tasks)
+    task.get(); // rethrows errors of the workers
 
-    if (eofsHit == numStreams)
-      return SentenceTuple(0);
-    ABORT_IF(eofsHit != 0, "not all input files have the same number of lines");
+  for(auto& tup : tuples)
+    encoded_.push_back(std::move(*tup));
+  return true;
+}
 
-    // check if all streams are valid, that is, non-empty and no longer than maximum allowed length
-    if(std::all_of(tup.begin(), tup.end(), [=](const Words& words) {
-         return words.size() > 0 && words.size() <= maxLength_;
-       }))
-      return tup;
+SentenceTuple Corpus::next() {
+  std::vector<std::string> lines;
+  for(;;) { // (this is a retry loop for skipping invalid sentences)
+    if(dataThreads_ > 1) {
+      if(encoded_.empty() && !encodeBlock())
+        return SentenceTuple(0);
+      SentenceTuple tup = std::move(encoded_.front());
+      encoded_.pop_front();
+      if(isValid(tup))
+        return tup;
+    } else {
+      size_t curId;
+      if(!readLines(curId, lines))
+        return SentenceTuple(0);
+      SentenceTuple tup = encodeLines(curId, pos_, lines);
+      if(isValid(tup))
+        return tup;
+    }
 
     // otherwise skip this sentence and try the next one
-    // @TODO: tail recursion?
   }
 }
 
@@ -150,6 +240,8 @@ void Corpus::shuffle() {
 void Corpus::reset() {
   corpusInRAM_.clear();
   ids_.clear();
+  readFromIndex_ = false;
+  encoded_.clear();
   if (pos_ == 0) // no data read yet
     return;
   pos_ = 0;
@@ -176,11 +268,15 @@ void Corpus::restore(Ptr<TrainingState> ts) {
 
 void Corpus::shuffleData(const std::vector<std::string>& paths) {
   LOG(info, "[data] Shuffling data");
+  encoded_.clear();
 
   ABORT_IF(tsv_ && (paths[0] == "stdin" || paths[0] == "-"),
            "Shuffling training data from STDIN is not supported. Add --no-shuffle or provide "
            "training sets with --train-sets");
 
+  if(shuffleIndex_ && shuffleDataWithIndex(paths))
+    return;
+
   size_t numStreams = paths.size();
 
   size_t numSentences;
@@ -251,6 +347,65 @@ void Corpus::shuffleData(const std::vector<std::string>& paths) {
   pos_ = 0;
 }
 
+// Shuffles through line indexes of the input files instead of reading the whole corpus. The blocks
+// of lines are visited in random order and the sentences of consecutive blocks are shuffled again
+// in a buffer, so memory and disk use do not grow with the corpus. Returns false if an input file
+// cannot be indexed, e.g. if it is compressed.
+bool Corpus::shuffleDataWithIndex(const std::vector<std::string>& paths) {
+  if(lineIndexes_.empty()) {
+    for(const auto& path : paths) {
+      if(!LineIndex::supports(path)) {
+        LOG_ONCE(warn, "[data] Cannot use --shuffle-index with {}, shuffling through temp files", path);
+        return false;
+      }
+    }
+    for(const auto& path : paths)
+      lineIndexes_.emplace_back(new LineIndex(path));
+    for(const auto& lineIndex : lineIndexes_)
+      ABORT_IF(lineIndex->size() != lineIndexes_[0]->size(), "Not all input files have the same number of lines");
+  }
+
+  blockOrder_.resize(lineIndexes_[0]->blocks());
+  std::iota(blockOrder_.begin(), blockOrder_.end(), 0);
+  std::shuffle(blockOrder_.begin(), blockOrder_.end(), eng_);
+  nextBlock_ = 0;
+
+  bufferLines_.resize(lineIndexes_.size());
+  bufferOrder_.clear();
+  bufferPos_ = 0;
+
+  corpusInRAM_.clear();
+  ids_.clear();
+  readFromIndex_ = true;
+  pos_ = 0;
+  LOG(info, "[data] Shuffling {} sentences in blocks of {} through a buffer of {} sentences",
+      utils::withCommas(lineIndexes_[0]->size()), lineIndexes_[0]->stride(), utils::withCommas(shuffleBufferSize_));
+  return true;
+}
+
+// Reads the next blocks of lines into the shuffle buffer and shuffles them. Returns false at the
+// end of the epoch.
+bool Corpus::fillShuffleBuffer() {
+  for(auto& lines : bufferLines_)
+    lines.clear();
+  bufferIds_.clear();
+
+  while(nextBlock_ < blockOrder_.size() && bufferIds_.size() < shuffleBufferSize_) {
+    size_t block = blockOrder_[nextBlock_++];
+    for(size_t i = 0; i < lineIndexes_.size(); ++i)
+      lineIndexes_[i]->readBlock(block, bufferLines_[i]);
+    size_t firstId = block * lineIndexes_[0]->stride();
+    for(size_t id = firstId; bufferIds_.size() < bufferLines_[0].size(); ++id)
+      bufferIds_.push_back(id);
+  }
+
+  bufferOrder_.resize(bufferIds_.size());
+  std::iota(bufferOrder_.begin(), bufferOrder_.end(), 0);
+  std::shuffle(bufferOrder_.begin(), bufferOrder_.end(), eng_);
+  bufferPos_ = 0;
+  return !bufferOrder_.empty();
+}
+
 CorpusBase::batch_ptr Corpus::toBatch(const std::vector<Sample>& batchVector) {
   size_t batchSize = batchVector.size();
 
@@ -11,7 +11,11 @@
 #include "data/batch.h"
 #include "data/corpus_base.h"
 #include "data/dataset.h"
+#include "data/line_index.h"
 #include "data/vocab.h"
+#include "3rd_party/threadpool.h"
+
+#include <deque>
 
 namespace marian {
 namespace data {
@@ -25,12 +29,39 @@ private:
   bool shuffleInRAM_{false};
   std::vector<std::vector<std::string>> corpusInRAM_; // // [stream][id] full copy of all data files
 
+  // for shuffle-index: lines are read in blocks in shuffled order through a line index and shuffled
+  // again within a buffer of shuffleBufferSize_ sentences, nothing else is held in memory
+  bool shuffleIndex_{false};
+  size_t shuffleBufferSize_{0};
+  bool readFromIndex_{false};                          // current epoch is read through lineIndexes_
+  std::vector<UPtr<LineIndex>> lineIndexes_;           // [stream] built on first use, kept across epochs
+  std::vector<size_t> blockOrder_;                     // shuffled block ids
+  size_t nextBlock_{0};                                // next entry of blockOrder_ to read
+  std::vector<std::vector<std::string>> bufferLines_;  // [stream][buffer position]
+  std::vector<size_t> bufferIds_;                      // [buffer position] sentence id
+  std::vector<size_t> bufferOrder_;                    // shuffled buffer positions
+  size_t bufferPos_{0};                                // next entry of bufferOrder_ to return
+
   void shuffleData(const std::vector<std::string>& paths);
+  bool shuffleDataWithIndex(const std::vector<std::string>& paths);
+  bool fillShuffleBuffer();
 
   // for pre-processing
   size_t allCapsEvery_{0};   // if set, convert every N-th input sentence (after randomization) to all-caps (source and target)
   size_t titleCaseEvery_{0}; // ditto for title case (source only)
-  void preprocessLine(std::string& line, size_t streamId);
+  void preprocessLine(std::string& line, size_t streamId, size_t pos) const;
+
+  // for data-threads: sentences are read in blocks and encoded in parallel
+  size_t dataThreads_{1};
+  UPtr<ThreadPool> encodePool_;
+  std::deque<SentenceTuple> encoded_; // encoded sentences of the current block, in reading order
+  const size_t ENCODE_BLOCK_SIZE = 4096;
+  void initEncodePool();
+  bool encodeBlock();
+
+  bool readLines(/*out*/ size_t& curId, /*out*/ std::vector<std::string>& lines);
+  SentenceTuple encodeLines(size_t curId, size_t pos, std::vector<std::string>& lines) const;
+  bool isValid(const SentenceTuple& tup) const;
 
 public:
   // @TODO: check if translate can be replaced by an option in options
@@ -62,6 +62,9 @@ CorpusBase::CorpusBase(const std::vector<std::string>& paths,
 }
 
 CorpusBase::CorpusBase(Ptr<Options> options, bool translate)
+    : CorpusBase(options, translate, /*openFiles=*/true) {}
+
+CorpusBase::CorpusBase(Ptr<Options> options, bool translate, bool openFiles)
     : DatasetBase(options),
       maxLength_(options_->get<size_t>("max-length")),
       maxLengthCrop_(options_->get<bool>("max-length-crop")),
@@ -179,6 +182,7 @@ CorpusBase::CorpusBase(Ptr<Options> options, bool translate)
     //  There is more cases for multi-encoder models not listed above.
     //
     if(vocabPaths.empty()) {
+      ABORT_IF(!openFiles, "Vocabularies have to be given with --vocabs for this corpus");
       size_t numStreams = tsv_ ? tsvNumInputFields_ : paths_.size();
 
       if(tsv_) {
@@ -306,6 +310,8 @@ CorpusBase::CorpusBase(Ptr<Options> options, bool translate)
         }
 
         // Load or create the vocabulary
+        ABORT_IF(!openFiles && !filesystem::exists(vocabPaths[i]),
+                 "Vocabulary file does not exist: {}", vocabPaths[i]);
         Ptr<Vocab> vocab = New<Vocab>(options_, i);
         vocabDims[i] = (int) vocab->loadOrCreate(vocabPaths[i], groupedPaths, vocabDetails.size);
         vocabs_.emplace_back(vocab);
@@ -340,6 +346,10 @@ CorpusBase::CorpusBase(Ptr<Options> options, bool translate)
     options_->set("dim-vocabs", vocabDims);
   }
 
+  // the corpus reads its sentences from elsewhere, e.g. CorpusBinary
+  if(!openFiles)
+    return;
+
   for(auto path : paths_) {
     if(path == "stdin" || path == "-")
       files_.emplace_back(new std::istream(std::cin.rdbuf()));
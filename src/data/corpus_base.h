@@ -524,6 +524,10 @@ public:
   virtual std::vector<Ptr<Vocab>>& getVocabs() = 0;
 
 protected:
+  // Loads the vocabularies, but does not open the input files if openFiles is false, for corpora that
+  // read their sentences from elsewhere (see CorpusBinary). The vocabularies have to exist then.
+  CorpusBase(Ptr<Options> options, bool translate, bool openFiles);
+
   std::vector<UPtr<std::istream>> files_;
   std::vector<Ptr<Vocab>> vocabs_;
 
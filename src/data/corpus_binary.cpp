@@ -0,0 +1,205 @@
+#include "data/corpus_binary.h"
+
+#include "common/file_stream.h"
+#include "common/utils.h"
+
+#include <fstream>
+#include <numeric>
+
+namespace marian {
+namespace data {
+
+CorpusBinary::CorpusBinary(Ptr<Options> options) : CorpusBase(options, /*translate=*/false, /*openFiles=*/false) {
+  ABORT_IF(tsv_, "--binary-corpus cannot be combined with --tsv");
+  ABORT_IF(options_->get("guided-alignment", std::string("none")) != "none" || options_->hasAndNotEmpty("data-weighting"),
+           "--binary-corpus does not contain word alignments or weights");
+
+  auto fname = options_->get<std::string>("binary-corpus");
+  mmap_ = mio::mmap_source(fname);
+  ABORT_IF(mmap_.size() < sizeof(Header), "Binary corpus {} is truncated", fname);
+
+  auto header = (const Header*)mmap_.data();
+  ABORT_IF(header->magic != BINARY_CORPUS_MAGIC, "File {} is not a binary corpus", fname);
+  ABORT_IF(header->numStreams != vocabs_.size(),
+           "Binary corpus {} has {} streams, but there are {} vocabularies",
+           fname, header->numStreams, vocabs_.size());
+  ABORT_IF(mmap_.size() < sizeof(Header) + header->numStreams * sizeof(StreamHeader),
+           "Binary corpus {} is truncated", fname);
+
+  numSentences_ = header->numSentences;
+  auto streams = (const StreamHeader*)(mmap_.data() + sizeof(Header));
+  for(size_t i = 0; i < header->numStreams; ++i) {
+    const auto& stream = streams[i];
+    ABORT_IF(stream.vocabSize != vocabs_[i]->size(),
+             "Stream {} of binary corpus {} was encoded with a vocabulary of size {}, but vocabulary {} has size {}",
+             i, fname, stream.vocabSize, i, vocabs_[i]->size());
+    ABORT_IF(stream.wordsPos + stream.numWords * sizeof(WordIndex) > mmap_.size()
+             || stream.offsetsPos + (numSentences_ + 1) * sizeof(uint64_t) > mmap_.size(),
+             "Binary corpus {} is truncated", fname);
+    words_.push_back((const WordIndex*)(mmap_.data() + stream.wordsPos));
+    offsets_.push_back((const uint64_t*)(mmap_.data() + stream.offsetsPos));
+    ABORT_IF(offsets_.back()[0] != 0 || offsets_.back()[numSentences_] != stream.numWords,
+             "Binary corpus {} is corrupted", fname);
+  }
+
+  LOG(info, "[data] Memory-mapped binary corpus {} with {} sentences", fname, utils::withCommas(numSentences_));
+}
+
+void CorpusBinary::save(const std::string& fname,
+                        const std::vector<std::string>& paths,
+                        const std::vector<Ptr<Vocab>>& vocabs) {
+  ABORT_IF(paths.size() != vocabs.size(), "Number of corpus files and vocab files does not agree");
+
+  std::ofstream out(fname, std::ios::out | std::ios::binary);
+  ABORT_IF(!out, "Error opening file ({}): {}", errno, fname);
+  auto pos = [&]() { return (uint64_t)out.tellp(); };
+
+  Header header = {BINARY_CORPUS_MAGIC, paths.size(), 0};
+  std::vector<StreamHeader> streams(paths.size());
+  out.write((const char*)&header, sizeof(header)); // both are written again at the end
+  out.write((const char*)streams.data(), streams.size() * sizeof(StreamHeader));
+
+  // streams are encoded one after the other, so only the offsets of one stream are held in memory
+  for(size_t i = 0; i < paths.size(); ++i) {
+    LOG(info, "Encoding {}", paths[i]);
+    io::InputFileStream in(paths[i]);
+    in.setbufsize(10000000);
+
+    std::vector<uint64_t> offsets(1, 0);
+    streams[i].vocabSize = vocabs[i]->size();
+    streams[i].wordsPos = pos();
+    std::string line;
+    std::vector<WordIndex> ids;
+    while(io::getline(in, line)) {
+      Words words = vocabs[i]->encode(line, /*addEOS=*/false, /*inference=*/false);
+      ids.resize(words.size());
+      for(size_t j = 0; j < words.size(); ++j)
+        ids[j] = words[j].toWordIndex();
+      out.write((const char*)ids.data(), ids.size() * sizeof(WordIndex));
+      offsets.push_back(offsets.back() + ids.size());
+    }
+    streams[i].numWords = offsets.back();
+
+    size_t numSentences = offsets.size() - 1;
+    ABORT_IF(i > 0 && numSentences != header.numSentences, "Not all input files have the same number of lines");
+    header.numSentences = numSentences;
+
+    // keep the offsets 8-byte aligned
+    if(pos() % sizeof(uint64_t) != 0)
+      out.write("\0\0\0\0", sizeof(uint64_t) - pos() % sizeof(uint64_t));
+    streams[i].offsetsPos = pos();
+    out.write((const char*)offsets.data(), offsets.size() * sizeof(uint64_t));
+    LOG(info, "Encoded {} sentences with {} words", utils::withCommas(numSentences), utils::withCommas(streams[i].numWords));
+  }
+
+  out.seekp(0);
+  out.write((const char*)&header, sizeof(header));
+  out.write((const char*)streams.data(), streams.size() * sizeof(StreamHeader));
+  ABORT_IF(out.fail(), "Error writing binary corpus {}", fname);
+}
+
+SentenceTuple CorpusBinary::next() {
+  for(;;) { // (skips sentences that are too long, as Corpus::next())
+    if(pos_ >= numSentences_)
+      return SentenceTuple(0);
+    size_t curId = sentenceOrder_.empty() ? pos_ : sentenceOrder_[pos_];
+    pos_++;
+
+    SentenceTuple tup(curId);
+    for(size_t i = 0; i < words_.size(); ++i) {
+      // the file is checked as far as it is read, a full pass when loading would cost as much as an
+      // epoch of reading
+      ABORT_IF(offsets_[i][curId] > offsets_[i][curId + 1] || offsets_[i][curId + 1] > offsets_[i][numSentences_],
+               "Binary corpus {} is corrupted", options_->get<std::string>("binary-corpus"));
+      const WordIndex* begin = words_[i] + offsets_[i][curId];
+      const WordIndex* end   = words_[i] + offsets_[i][curId + 1];
+
+      size_t vocabSize = vocabs_[i]->size();
+      Words words;
+      words.reserve(end - begin + 1);
+      for(auto it = begin; it != end; ++it) {
+        ABORT_IF(*it >= vocabSize,
+                 "Stream {} of binary corpus {} contains word id {}, which is out of range for a vocabulary of size {}",
+                 i, options_->get<std::string>("binary-corpus"), *it, vocabSize);
+        words.push_back(Word::fromWordIndex(*it));
+      }
+      if(addEOS_[i])
+        words.push_back(vocabs_[i]->getEosId());
+
+      // same as CorpusBase::addWordsToSentenceTuple()
+      if(maxLengthCrop_ && words.size() > maxLength_) {
+        words.resize(maxLength_);
+        if(addEOS_[i])
+          words.back() = vocabs_[i]->getEosId();
+      }
+      if(rightLeft_ && !words.empty())
+        std::reverse(words.begin(), words.end() - 1);
+
+      tup.push_back(std::move(words));
+    }
+
+    if(std::all_of(tup.begin(), tup.end(), [=](const Words& words) {
+         return words.size() > 0 && words.size() <= maxLength_;
+       }))
+      return tup;
+  }
+}
+
+void CorpusBinary::shuffle() {
+  LOG(info, "[data] Shuffling binary corpus");
+  sentenceOrder_.resize(numSentences_);
+  std::iota(sentenceOrder_.begin(), sentenceOrder_.end(), 0);
+  std::shuffle(sentenceOrder_.begin(), sentenceOrder_.end(), eng_);
+  pos_ = 0;
+}
+
+void CorpusBinary::reset() {
+  sentenceOrder_.clear();
+  pos_ = 0;
+}
+
+void CorpusBinary::restore(Ptr<TrainingState> ts) {
+  setRNGState(ts->seedCorpus);
+}
+
+CorpusBase::batch_ptr CorpusBinary::toBatch(const std::vector<Sample>& batchVector) {
+  size_t batchSize = batchVector.size();
+
+  std::vector<size_t> sentenceIds;
+  std::vector<int> maxDims;
+  for(auto& ex : batchVector) {
+    if(maxDims.size() < ex.size())
+      maxDims.resize(ex.size(), 0);
+    for(size_t i = 0; i < ex.size(); ++i) {
+      if(ex[i].size() > (size_t)maxDims[i])
+        maxDims[i] = (int)ex[i].size();
+    }
+    sentenceIds.push_back(ex.getId());
+  }
+
+  std::vector<Ptr<SubBatch>> subBatches;
+  for(size_t j = 0; j < maxDims.size(); ++j)
+    subBatches.emplace_back(New<SubBatch>(batchSize, maxDims[j], vocabs_[j]));
+
+  std::vector<size_t> words(maxDims.size(), 0);
+  for(size_t b = 0; b < batchSize; ++b) {
+    for(size_t j = 0; j < maxDims.size(); ++j) {
+      auto subBatch = subBatches[j];
+      for(size_t s = 0; s < batchVector[b][j].size(); ++s) {
+        subBatch->data()[subBatch->locate(/*batchIdx=*/b, /*wordPos=*/s)] = batchVector[b][j][s];
+        subBatch->mask()[subBatch->locate(/*batchIdx=*/b, /*wordPos=*/s)] = 1.f;
+        words[j]++;
+      }
+    }
+  }
+
+  for(size_t j = 0; j < maxDims.size(); ++j)
+    subBatches[j]->setWords(words[j]);
+
+  auto batch = batch_ptr(new batch_type(subBatches));
+  batch->setSentenceIds(sentenceIds);
+  return batch;
+}
+
+}  // namespace data
+}  // namespace marian
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "3rd_party/mio/mio.hpp"
+#include "data/corpus_base.h"
+
+namespace marian {
+namespace data {
+
+// Training corpus that has been encoded into word ids once with marian-conv --corpus, used instead
+// of the text files of --train-sets with --binary-corpus. The file is memory-mapped and sentences
+// are copied from it directly into sentence tuples, so vocabulary encoding and all string handling
+// are skipped while training. Vocabularies are loaded as for the text corpus and have to be the
+// ones used for the conversion, the text files of --train-sets are not opened.
+//
+// Layout: Header, one StreamHeader per stream, then for every stream its word ids followed by
+// numSentences + 1 word offsets. Word ids are stored without EOS, which is added according to
+// --input-types when reading.
+class CorpusBinary : public CorpusBase {
+private:
+  struct Header {
+    uint64_t magic;        // BINARY_CORPUS_MAGIC
+    uint64_t numStreams;
+    uint64_t numSentences;
+  };
+
+  struct StreamHeader {
+    uint64_t vocabSize; // size of the vocabulary used for encoding, checked when loading
+    uint64_t numWords;
+    uint64_t wordsPos;   // byte position of the word ids
+    uint64_t offsetsPos; // byte position of the offsets
+  };
+
+  static const uint64_t BINARY_CORPUS_MAGIC = 0x3130535043524d4dULL; // "MMRCPS01" when read little-endian
+
+  mio::mmap_source mmap_;
+  size_t numSentences_{0};
+  std::vector<const WordIndex*> words_;  // [stream] word ids
+  std::vector<const uint64_t*> offsets_; // [stream][sentence] begin of the sentence in words_[stream]
+  std::vector<size_t> sentenceOrder_;    // shuffled sentence ids, empty if not shuffled
+
+public:
+  CorpusBinary(Ptr<Options> options);
+
+  // Encodes parallel text files with the given vocabularies and writes them to fname
+  static void save(const std::string& fname,
+                   const std::vector<std::string>& paths,
+                   const std::vector<Ptr<Vocab>>& vocabs);
+
+  Sample next() override;
+
+  void shuffle() override;
+
+  void reset() override;
+
+  void restore(Ptr<TrainingState>) override;
+
+  iterator begin() override { return iterator(this); }
+
+  iterator end() override { return iterator(); }
+
+  std::vector<Ptr<Vocab>>& getVocabs() override { return vocabs_; }
+
+  batch_ptr toBatch(const std::vector<Sample>& batchVector) override;
+};
+
+}  // namespace data
+}  // namespace marian
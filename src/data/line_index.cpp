@@ -0,0 +1,159 @@
+#include "data/line_index.h"
+
+#include "common/filesystem.h"
+#include "common/logging.h"
+#include "common/utils.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace marian {
+namespace data {
+
+namespace {
+const uint64_t LINE_INDEX_MAGIC = 0x32584449454e494cULL; // "LINEIDX2"
+const size_t STAMP_HASH_BYTES = 64 * 1024; // hashed at the beginning and at the end of the file
+
+struct LineIndexHeader {
+  uint64_t magic;
+  uint64_t fileSize; // stamp of the indexed text file, a mismatch means the index is stale
+  uint64_t fileMtime;
+  uint64_t fileHash;
+  uint64_t stride;
+  uint64_t numLines;
+  uint64_t numOffsets;
+};
+}  // namespace
+
+LineIndex::LineIndex(const std::string& path, size_t stride) : path_(path), stride_(stride) {
+  ABORT_IF(!supports(path_), "Cannot index lines of {}", path_);
+  FileStamp fileStamp = stamp();
+  if(!load(fileStamp)) {
+    build(fileStamp.size);
+    save(fileStamp);
+  }
+
+  file_.open(path_, std::ios::in | std::ios::binary);
+  ABORT_IF(!file_, "Error opening file ({}): {}", errno, path_);
+}
+
+bool LineIndex::supports(const std::string& path) {
+  return path != "stdin" && path != "-" && !utils::endsWith(path, "|") && !utils::endsWith(path, ".gz")
+         && filesystem::exists(path) && !filesystem::is_fifo(path);
+}
+
+LineIndex::FileStamp LineIndex::stamp() const {
+  FileStamp stamp;
+  stamp.size = filesystem::fileSize(path_);
+  stamp.mtime = (uint64_t)filesystem::Path(path_).getImpl().mtime();
+
+  std::ifstream in(path_, std::ios::in | std::ios::binary);
+  ABORT_IF(!in, "Error opening file ({}): {}", errno, path_);
+  std::string bytes(std::min<uint64_t>(stamp.size, 2 * STAMP_HASH_BYTES), '\0');
+  size_t head = std::min<size_t>(bytes.size(), STAMP_HASH_BYTES);
+  in.read(&bytes[0], head);
+  if(bytes.size() > head) {
+    in.seekg(stamp.size - (bytes.size() - head));
+    in.read(&bytes[head], bytes.size() - head);
+  }
+  ABORT_IF(!in, "Could not read {}", path_);
+  stamp.hash = (uint64_t)std::hash<std::string>()(bytes);
+  return stamp;
+}
+
+bool LineIndex::load(const FileStamp& stamp) {
+  std::ifstream in(indexPath(path_), std::ios::in | std::ios::binary);
+  if(!in)
+    return false;
+
+  LineIndexHeader header;
+  in.read((char*)&header, sizeof(header));
+  if(!in || header.magic != LINE_INDEX_MAGIC || header.stride != stride_ || header.fileSize != stamp.size
+     || header.fileMtime != stamp.mtime || header.fileHash != stamp.hash)
+    return false;
+
+  offsets_.resize(header.numOffsets);
+  in.read((char*)offsets_.data(), offsets_.size() * sizeof(uint64_t));
+  if(!in || offsets_.empty() || offsets_.back() != stamp.size) {
+    offsets_.clear();
+    return false;
+  }
+  numLines_ = header.numLines;
+  LOG(info, "[data] Loaded line index {}", indexPath(path_));
+  return true;
+}
+
+void LineIndex::build(uint64_t fileSize) {
+  LOG(info, "[data] Building line index of {}", path_);
+  std::ifstream in(path_, std::ios::in | std::ios::binary);
+  ABORT_IF(!in, "Error opening file ({}): {}", errno, path_);
+
+  offsets_.clear();
+  numLines_ = 0;
+  uint64_t lineStart = 0; // offset of the line currently being read
+  bool inLine = false;    // some bytes of the current line have been read
+  std::vector<char> buf(16 * 1024 * 1024);
+  uint64_t pos = 0;
+  while(in) {
+    in.read(buf.data(), buf.size());
+    size_t n = (size_t)in.gcount();
+    for(size_t i = 0; i < n; ++i) {
+      if(!inLine) {
+        if(numLines_ % stride_ == 0)
+          offsets_.push_back(lineStart);
+        numLines_++;
+        inLine = true;
+      }
+      if(buf[i] == '\n') {
+        lineStart = pos + i + 1;
+        inLine = false;
+      }
+    }
+    pos += n;
+  }
+  ABORT_IF(pos != fileSize, "Could not read all of {}", path_);
+  offsets_.push_back(fileSize);
+  LOG(info, "[data] Indexed {} lines of {}", utils::withCommas(numLines_), path_);
+}
+
+void LineIndex::save(const FileStamp& stamp) const {
+  std::ofstream out(indexPath(path_), std::ios::out | std::ios::binary);
+  if(out) {
+    LineIndexHeader header = {LINE_INDEX_MAGIC, stamp.size, stamp.mtime, stamp.hash,
+                              stride_, numLines_, offsets_.size()};
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)offsets_.data(), offsets_.size() * sizeof(uint64_t));
+  }
+  if(!out) // e.g. read-only directory, the index is rebuilt next time
+    LOG(warn, "[data] Could not write line index {}", indexPath(path_));
+}
+
+void LineIndex::readBlock(size_t block, std::vector<std::string>& lines) {
+  uint64_t begin = offsets_[block];
+  uint64_t end = offsets_[block + 1];
+  readBuf_.resize(end - begin);
+  file_.clear();
+  file_.seekg(begin);
+  file_.read(&readBuf_[0], readBuf_.size());
+  ABORT_IF((uint64_t)file_.gcount() != end - begin, "Could not read lines of {}", path_);
+
+  size_t expected = std::min(stride_, numLines_ - block * stride_);
+  size_t found = 0;
+  size_t lineBegin = 0;
+  while(lineBegin < readBuf_.size()) {
+    size_t lineEnd = readBuf_.find('\n', lineBegin);
+    if(lineEnd == std::string::npos)
+      lineEnd = readBuf_.size();
+    size_t len = lineEnd - lineBegin;
+    if(len > 0 && readBuf_[lineBegin + len - 1] == '\r') // as io::getline(), for Windows line ends
+      len--;
+    lines.emplace_back(readBuf_, lineBegin, len);
+    found++;
+    lineBegin = lineEnd + 1;
+  }
+  ABORT_IF(found != expected,
+           "Line index of {} is out of date, delete {} to rebuild it", path_, indexPath(path_));
+}
+
+}  // namespace data
+}  // namespace marian
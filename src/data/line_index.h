@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common/definitions.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace marian {
+namespace data {
+
+// Sparse index of line offsets of an uncompressed text file, used by Corpus for shuffled reading
+// with --shuffle-index. It stores the byte offset of every stride-th line, so the file can be read
+// in blocks of stride lines in any order with one seek per block. The index is built with one
+// sequential pass over the file and kept in a sidecar file <path>.lineidx next to it, which is
+// reused as long as the stride and the stamp of the text file match: its size, modification time
+// and a hash of its first and last bytes. The hash catches files rewritten in place with the same
+// size within the resolution of the modification time.
+class LineIndex {
+private:
+  struct FileStamp {
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t hash;
+  };
+
+  std::string path_;
+  size_t stride_;
+  size_t numLines_{0};
+  std::vector<uint64_t> offsets_; // [block] offset of line block * stride_, followed by the file size
+  std::ifstream file_;
+  std::string readBuf_;
+
+  FileStamp stamp() const;
+  bool load(const FileStamp& stamp);
+  void build(uint64_t fileSize);
+  void save(const FileStamp& stamp) const;
+
+public:
+  LineIndex(const std::string& path, size_t stride = 256);
+
+  // False for input that cannot be read at arbitrary offsets, e.g. stdin, pipes or .gz files
+  static bool supports(const std::string& path);
+
+  // Name of the sidecar file the index of path is kept in
+  static std::string indexPath(const std::string& path) { return path + ".lineidx"; }
+
+  size_t size() const { return numLines_; }
+  size_t stride() const { return stride_; }
+  size_t blocks() const { return offsets_.size() - 1; }
+
+  // Appends the lines block * stride() ... (block + 1) * stride() - 1 of the file to lines
+  void readBlock(size_t block, std::vector<std::string>& lines);
+};
+
+}  // namespace data
+}  // namespace marian
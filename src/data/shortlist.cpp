@@ -0,0 +1,211 @@
+#include "data/shortlist.h"
+#include "data/vocab.h"
+
+#include <fstream>
+
+namespace marian {
+namespace data {
+
+Ptr<Shortlist> ShortlistGenerator::generateFromCandidates(const Words& srcWords,
+                                                         size_t firstNum,
+                                                         size_t trgVocabSize,
+                                                         bool shared,
+                                                         const uint64_t* offsets,
+                                                         const WordIndex* trgIds,
+                                                         size_t numSrc) {
+  // Reused across batches, cleared again before returning. Generators may be shared between
+  // translation threads, hence one set of bitsets per thread.
+  thread_local std::vector<uint64_t> trgBits;
+  thread_local std::vector<uint64_t> srcBits;
+
+  // padding below may add a few words past firstNum
+  size_t trgWords = (std::max(trgVocabSize, firstNum) + 8 + 63) / 64;
+  if(trgBits.size() < trgWords)
+    trgBits.resize(trgWords, 0);
+  size_t srcWordsBits = (std::max(numSrc, shared ? trgVocabSize : 0) + 63) / 64;
+  if(srcBits.size() < srcWordsBits)
+    srcBits.resize(srcWordsBits, 0);
+
+  size_t count = 0;
+  auto add = [&](WordIndex i) {
+    uint64_t bit = 1ULL << (i % 64);
+    uint64_t& word = trgBits[i / 64];
+    count += (word & bit) == 0;
+    word |= bit;
+  };
+
+  // add firstNum most frequent words
+  for(WordIndex i = 0; i < firstNum && i < trgVocabSize; ++i)
+    add(i);
+
+  // add aligned target words, each source word is expanded once
+  for(auto w : srcWords) {
+    WordIndex i = w.toWordIndex();
+    uint64_t bit = 1ULL << (i % 64);
+    if(i / 64 >= srcBits.size() || (srcBits[i / 64] & bit))
+      continue;
+    srcBits[i / 64] |= bit;
+
+    if(shared)
+      add(i);
+    if(i < numSrc)
+      for(uint64_t j = offsets[i]; j < offsets[i + 1]; ++j)
+        add(trgIds[j]);
+  }
+
+  for(auto w : srcWords) {
+    WordIndex i = w.toWordIndex();
+    if(i / 64 < srcBits.size())
+      srcBits[i / 64] = 0;
+  }
+
+  // Ensure that the generated vocabulary items from a shortlist are a multiple-of-eight
+  // This is necessary until intgemm supports non-multiple-of-eight matrices.
+  for(WordIndex i = static_cast<WordIndex>(firstNum); count % 8 != 0; ++i)
+    add(i);
+
+  // emit set bits in increasing order and clear the bitset for the next batch
+  std::vector<WordIndex> indices;
+  indices.reserve(count);
+  for(size_t k = 0; k < trgBits.size() && indices.size() < count; ++k) {
+    uint64_t word = trgBits[k];
+    for(WordIndex i = (WordIndex)(k * 64); word != 0; ++i, word >>= 1)
+      if(word & 1)
+        indices.push_back(i);
+    trgBits[k] = 0;
+  }
+
+  return New<Shortlist>(std::move(indices));
+}
+
+void LexicalShortlistGenerator::saveBinary(const std::string& fname) const {
+  BinaryShortlistGenerator::save(fname, firstNum_, bestNum_, offsets_, trgIds_, srcVocab_->size(), trgVocab_->size());
+}
+
+BinaryShortlistGenerator::BinaryShortlistGenerator(Ptr<Options> options,
+                                                   Ptr<const Vocab> srcVocab,
+                                                   Ptr<const Vocab> trgVocab,
+                                                   size_t srcIdx,
+                                                   size_t /*trgIdx*/,
+                                                   bool shared)
+    : srcVocab_(srcVocab), trgVocab_(trgVocab), srcIdx_(srcIdx), shared_(shared) {
+  std::vector<std::string> vals = options->get<std::vector<std::string>>("shortlist");
+  ABORT_IF(vals.empty(), "No path to filter path given");
+  std::string fname = vals[0];
+
+  mmap_ = mio::mmap_source(fname);
+  ABORT_IF(mmap_.size() < sizeof(Header), "Binary shortlist {} is truncated", fname);
+
+  header_ = (const Header*)mmap_.data();
+  ABORT_IF((header_->magic & BINARY_SHORTLIST_MAGIC_MASK) != (BINARY_SHORTLIST_MAGIC & BINARY_SHORTLIST_MAGIC_MASK),
+           "File {} is not a binary shortlist", fname);
+  ABORT_IF(header_->magic != BINARY_SHORTLIST_MAGIC,
+           "Binary shortlist {} has been written by another version of marian-conv, please convert it again", fname);
+
+  size_t expectedSize = sizeof(Header)
+                        + (header_->numSrc + 1) * sizeof(uint64_t)
+                        + header_->numTrg * sizeof(WordIndex);
+  ABORT_IF(mmap_.size() != expectedSize,
+           "Binary shortlist {} has {} bytes, expected {}",
+           fname, mmap_.size(), expectedSize);
+
+  offsets_ = (const uint64_t*)(mmap_.data() + sizeof(Header));
+  trgIds_  = (const WordIndex*)(offsets_ + header_->numSrc + 1);
+  ABORT_IF(offsets_[header_->numSrc] != header_->numTrg || header_->numSrc > header_->srcVocabSize,
+           "Binary shortlist {} is corrupted", fname);
+
+  // word indices are used without checks in generate(), they need to be those of the vocabularies
+  ABORT_IF(header_->srcVocabSize != srcVocab_->size() || header_->trgVocabSize != trgVocab_->size(),
+           "Binary shortlist {} has been converted with vocabularies of {} source and {} target words, "
+           "but the vocabularies of the model have {} and {}",
+           fname, header_->srcVocabSize, header_->trgVocabSize, srcVocab_->size(), trgVocab_->size());
+
+  // pruning has been done during conversion, so only the path of the options is used
+  if(vals.size() > 1)
+    LOG(info, "[data] Ignoring pruning options of --shortlist for pre-pruned binary shortlist");
+
+  LOG(info,
+      "[data] Memory-mapped binary shortlist {} with first {}, best {}, {} source words",
+      fname,
+      header_->firstNum,
+      header_->bestNum,
+      header_->numSrc);
+}
+
+bool BinaryShortlistGenerator::isBinaryShortlist(const std::string& fname) {
+  std::ifstream in(fname, std::ios::binary);
+  uint64_t magic = 0;
+  in.read((char*)&magic, sizeof(magic));
+  return in && (magic & BINARY_SHORTLIST_MAGIC_MASK) == (BINARY_SHORTLIST_MAGIC & BINARY_SHORTLIST_MAGIC_MASK);
+}
+
+void BinaryShortlistGenerator::save(const std::string& fname,
+                                    size_t firstNum,
+                                    size_t bestNum,
+                                    const std::vector<uint64_t>& offsets,
+                                    const std::vector<WordIndex>& trgIds,
+                                    size_t srcVocabSize,
+                                    size_t trgVocabSize) {
+  Header header;
+  header.magic    = BINARY_SHORTLIST_MAGIC;
+  header.firstNum = firstNum;
+  header.bestNum  = bestNum;
+  header.numSrc   = offsets.size() - 1;
+  header.numTrg   = trgIds.size();
+  header.srcVocabSize = srcVocabSize;
+  header.trgVocabSize = trgVocabSize;
+
+  ABORT_IF(header.numSrc > srcVocabSize, "Shortlist has {} source words, but the source vocabulary only {}",
+           header.numSrc, srcVocabSize);
+  for(auto trgId : trgIds)
+    ABORT_IF(trgId >= trgVocabSize, "Shortlist contains target word index {} outside of the target vocabulary of {} words",
+             trgId, trgVocabSize);
+
+  LOG(info, "[data] Saving binary shortlist with {} source words and {} translations to {}",
+      header.numSrc, header.numTrg, fname);
+
+  io::OutputFileStream out(fname);
+  out.write(&header);
+  out.write(offsets.data(), offsets.size());
+  out.write(trgIds.data(), trgIds.size());
+}
+
+void BinaryShortlistGenerator::dump(const std::string& prefix) const {
+  // Dump top most frequent words from target vocabulary
+  LOG(info, "[data] Saving shortlist dump to {}", prefix + ".{top,dic}");
+  io::OutputFileStream outTop(prefix + ".top");
+  for(WordIndex i = 0; i < header_->firstNum && i < trgVocab_->size(); ++i)
+    outTop << (*trgVocab_)[Word::fromWordIndex(i)] << std::endl;
+
+  // Dump translation pairs from dictionary
+  io::OutputFileStream outDic(prefix + ".dic");
+  for(WordIndex srcId = 0; srcId < header_->numSrc; srcId++) {
+    for(uint64_t j = offsets_[srcId]; j < offsets_[srcId + 1]; ++j) {
+      outDic << (*srcVocab_)[Word::fromWordIndex(srcId)] << "\t" << (*trgVocab_)[Word::fromWordIndex(trgIds_[j])] << std::endl;
+    }
+  }
+}
+
+Ptr<Shortlist> BinaryShortlistGenerator::generate(Ptr<data::CorpusBatch> batch) const {
+  auto srcBatch = (*batch)[srcIdx_];
+  return generateFromCandidates(srcBatch->data(), header_->firstNum, trgVocab_->size(), shared_,
+                                offsets_, trgIds_, header_->numSrc);
+}
+
+Ptr<ShortlistGenerator> createShortlistGenerator(Ptr<Options> options,
+                                                 Ptr<const Vocab> srcVocab,
+                                                 Ptr<const Vocab> trgVocab,
+                                                 size_t srcIdx,
+                                                 size_t trgIdx,
+                                                 bool shared) {
+  std::vector<std::string> vals = options->get<std::vector<std::string>>("shortlist");
+  ABORT_IF(vals.empty(), "No path to filter path given");
+
+  if(BinaryShortlistGenerator::isBinaryShortlist(vals[0]))
+    return New<BinaryShortlistGenerator>(options, srcVocab, trgVocab, srcIdx, trgIdx, shared);
+  else
+    return New<LexicalShortlistGenerator>(options, srcVocab, trgVocab, srcIdx, trgIdx, shared);
+}
+
+}  // namespace data
+}  // namespace marian
@@ -6,6 +6,8 @@
 #include "data/corpus_base.h"
 #include "data/types.h"
 
+#include "3rd_party/mio/mio.hpp"
+
 #include <random>
 #include <unordered_map>
 #include <unordered_set>
@@ -24,6 +26,9 @@ public:
   Shortlist(const std::vector<WordIndex>& indices)
     : indices_(indices) {}
 
+  Shortlist(std::vector<WordIndex>&& indices)
+    : indices_(std::move(indices)) {}
+
   const std::vector<WordIndex>& indices() const { return indices_; }
   WordIndex reverseMap(int idx) { return indices_[idx]; }
 
@@ -48,6 +53,19 @@ public:
   virtual void dump(const std::string& /*prefix*/) const {
     ABORT("Not implemented");
   }
+
+protected:
+  // Returns the sorted union of the firstNum most frequent target words and the candidates
+  // trgIds[offsets[w], offsets[w + 1]) of every source word w in srcWords (plus w itself if the
+  // vocabularies are shared), padded to a multiple of eight. The union is collected in reusable
+  // thread-local bitsets, so apart from the result no memory is allocated and nothing is hashed.
+  static Ptr<Shortlist> generateFromCandidates(const Words& srcWords,
+                                               size_t firstNum,
+                                               size_t trgVocabSize,
+                                               bool shared,
+                                               const uint64_t* offsets, // [numSrc + 1]
+                                               const WordIndex* trgIds,
+                                               size_t numSrc);
 };
 
 
@@ -141,6 +159,10 @@ private:
 
   std::vector<std::unordered_map<WordIndex, float>> data_; // [WordIndex src] -> [WordIndex tgt] -> P_trans(tgt|src) --@TODO: rename data_ accordingly
 
+  // pruned translations in CSR layout, built from data_ after pruning
+  std::vector<uint64_t> offsets_;  // [WordIndex src] -> begin of its translations in trgIds_, data_.size() + 1 entries
+  std::vector<WordIndex> trgIds_;  // sorted target word indices per source word
+
   void load(const std::string& fname) {
     io::InputFileStream in(fname);
 
@@ -182,6 +204,23 @@ private:
     }
   }
 
+  // Converts the pruned translations into CSR layout and releases the hash maps
+  void index() {
+    offsets_.clear();
+    trgIds_.clear();
+    offsets_.reserve(data_.size() + 1);
+    for(const auto& probs : data_) {
+      offsets_.push_back(trgIds_.size());
+      size_t begin = trgIds_.size();
+      for(const auto& it : probs)
+        trgIds_.push_back(it.first);
+      std::sort(trgIds_.begin() + begin, trgIds_.end());
+    }
+    offsets_.push_back(trgIds_.size());
+    data_.clear();
+    data_.shrink_to_fit();
+  }
+
 public:
   LexicalShortlistGenerator(Ptr<Options> options,
                             Ptr<const Vocab> srcVocab,
@@ -214,11 +253,15 @@ public:
     // @TODO: Load and prune in one go.
     load(fname);
     prune(threshold);
+    index();
 
     if(!dumpPath.empty())
       dump(dumpPath);
   }
 
+  // Writes the pruned shortlist in the format read by BinaryShortlistGenerator
+  void saveBinary(const std::string& fname) const;
+
   virtual void dump(const std::string& prefix) const override {
     // Dump top most frequent words from target vocabulary
     LOG(info, "[data] Saving shortlist dump to {}", prefix + ".{top,dic}");
@@ -228,9 +271,9 @@ public:
 
     // Dump translation pairs from dictionary
     io::OutputFileStream outDic(prefix + ".dic");
-    for(WordIndex srcId = 0; srcId < data_.size(); srcId++) {
-      for(auto& it : data_[srcId]) {
-        auto trgId = it.first;
+    for(WordIndex srcId = 0; srcId + 1 < offsets_.size(); srcId++) {
+      for(uint64_t j = offsets_[srcId]; j < offsets_[srcId + 1]; ++j) {
+        auto trgId = trgIds_[j];
         outDic << (*srcVocab_)[Word::fromWordIndex(srcId)] << "\t" << (*trgVocab_)[Word::fromWordIndex(trgId)] << std::endl;
       }
     }
@@ -238,45 +281,77 @@ public:
 
   virtual Ptr<Shortlist> generate(Ptr<data::CorpusBatch> batch) const override {
     auto srcBatch = (*batch)[srcIdx_];
+    return generateFromCandidates(srcBatch->data(), firstNum_, trgVocab_->size(), shared_,
+                                  offsets_.data(), trgIds_.data(), offsets_.size() - 1);
+  }
+};
 
-    // add firstNum most frequent words
-    std::unordered_set<WordIndex> indexSet;
-    for(WordIndex i = 0; i < firstNum_ && i < trgVocab_->size(); ++i)
-      indexSet.insert(i);
+// Lexical shortlist that has been pruned beforehand and converted with marian-conv --shortlist.
+// The file holds a CSR layout, i.e. for every source word index the sorted list of target word
+// indices it translates to. It is memory-mapped and used in place, so loading is nearly free and
+// processes on the same host share the physical pages.
+class BinaryShortlistGenerator : public ShortlistGenerator {
+private:
+  struct Header {
+    uint64_t magic;    // BINARY_SHORTLIST_MAGIC
+    uint64_t firstNum; // number of most frequent target words that are always included
+    uint64_t bestNum;  // maximum number of translations per source word kept while pruning
+    uint64_t numSrc;   // number of source words, there are numSrc + 1 offsets
+    uint64_t numTrg;   // total number of target word indices
+    uint64_t srcVocabSize; // sizes of the vocabularies the shortlist has been converted with
+    uint64_t trgVocabSize;
+  };
+
+  static const uint64_t BINARY_SHORTLIST_MAGIC = 0x323054534C4E524DULL; // "MRNLST02" when read little-endian
+  static const uint64_t BINARY_SHORTLIST_MAGIC_MASK = 0x0000FFFFFFFFFFFFULL; // "MRNLST" of all versions
 
-    // add all words from ground truth
-    // for(auto i : trgBatch->data())
-    //  indexSet.insert(i.toWordIndex());
-
-    // collect unique words form source
-    std::unordered_set<WordIndex> srcSet;
-    for(auto i : srcBatch->data())
-      srcSet.insert(i.toWordIndex());
-
-    // add aligned target words
-    for(auto i : srcSet) {
-      if(shared_)
-        indexSet.insert(i);
-      for(auto& it : data_[i])
-        indexSet.insert(it.first);
-    }
-    // Ensure that the generated vocabulary items from a shortlist are a multiple-of-eight
-    // This is necessary until intgemm supports non-multiple-of-eight matrices.
-    // TODO better solution here? This could potentially be slow.
-    WordIndex i = static_cast<WordIndex>(firstNum_);
-    while (indexSet.size() % 8 != 0) {
-      indexSet.insert(i);
-      i++;
-    }
+  Ptr<const Vocab> srcVocab_;
+  Ptr<const Vocab> trgVocab_;
 
-    // turn into vector and sort (selected indices)
-    std::vector<WordIndex> indices(indexSet.begin(), indexSet.end());
-    std::sort(indices.begin(), indices.end());
+  size_t srcIdx_;
+  bool shared_{false};
 
-    return New<Shortlist>(indices);
-  }
+  mio::mmap_source mmap_;
+
+  const Header* header_{nullptr};
+  const uint64_t* offsets_{nullptr}; // [WordIndex src] -> begin of its translations in trgIds_, numSrc + 1 entries
+  const WordIndex* trgIds_{nullptr}; // sorted target word indices, numTrg entries
+
+public:
+  BinaryShortlistGenerator(Ptr<Options> options,
+                           Ptr<const Vocab> srcVocab,
+                           Ptr<const Vocab> trgVocab,
+                           size_t srcIdx = 0,
+                           size_t trgIdx = 1,
+                           bool shared = false);
+
+  // Checks the magic number at the beginning of the file, true for all versions of the format
+  static bool isBinaryShortlist(const std::string& fname);
+
+  // Writes translations in CSR layout, see LexicalShortlistGenerator::index(). The vocabulary sizes
+  // are stored so that the shortlist is not used with other vocabularies.
+  static void save(const std::string& fname,
+                   size_t firstNum,
+                   size_t bestNum,
+                   const std::vector<uint64_t>& offsets,
+                   const std::vector<WordIndex>& trgIds,
+                   size_t srcVocabSize,
+                   size_t trgVocabSize);
+
+  virtual void dump(const std::string& prefix) const override;
+
+  virtual Ptr<Shortlist> generate(Ptr<data::CorpusBatch> batch) const override;
 };
 
+// Creates a BinaryShortlistGenerator if the file given with --shortlist has been converted with
+// marian-conv, otherwise a LexicalShortlistGenerator that reads and prunes the text lex table.
+Ptr<ShortlistGenerator> createShortlistGenerator(Ptr<Options> options,
+                                                 Ptr<const Vocab> srcVocab,
+                                                 Ptr<const Vocab> trgVocab,
+                                                 size_t srcIdx = 0,
+                                                 size_t trgIdx = 1,
+                                                 bool shared = false);
+
 class FakeShortlistGenerator : public ShortlistGenerator {
 private:
   std::vector<WordIndex> indices_;
@@ -1,6 +1,10 @@
 #include "graph/expression_graph.h"
+#include "common/binary.h"
 #include "tensors/tensor_operators.h"
 
+#include "3rd_party/mio/mio.hpp"
+#include "3rd_party/threadpool.h"
+
 #include <sstream>
 
 namespace marian {
@@ -9,6 +13,37 @@ ExpressionGraph::ExpressionGraph(bool inference)
   : inferenceOnly_(inference),
     backend_(nullptr) {}
 
+void ExpressionGraph::loadLazily(const std::string& name, bool markReloaded) {
+  LOG(info, "Loading model from {} on demand", name);
+  // the mapping stays alive until the last conversion that reads from it is done
+  auto file = New<mio::mmap_source>(name);
+  std::vector<io::Item> items;
+  std::vector<size_t> dataLengths;
+  io::binary::loadItemHeaders(file->data(), items, dataLengths);
+
+  setReloaded(false);
+  for(size_t i = 0; i < items.size(); ++i) {
+    auto& item = items[i];
+    // skip over special parameters starting with "special:"
+    if(item.name.substr(0, 8) == "special:")
+      continue;
+
+    size_t dataLength = dataLengths[i];
+    std::shared_future<io::Item> ready = lazyLoadingPool_->enqueue([file, item, dataLength]() {
+      io::Item converted = item;
+      io::binary::materializeItem(converted, dataLength);
+      return converted;
+    }).share();
+
+    // same type rules as load(std::vector<io::Item>&), based on the type after conversion
+    Type itemType = io::binary::materializedType(item.type);
+    auto loadElementType = isSameTypeClass(itemType, defaultElementType_) ? defaultElementType_ : itemType;
+    param(item.name, item.shape, inits::fromFuture(ready, itemType), loadElementType, /*fixed=*/false);
+  }
+  if(markReloaded)
+    setReloaded(true);
+}
+
 void ExpressionGraph::setDevice(DeviceId deviceId, Ptr<Device> device) {
   if(!backend_) {
     backend_ = BackendByDeviceId(deviceId, Config::seed);
@@ -184,6 +219,29 @@ void ExpressionGraph::backward(bool reset, float clipValue) {
 
   tensors_->clearShorttermMemory();
 
+  // number of nodes still to run that write into the gradient of each parameter: its consumers and
+  // the parameter node itself (gradient clipping)
+  std::unordered_map<Chainable<Tensor>*, size_t> pendingWrites;
+  auto isParam = [](const Expr& node) { return node->type() == "param"; };
+  if(gradientReady_) {
+    for(auto& v : nodesBackward_) {
+      if(isParam(v))
+        pendingWrites[v.get()]++;
+      for(auto& child : v->children())
+        if(isParam(child))
+          pendingWrites[child.get()]++;
+    }
+    for(auto kvParams : paramsByElementType_)
+      for(auto p : *kvParams.second)
+        if(pendingWrites.count(p.get()) == 0)
+          gradientReady_(p);
+  }
+
+  auto written = [&](const Expr& node) {
+    if(gradientReady_ && isParam(node) && --pendingWrites[node.get()] == 0)
+      gradientReady_(node);
+  };
+
   bool firstNaN = true;
   while(!nodesBackward_.empty()) {
     auto v = nodesBackward_.back();
@@ -227,6 +285,10 @@ void ExpressionGraph::backward(bool reset, float clipValue) {
       }
     }
 
+    written(v);
+    for(auto&& child : v->children())
+      written(child);
+
     v->children().clear();
   }
 }
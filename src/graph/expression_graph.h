@@ -3,7 +3,9 @@
 #include "common/config.h"
 #include "common/definitions.h"
 
+#include "tensors/allocation_plan.h"
 #include "tensors/backend.h"
+#include "tensors/size_class_allocator.h"
 #include "tensors/tensor_allocator.h"
 
 #include "graph/chainable.h"
@@ -11,6 +13,7 @@
 #include "graph/node_operators.h"
 #include "graph/parameters.h"
 
+#include <algorithm>
 #include <map>
 #include <unordered_set>
 
@@ -19,6 +22,8 @@ namespace marian {
 template <class T, typename... Args>
 Expr Expression(Args&&... args);
 
+class ThreadPool;
+
 class Tensors {
 private:
   Ptr<TensorAllocator> tensors_;
@@ -30,20 +35,70 @@ private:
   Ptr<WeakMemory> shortterm_;
   Ptr<Memory> longterm_;
 
+  // captured allocation plans by key, see ExpressionGraph::startCapture()
+  Ptr<Backend> backend_;
+  size_t maxCaptures_{0};
+  std::unordered_map<size_t, Ptr<AllocationPlan>> plans_;
+  Ptr<AllocationPlan> activePlan_;
+  std::unordered_map<size_t, Ptr<AllocationPlan>> arenaOwners_; // [tag of an arena] -> plan it belongs to
+
+  // replaces tensors_ for forward and backward tensors if set, see ExpressionGraph::setTensorAllocator()
+  Ptr<SizeClassAllocator> sizeClasses_;
+
+  // general allocator stays reserved for temporary buffers of operators, see ExpressionGraph::allocator()
+  const size_t SCRATCH_BYTES = 16 * 1024 * 1024;
+
 public:
   Tensors(Ptr<Backend> backend)
       : tensors_(New<TensorAllocator>(backend)),
         cache_(New<TensorAllocator>(backend)),
         shortterm_(New<WeakMemory>()),
-        longterm_(New<Memory>()) {}
+        longterm_(New<Memory>()),
+        backend_(backend) {}
 
   Tensors(Ptr<Backend> backend, Ptr<Device> device)
       : tensors_(New<TensorAllocator>(backend, device)),
         cache_(New<TensorAllocator>(backend)),
         shortterm_(New<WeakMemory>()),
-        longterm_(New<Memory>()) {}
+        longterm_(New<Memory>()),
+        backend_(backend) {}
+
+  void reserve(size_t bytes) {
+    releaseArenas(); // their memory is part of the workspace
+    if(sizeClasses_) {
+      sizeClasses_->reserve(bytes);
+      tensors_->reserveExact(SCRATCH_BYTES);
+    } else {
+      tensors_->reserve(bytes);
+    }
+  }
 
-  void reserve(size_t bytes) { tensors_->reserve(bytes); }
+  void useSizeClasses(bool sizeClasses) {
+    if(sizeClasses && !sizeClasses_)
+      sizeClasses_ = New<SizeClassAllocator>(backend_);
+    else if(!sizeClasses)
+      sizeClasses_.reset();
+  }
+
+  // Takes the arenas away from a plan, their memory is returned for freeing
+  std::vector<Tensor> releaseArenas(Ptr<AllocationPlan> plan) {
+    for(auto tag : plan->arenaTags())
+      arenaOwners_.erase(tag);
+    return plan->releaseArenas();
+  }
+
+  // Takes the arenas away from all plans without freeing their memory, for when the workspace is reset
+  void releaseArenas() {
+    for(auto& plan : plans_)
+      releaseArenas(plan.second);
+  }
+
+  void freeWorkspace(const Tensor& tensor) {
+    if(sizeClasses_)
+      sizeClasses_->free(tensor);
+    else
+      tensors_->free(tensor);
+  }
 
   void throwAtReallocation(bool throwAtRealloc) {
     tensors_->throwAtReallocation(throwAtRealloc);
@@ -53,17 +108,88 @@ public:
     if(!node->val()) {
       if(node->memoize())
         cache_->allocate(node->val(), node->shape(), node->value_type());
-      else
-        tensors_->allocate(node->val(), node->shape(), node->value_type());
+      else if(!activePlan_ || !activePlan_->allocate(node->val(), node->shape(), node->value_type())) {
+        if(sizeClasses_)
+          sizeClasses_->allocate(node->val(), node->shape(), node->value_type());
+        else
+          tensors_->allocate(node->val(), node->shape(), node->value_type());
+      }
     }
   }
 
   void allocateBackward(Expr node) {
-    if(!node->grad())
-      tensors_->allocate(node->grad(), node->shape(), node->value_type());
+    if(!node->grad()) {
+      if(sizeClasses_)
+        sizeClasses_->allocate(node->grad(), node->shape(), node->value_type());
+      else
+        tensors_->allocate(node->grad(), node->shape(), node->value_type());
+    }
+  }
+
+  void free(const Tensor& tensor) {
+    size_t tag = tensor->memory()->tag();
+    if(tag != 0) {
+      auto it = arenaOwners_.find(tag);
+      if(it != arenaOwners_.end()) {
+        it->second->free(tensor);
+        return;
+      }
+    }
+    if(sizeClasses_ && sizeClasses_->free(tensor))
+      return;
+    if(tag != 0) { // served from an arena that has been released by clear(), the memory may be reused
+      tensor->memory()->set(nullptr, 0);
+      return;
+    }
+    tensors_->free(tensor);
+  }
+
+  const AllocatorStats& getStats() {
+    return sizeClasses_ ? sizeClasses_->stats() : tensors_->allocator()->stats();
+  }
+
+  void setMaxCaptures(size_t maxCaptures) { maxCaptures_ = maxCaptures; }
+
+  void startCapture(size_t key) {
+    if(maxCaptures_ == 0)
+      return;
+
+    auto it = plans_.find(key);
+    if(it == plans_.end()) {
+      if(plans_.size() >= maxCaptures_) { // make room by dropping a plan that has no live tensors
+        auto idle = std::find_if(plans_.begin(), plans_.end(), [](const std::pair<const size_t, Ptr<AllocationPlan>>& kv) {
+          return !kv.second->busy();
+        });
+        if(idle == plans_.end())
+          return;
+        for(auto arena : releaseArenas(idle->second))
+          freeWorkspace(arena);
+        plans_.erase(idle);
+      }
+      it = plans_.insert({key, New<AllocationPlan>(backend_)}).first;
+    }
+
+    activePlan_ = it->second;
+    if(!activePlan_->start()) {
+      // arenas are taken from the workspace, so captures count against --workspace like all tensors
+      Tensor arena;
+      Shape shape({(int)activePlan_->arenaBytes()});
+      if(sizeClasses_)
+        sizeClasses_->allocate(arena, shape, Type::uint8);
+      else
+        tensors_->allocate(arena, shape, Type::uint8);
+      size_t tag = MemoryPiece::newTag();
+      arenaOwners_[tag] = activePlan_;
+      activePlan_->addArena(arena, tag);
+    }
   }
 
-  void free(const Tensor& tensor) { tensors_->free(tensor); }
+  void stopCapture() {
+    if(activePlan_) {
+      activePlan_->stop();
+      activePlan_.reset();
+    }
+  }
 
   Ptr<Allocator>       getAllocator() { return tensors_->allocator(); }
   Ptr<TensorAllocator> getTensorAllocator() { return tensors_; }
@@ -101,7 +227,10 @@ public:
   }
 
   void clear() {
+    releaseArenas(); // recordings are kept, arenas are taken from the workspace again when replaying
     tensors_->clear();
+    if(sizeClasses_)
+      sizeClasses_->clear();
     shortterm_->clear();
   }
 
@@ -138,6 +267,14 @@ private:
 
   bool throwNaN_{false};
 
+  // called by backward() for each parameter as soon as its gradient is final, see setGradientReadyCallback()
+  std::function<void(Expr)> gradientReady_;
+
+  // converts parameters of .bin models in the background, see setLazyLoading()
+  Ptr<ThreadPool> lazyLoadingPool_;
+
+  void loadLazily(const std::string& name, bool markReloaded);
+
 protected:
   // Delete, copy and move constructors
   ExpressionGraph(const ExpressionGraph&) = delete;
@@ -236,6 +373,26 @@ public:
 
   void backward(bool reset = true, float clipValue = 0.f);
 
+  /**
+   * @brief Lets backward() report parameters whose gradients are final.
+   *
+   * During the next backward passes, callback(param) is called for every parameter once all nodes
+   * that contribute to its gradient have run, in reverse topological order; parameters that receive
+   * no gradient are reported at the start. Used to reduce gradients across devices while the rest of
+   * the backward pass is still running. Set an empty function to disable.
+   */
+  void setGradientReadyCallback(const std::function<void(Expr)>& callback) { gradientReady_ = callback; }
+
+  /**
+   * @brief Loads .bin models on demand.
+   *
+   * load() then only maps the file and reads the item headers. Copying and converting the data of
+   * each parameter (e.g. reordering intgemm matrices) is queued on the given pool right away, and
+   * the parameter waits for its result when it is initialized in the first forward pass. Loading
+   * returns immediately and the conversions run in parallel. Other formats are loaded as before.
+   */
+  void setLazyLoading(Ptr<ThreadPool> pool) { lazyLoadingPool_ = pool; }
+
   std::string graphviz() {
     std::stringstream ss;
     ss << "digraph ExpressionGraph {" << std::endl;
@@ -471,6 +628,39 @@ public:
   // Returns the tensor allocator of the graph workspace, different from above as proper tensor objects are allocated
   Ptr<TensorAllocator> getTensorAllocator() { return tensors_->getTensorAllocator(); }
 
+  /**
+   * @brief Allocation replay for computations repeated with the same shapes, e.g. decoder steps.
+   *
+   * Forward allocations between startCapture(key) and stopCapture() are recorded the first time a
+   * key is seen and replayed from an arena on later runs with the same key, see AllocationPlan.
+   * Arenas are taken from the workspace and released again by clear(). Only allocations are
+   * replayed: nodes are still constructed, hashed and executed in every run. At most maxCaptures
+   * keys are kept, 0 (default) disables capturing. Only used in inference mode.
+   */
+  void setMaxCaptures(size_t maxCaptures) { tensors_->setMaxCaptures(maxCaptures); }
+
+  void startCapture(size_t key) {
+    if(inferenceOnly_)
+      tensors_->startCapture(key);
+  }
+
+  void stopCapture() { tensors_->stopCapture(); }
+
+  /**
+   * @brief Selects the allocator for the forward and backward tensors of this graph.
+   *
+   * "default" uses the gap-based Allocator of the workspace, "size-classes" a SizeClassAllocator with
+   * O(1) allocate and free. Has to be called before reserveWorkspaceMB(), which then reserves the
+   * workspace for the selected allocator.
+   */
+  void setTensorAllocator(const std::string& type) {
+    ABORT_IF(type != "default" && type != "size-classes", "Unknown tensor allocator: {}", type);
+    tensors_->useSizeClasses(type == "size-classes");
+  }
+
+  // Allocation counters, peak and reserved memory of the allocator used for forward and backward tensors
+  const AllocatorStats& getAllocatorStats() { return tensors_->getStats(); }
+
   void clear() {
     // clear everything apart from parameters and memoized nodes
     count_ = 0;
@@ -508,6 +698,8 @@ public:
   }
 
   void load(const std::string& name, bool markReloaded = true) {
+    if(lazyLoadingPool_ && io::isBin(name))
+      return loadLazily(name, markReloaded);
     LOG(info, "Loading model from {}", name);
     auto items = io::loadItems(name);
     load(items, markReloaded);
@@ -542,8 +734,11 @@ public:
     }
 
 
-    // pre-populate parameters by type
+    // pre-populate parameters by type, items that could not be mapped (see io::binary::loadItems())
+    // get ordinary parameters when they are added
     for(auto& item : items) {
+      if(!item.mapped)
+        continue;
       auto it1 = paramsByElementType_.find(item.type);
       if(it1 == paramsByElementType_.end()) {
         auto params = New<MappedParameters>(item.type);
@@ -564,7 +759,7 @@ public:
     save(ioItems, saveElementType);
     if(!meta.empty())
       io::addMetaToItems(meta, "special:model.yml", ioItems);
-    io::saveItems(name, ioItems);
+    io::saveItems(name, std::move(ioItems));
   }
 };
 
@@ -510,6 +510,27 @@ Expr bdot(Expr a, Expr b, bool transA, bool transB, float scale) {
   return Expression<DotBatchedNodeOp>(a, b, transA, transB, scale);
 }
 
+Expr attention(Expr q, Expr k, Expr v, Expr mask, float scale) {
+  auto graph = q->graph();
+  bool fused = graph->getDeviceId().type == DeviceType::cpu
+               && graph->isInference()
+               && q->value_type() == Type::float32
+               && k->value_type() == Type::float32
+               && v->value_type() == Type::float32
+               && (!mask || mask->value_type() == Type::float32);
+  if(fused) {
+    std::vector<Expr> nodes = {q, k, v};
+    if(mask)
+      nodes.push_back(atleast_4d(mask));
+    return Expression<FusedAttentionNodeOp>(nodes, scale);
+  }
+
+  auto z = bdot(q, k, false, true, scale);
+  if(mask)
+    z = z + mask;
+  return bdot(softmax(z), v);
+}
+
 static Expr affineDefault(Expr a, Expr b, Expr bias, bool transA, bool transB, float scale) {
   // general version, MKL, CBlas or CUDA
 
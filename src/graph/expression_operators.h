@@ -142,6 +142,12 @@ Expr bdot(Expr a,
           bool transB = false,
           float scalar = 1.f);
 
+// Scaled dot-product attention softmax(scale * q * k^T + mask) * v over the last two axes.
+// q: [.., max q length, dim], k and v: [.., max kv length, dim], mask (additive, optional) broadcasts to
+// [.., max q length, max kv length]. Uses a fused kernel on the CPU in inference mode, otherwise
+// the equivalent composition of bdot and softmax.
+Expr attention(Expr q, Expr k, Expr v, Expr mask = nullptr, float scale = 1.f);
+
 Expr affine(Expr a,
             Expr b,
             Expr c,
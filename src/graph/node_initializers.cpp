@@ -207,6 +207,10 @@ Ptr<NodeInitializer> fromItem(const io::Item& item) {
   }
 }
 
+Ptr<NodeInitializer> fromFuture(std::shared_future<io::Item> item, Type type) {
+  return fromLambda([item](Tensor tensor) { tensor->set(item.get()); }, type);
+}
+
 Ptr<NodeInitializer> fromTensor(Tensor externalTensor) {
   return fromLambda([externalTensor](Tensor t) { t->copyFrom(externalTensor); }, externalTensor->type());
 }
@@ -6,6 +6,7 @@
 #include "tensors/tensor_operators.h"
 
 #include <functional>
+#include <future>
 #include <random>
 
 namespace marian {
@@ -153,6 +154,12 @@ Ptr<NodeInitializer> fromSparseVector(std::pair<std::vector<size_t>, std::vector
 // @TODO: add documentation
 Ptr<NodeInitializer> fromItem(const io::Item& item);
 
+/**
+ * Initialize tensor with an io::Item that is still being prepared, e.g. by lazy loading.
+ * Blocks until it is available. The item has the given type.
+ */
+Ptr<NodeInitializer> fromFuture(std::shared_future<io::Item> item, Type type);
+
 // @TODO: add documentation
 Ptr<NodeInitializer> fromTensor(Tensor tensor);
 
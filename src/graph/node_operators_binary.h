@@ -533,6 +533,63 @@ public:
   const std::string color() override { return "orange"; }
 };
 
+// Fused scaled dot-product attention softmax(scale * q * k^T + mask) * v for inference on the CPU.
+// Streams over the keys with an online softmax, so the [.., max tgt length, max src length]
+// score and weight matrices are never materialized. Use attention() to create it, which falls back
+// to the unfused composition where this node does not apply.
+class FusedAttentionNodeOp : public NaryNodeOp {
+private:
+  float scale_;
+
+public:
+  FusedAttentionNodeOp(const std::vector<Expr>& nodes, float scale)
+      : NaryNodeOp(nodes, nodes[0]->shape()), scale_(scale) {
+    ABORT_IF(nodes.size() != 3 && nodes.size() != 4, "Fused attention expects q, k, v and optionally a mask");
+    auto qShape = nodes[0]->shape();
+    auto kShape = nodes[1]->shape();
+    ABORT_IF(kShape != nodes[2]->shape(),
+             "Keys {} and values {} of fused attention need to have the same shape",
+             std::string(kShape), std::string(nodes[2]->shape()));
+    ABORT_IF(qShape[-1] != kShape[-1],
+             "Queries {} and keys {} of fused attention need to have the same depth",
+             std::string(qShape), std::string(kShape));
+  }
+
+  NodeOps forwardOps() override {
+    return {NodeOp(FusedAttention(val_,
+                                  child(0)->val(),
+                                  child(1)->val(),
+                                  child(2)->val(),
+                                  children().size() > 3 ? child(3)->val() : nullptr,
+                                  scale_))};
+  }
+
+  NodeOps backwardOps() override {
+    ABORT("Fused attention has no gradient, use the unfused composition for training");
+  }
+
+  const std::string type() override { return "fused_attention"; }
+
+  virtual size_t hash() override {
+    size_t seed = NaryNodeOp::hash();
+    util::hash_combine(seed, scale_);
+    return seed;
+  }
+
+  virtual bool equal(Expr node) override {
+    if(!NaryNodeOp::equal(node))
+      return false;
+    auto cnode = std::dynamic_pointer_cast<FusedAttentionNodeOp>(node);
+    if(!cnode)
+      return false;
+    if(scale_ != cnode->scale_)
+      return false;
+    return true;
+  }
+
+  const std::string color() override { return "orange"; }
+};
+
 // Note: To reduce code duplication, we use the same NodeOp for C = op(S) x D and C = D x op(S).
 // Set swapOperands to select the latter.
 class CSRDotNodeOp : public NaryNodeOp {
@@ -96,8 +96,12 @@ namespace marian {
   // used for breakDown() only
   // Index is flattened
   Tensor Logits::getFactoredLogitsTensor(size_t groupIndex) const {
+    return getFactoredLogitsExpr(groupIndex)->val();
+  }
+
+  Expr Logits::getFactoredLogitsExpr(size_t groupIndex) const {
     ABORT_IF(empty(), "Attempted to read out logits on empty Logits object");
-    return logits_[groupIndex]->loss()->val();
+    return logits_[groupIndex]->loss();
   }
 
   // This function assumes that the object holds one or more factor logits, which are summed up
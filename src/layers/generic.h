@@ -131,6 +131,7 @@ public:
     };
     std::vector<MaskedFactorIndices> factorizeWords(const Words& words) const; // breaks encoded Word into individual factor indices
     Tensor getFactoredLogitsTensor(size_t factorGroup) const; // used for breakDown() only
+    Expr getFactoredLogitsExpr(size_t factorGroup) const;     // the node of getFactoredLogitsTensor(), e.g. for gathering breakDown() scores in the graph
     size_t getNumFactorGroups() const { return logits_.size(); }
     bool empty() const { return logits_.empty(); }
     Logits withCounts(const Expr& count) const; // create new Logits with 'count' implanted into all logits_
@@ -3,11 +3,140 @@
 #include "tensors/cpu/prod_blas.h"
 
 #if BLAS_FOUND
-#include "3rd_party/faiss/IndexLSH.h"
+#include "3rd_party/faiss/VectorTransform.h"
 #endif
 
+#include <bitset>
+#include <cstring>
+
 namespace marian {
 
+#if BLAS_FOUND
+namespace {
+
+int codeWords(int nbits) { return (nbits + 63) / 64; }
+
+inline int popcount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(x); // a single popcnt instruction when compiled for the host CPU
+#else
+  return (int)std::bitset<64>(x).count();
+#endif
+}
+
+// Hashes n rows of x [n, dim] into codes [n, codeWords(nbits)]: bit j is set if the j-th
+// coordinate of the (rotated) row is non-negative. Works on chunks of rows to bound the size
+// of the rotated copy.
+void encode(const faiss::RandomRotationMatrix* rotation,
+            const float* x, int n, int dim, int nbits,
+            uint64_t* codes) {
+  const int chunk = 1024;
+  int words = codeWords(nbits);
+
+  std::vector<float> rotated;
+  for(int begin = 0; begin < n; begin += chunk) {
+    int rows = std::min(chunk, n - begin);
+    const float* xt = x + (size_t)begin * dim;
+    if(rotation) {
+      rotated.resize((size_t)rows * nbits);
+      rotation->apply_noalloc(rows, xt, rotated.data());
+      xt = rotated.data();
+    }
+
+    for(int i = 0; i < rows; ++i) {
+      const float* row = xt + (size_t)i * nbits;
+      uint64_t* code = codes + (size_t)(begin + i) * words;
+      std::fill(code, code + words, 0);
+      for(int j = 0; j < nbits; ++j)
+        if(row[j] >= 0)
+          code[j / 64] |= 1ULL << (j % 64);
+    }
+  }
+}
+
+// Writes the indices of the k codes with the smallest Hamming distance to query into ids. Uses a
+// histogram over the possible distances to find the k-th smallest distance in two linear passes
+// instead of a heap, ties at the threshold go to the lower row index.
+void hammingTopK(const uint64_t* query,
+                 const uint64_t* codes, int rows, int words,
+                 int k,
+                 std::vector<uint16_t>& distances,
+                 std::vector<int>& histogram,
+                 IndexType* ids) {
+  distances.resize(rows);
+  histogram.assign(words * 64 + 1, 0);
+
+  for(int r = 0; r < rows; ++r) {
+    const uint64_t* code = codes + (size_t)r * words;
+    int d = 0;
+    for(int w = 0; w < words; ++w)
+      d += popcount(query[w] ^ code[w]);
+    distances[r] = (uint16_t)d;
+    histogram[d]++;
+  }
+
+  int threshold = 0, below = 0;
+  while(below + histogram[threshold] < k)
+    below += histogram[threshold++];
+  int ties = k - below; // number of rows taken at distance == threshold
+
+  for(int r = 0, n = 0; r < rows && n < k; ++r) {
+    if(distances[r] < threshold || (distances[r] == threshold && ties-- > 0))
+      ids[n++] = (IndexType)r;
+  }
+}
+
+Ptr<faiss::RandomRotationMatrix> createRotation(int dim, int nbits) {
+  if(dim == nbits)
+    return nullptr;
+  auto rotation = New<faiss::RandomRotationMatrix>(dim, nbits);
+  rotation->init(5); // same seed as faiss::IndexLSH, codes stored with a model depend on it
+  return rotation;
+}
+
+}  // namespace
+#endif
+
+std::string LSH::indexName(Expr values) {
+  // strip the graph namespace, ExpressionGraph::get() adds it again
+  std::string name = values->name();
+  auto pos = name.rfind("::");
+  if(pos != std::string::npos)
+    name = name.substr(pos + 2);
+  return name + "_lsh";
+}
+
+std::string LSH::outputMatrixName(Ptr<Options> options) {
+  // same choice as DecoderTransformer::lazyCreateOutputLayer(), the embeddings are only tied to the
+  // output with --tied-embeddings or --tied-embeddings-all, --tied-embeddings-src alone does not
+  if(options->get<bool>("tied-embeddings", false) || options->get<bool>("tied-embeddings-all", false))
+    return options->get<bool>("tied-embeddings-all", false) || options->get<bool>("tied-embeddings-src", false)
+               ? "Wemb"
+               : "decoder_Wemb";
+  return "decoder_ff_logit_out_Wt";
+}
+
+Expr LSH::addIndex(Ptr<ExpressionGraph> graph, Expr values, int nbits) {
+#if BLAS_FOUND
+  int dim  = values->shape()[-1];
+  int rows = values->shape().elements() / dim;
+  int words = codeWords(nbits);
+
+  LOG(info, "Computing LSH index for {} with {} rows and {} bits", values->name(), rows, nbits);
+  auto rotation = createRotation(dim, nbits);
+  std::vector<uint64_t> codes((size_t)rows * words);
+  encode(rotation.get(), values->val()->data<float>(), rows, dim, nbits, codes.data());
+
+  // parameters can only be created with index types, store each 64-bit word as two 32-bit words
+  std::vector<IndexType> data(codes.size() * 2);
+  std::memcpy(data.data(), codes.data(), codes.size() * sizeof(uint64_t));
+  return graph->param(indexName(values), {rows, 2 * words}, inits::fromVector(data), Type::uint32);
+#else
+  graph; values; nbits;
+  ABORT("LSH output layer requires a CPU BLAS library");
+#endif
+}
+
 Expr LSH::apply(Expr input, Expr W, Expr b) {
   auto idx = search(input, W);
   return affine(idx, input, W, b);
@@ -21,39 +150,56 @@ Expr LSH::search(Expr query, Expr values) {
   auto kShape = query->shape();
   kShape.set(-1, k_);
 
-  auto forward = [this](Expr out, const std::vector<Expr>& inputs) {
+  std::vector<Expr> nodes = {query, values};
+
+  // codes stored with the model by marian-conv --add-lsh
+  int words = codeWords(nbits_);
+  auto stored = query->graph()->get(indexName(values), Type::uint32);
+  if(stored) {
+    int rows = values->shape().elements() / values->shape()[-1];
+    if(stored->shape()[-2] == rows && stored->shape()[-1] == 2 * words)
+      nodes.push_back(stored);
+    else
+      LOG_ONCE(warn, "Ignoring stored LSH index {} with shape {}, it does not match {} bits", stored->name(), stored->shape(), nbits_);
+  }
+
+  auto forward = [this, words](Expr out, const std::vector<Expr>& inputs) {
     auto query  = inputs[0];
     auto values = inputs[1];
 
-    int dim = values->shape()[-1];
-
-    if(!index_ || indexHash_ != values->hash()) {
-      LOG(info, "Building LSH index for vector dim {} and with hash size {} bits", dim, nbits_);
-      index_.reset(new faiss::IndexLSH(dim, nbits_, 
-                                       /*rotate=*/dim != nbits_, 
-                                       /*train_thesholds*/false));
-      int vRows = values->shape().elements() / dim;
-      index_->train(vRows, values->val()->data<float>());
-      index_->add(  vRows, values->val()->data<float>());
-      indexHash_ = values->hash();
+    int dim   = values->shape()[-1];
+    int vRows = values->shape().elements() / dim;
+    int qRows = query->shape().elements() / dim;
+    ABORT_IF(k_ > vRows, "Cannot select {} nearest neighbors out of {} rows", k_, vRows);
+
+    if(!rotation_ && dim != nbits_)
+      rotation_ = createRotation(dim, nbits_);
+
+    const uint64_t* codes = nullptr;
+    if(inputs.size() > 2) {
+      codes = (const uint64_t*)inputs[2]->val()->data<IndexType>();
+    } else {
+      if(codes_.empty() || indexHash_ != values->hash()) {
+        LOG(info, "Building LSH index for vector dim {} and with hash size {} bits", dim, nbits_);
+        codes_.resize((size_t)vRows * words);
+        encode(rotation_.get(), values->val()->data<float>(), vRows, dim, nbits_, codes_.data());
+        indexHash_ = values->hash();
+      }
+      codes = codes_.data();
     }
 
-    int qRows = query->shape().elements() / dim;
-    std::vector<float> distances(qRows * k_);
-    std::vector<faiss::Index::idx_t> ids(qRows * k_);
-
-    index_->search(qRows, query->val()->data<float>(), k_,
-                   distances.data(), ids.data());
-    
-    std::vector<IndexType> vOut;
-    vOut.reserve(ids.size());
-    for(auto id : ids)
-      vOut.push_back((IndexType)id);
-
-    out->val()->set(vOut);
+    std::vector<uint64_t> queryCodes((size_t)qRows * words);
+    encode(rotation_.get(), query->val()->data<float>(), qRows, dim, nbits_, queryCodes.data());
+
+    std::vector<uint16_t> distances;
+    std::vector<int> histogram;
+    IndexType* ids = out->val()->data<IndexType>();
+    for(int row = 0; row < qRows; ++row)
+      hammingTopK(queryCodes.data() + (size_t)row * words, codes, vRows, words, k_,
+                  distances, histogram, ids + (size_t)row * k_);
   };
 
-  return lambda({query, values}, kShape, Type::uint32, forward);
+  return lambda(nodes, kShape, Type::uint32, forward);
 #else
   query; values;
   ABORT("LSH output layer requires a CPU BLAS library");
@@ -72,24 +218,31 @@ Expr LSH::affine(Expr idx, Expr input, Expr W, Expr b) {
     int dimIn   = inputs[1]->shape()[-1];
     int dimOut  = out->shape()[-1];
     int dimRows = out->shape().elements() / dimOut;
-    
+
     auto outPtr   = out->val()->data<float>();
     auto idxPtr   = inputs[0]->val()->data<uint32_t>();
     auto queryPtr = inputs[1]->val()->data<float>();
     auto WPtr     = inputs[2]->val()->data<float>();
     auto bPtr     = inputs.size() > 3 ? inputs[3]->val()->data<float>() : nullptr; // nullptr if no bias given
 
+    // the k candidate embeddings of a row are gathered into one matrix and scored with a single product
+    std::vector<float> candidates((size_t)k_ * dimIn);
+    std::vector<float> scores(k_);
+
     for(int row = 0; row < dimRows; ++row) {
       auto currIdxPtr    = idxPtr   + row * k_;     // move to next batch of k entries
       auto currQueryPtr  = queryPtr + row * dimIn;  // move to next input query vector
       auto currOutPtr    = outPtr   + row * dimOut; // move to next output position vector (of vocabulary size)
+
+      for(int k = 0; k < k_; k++)
+        std::copy(WPtr + currIdxPtr[k] * dimIn, WPtr + (currIdxPtr[k] + 1) * dimIn, candidates.data() + k * dimIn);
+
+      // [1, dimIn] x [k, dimIn]^T -> [1, k]
+      sgemm(false, true, 1, k_, dimIn, 1.0f, currQueryPtr, dimIn, candidates.data(), dimIn, 0.0f, scores.data(), k_);
+
       for(int k = 0; k < k_; k++) {
-        int relPos = currIdxPtr[k];                   // k-th best vocabulay item
-        auto currWPtr      = WPtr + relPos * dimIn;   // offset for k-th best embedding
-        currOutPtr[relPos] = bPtr ? bPtr[relPos] : 0; // write bias value to position, init to 0 if no bias given
-        
-        // proceed one vector product at a time writing to the correct position
-        sgemm(false, true, 1, 1, dimIn, 1.0f, currQueryPtr, dimIn, currWPtr, dimIn, 1.0f, &currOutPtr[relPos], 1);
+        int relPos = currIdxPtr[k];                                      // k-th best vocabulay item
+        currOutPtr[relPos] = scores[k] + (bPtr ? bPtr[relPos] : 0.f);   // add bias if given
       }
     }
   };
@@ -98,7 +251,7 @@ Expr LSH::affine(Expr idx, Expr input, Expr W, Expr b) {
   if(b) // bias is optional
     nodes.push_back(b);
 
-  return lambda(nodes, 
+  return lambda(nodes,
                 outShape,
                 input->value_type(),
                 forward);
@@ -107,7 +260,7 @@ Expr LSH::affine(Expr idx, Expr input, Expr W, Expr b) {
 // @TODO: alternative version which does the same as above with Marian operators, currently missing "scatter".
 // this uses more memory and likely to be slower. Would make sense to have a scatter node that actually creates
 // the node instead of relying on an existing node, e.g. scatter(shape, defaultValue, axis, indices, values);
-#if 0 
+#if 0
 Expr LSH::affine(Expr idx, Expr input, Expr W, Expr b) {
   int dim  = input->shape()[-1];
   int bch  = idx->shape().elements() / k;
@@ -120,11 +273,11 @@ Expr LSH::affine(Expr idx, Expr input, Expr W, Expr b) {
   int dimVoc  = Wt_->shape()[-2];
   auto oShape = input->shape();
   oShape.set(-1, dimVoc);
-  auto lowest = graph_->constant(oShape, 
-                                 inits::fromValue(NumericLimits<float>(input->value_type()).lowest), 
+  auto lowest = graph_->constant(oShape,
+                                 inits::fromValue(NumericLimits<float>(input->value_type()).lowest),
                                  input->value_type());
   return scatter(lowest, -1, idx, aff);
 }
 #endif
 
-}  // namespace marian
\ No newline at end of file
+}  // namespace marian
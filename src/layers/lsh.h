@@ -2,12 +2,20 @@
 #include <memory>
 
 namespace faiss {
-  struct IndexLSH;
+  struct RandomRotationMatrix;
 }
 
 namespace marian {
 
-class LSH {  
+// Approximate output layer for --output-approx-knn. The rows of the output embedding matrix are
+// hashed into nbits-bit codes (sign bits after a random rotation), each query is hashed the same
+// way, and only the k rows with the smallest Hamming distance to the query code are scored.
+//
+// The codes of the output embeddings are expensive to compute and can be stored with the model by
+// marian-conv --add-lsh. They are looked up as the uint32 parameter "<name of embeddings>_lsh" with
+// shape [rows, 2 * (nbits/64 rounded up)] holding 64-bit words. If the model does not contain them,
+// they are computed on the first forward pass and kept for as long as the embeddings do not change.
+class LSH {
 public:
   LSH(int k, int nbits) : k_{k}, nbits_{nbits} {
 #if !BLAS_FOUND
@@ -17,8 +25,20 @@ public:
 
   Expr apply(Expr query, Expr values, Expr bias);
 
+  // Computes the codes of the rows of values and adds them to the graph as a parameter under the
+  // name that apply() is going to look for. Used by marian-conv to store the index with the model.
+  static Expr addIndex(Ptr<ExpressionGraph> graph, Expr values, int nbits);
+
+  // name of the parameter holding the codes of values, without graph namespace
+  static std::string indexName(Expr values);
+
+  // name of the output matrix of the transformer decoder for the given model options, the matrix
+  // marian-conv --add-lsh indexes
+  static std::string outputMatrixName(Ptr<Options> options);
+
 private:
-  Ptr<faiss::IndexLSH> index_;
+  Ptr<faiss::RandomRotationMatrix> rotation_; // [nbits, dim], none if nbits == dim
+  std::vector<uint64_t> codes_;               // [rows, words] codes of the indexed matrix if not stored with the model
   size_t indexHash_{0};
 
   int k_{100};
@@ -28,4 +48,4 @@ private:
   Expr affine(Expr idx, Expr query, Expr values, Expr bias);
 };
 
-}
\ No newline at end of file
+}
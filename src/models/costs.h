@@ -361,6 +361,14 @@ public:
     return cost_->apply(nextState);
   }
 
+  virtual Ptr<DecoderState> stepPositions(Ptr<ExpressionGraph> graph,
+                                          Ptr<DecoderState> state,
+                                          const Words& words,
+                                          int dimPositions) override {
+    auto nextState = encdec_->stepPositions(graph, state, words, dimPositions);
+    return cost_->apply(nextState);
+  }
+
   virtual Logits build(Ptr<ExpressionGraph> /*graph*/,
                        Ptr<data::CorpusBatch> /*batch*/,
                        bool /*clearGraph*/ = true) override {
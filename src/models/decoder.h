@@ -72,6 +72,18 @@ public:
     state->setTargetHistoryEmbeddings(selectedEmbs);
   }
 
+  // Embeddings of words fed at several consecutive target positions, see IEncoderDecoder::stepPositions()
+  virtual void embeddingsFromPositions(Ptr<ExpressionGraph> graph,
+                                       Ptr<DecoderState> state,
+                                       const Words& words, // [position * dimBatch + batchIndex]
+                                       int dimBatch,
+                                       int dimPositions) {
+    graph_ = graph;
+    auto embeddingLayer = getEmbeddingLayer();
+    int dimEmb = opt<int>("dim-emb");
+    state->setTargetHistoryEmbeddings(embeddingLayer->apply(words, {1, dimPositions, dimBatch, dimEmb}));
+  }
+
   virtual const std::vector<Expr> getAlignments(int /*i*/ = 0) { return {}; }; // [tgt index][beam depth, max src length, batch size, 1]
 
   virtual Ptr<data::Shortlist> getShortlist() { return shortlist_; }
@@ -117,8 +117,10 @@ void EncoderDecoder::createDecoderConfig(const std::string& name) {
   decoder["maxi-batch"] = opt<size_t>("valid-mini-batch") > 1 ? 100 : 1;
   decoder["maxi-batch-sort"] = opt<size_t>("valid-mini-batch") > 1 ? "src" : "none";
 
-  io::OutputFileStream out(name + ".decoder.yml");
-  out << decoder;
+  // with --async-save, handed to the checkpoint writer like the model file
+  std::stringstream yaml;
+  yaml << decoder;
+  io::saveText(name + ".decoder.yml", yaml.str());
 }
 
 Config::YamlNode EncoderDecoder::getModelParameters() {
@@ -205,6 +207,23 @@ Ptr<DecoderState> EncoderDecoder::step(Ptr<ExpressionGraph> graph,
   return nextState;
 }
 
+Ptr<DecoderState> EncoderDecoder::stepPositions(Ptr<ExpressionGraph> graph,
+                                                Ptr<DecoderState> state,
+                                                const Words& words,
+                                                int dimPositions) {
+  // the keys and values of earlier positions are only kept by transformer self-attention, and trained
+  // positional embeddings do not take the position of a decoder step into account
+  ABORT_IF(opt<std::string>("type").find("transformer") == std::string::npos
+               || opt<std::string>("transformer-decoder-autoreg", "self-attention") != "self-attention"
+               || opt<bool>("transformer-train-positions", false),
+           "Decoding several positions at once requires a transformer decoder with self-attention "
+           "and sinusoidal positional embeddings");
+
+  int dimBatch = (int)words.size() / dimPositions;
+  decoders_[0]->embeddingsFromPositions(graph, state, words, dimBatch, dimPositions);
+  return decoders_[0]->step(graph, state);
+}
+
 Ptr<DecoderState> EncoderDecoder::stepAll(Ptr<ExpressionGraph> graph,
                                           Ptr<data::CorpusBatch> batch,
                                           bool clearGraph) {
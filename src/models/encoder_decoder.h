@@ -48,6 +48,17 @@ public:
                                  int beamSize)
       = 0;
 
+  // Runs the decoder for dimPositions consecutive target positions at once with beam size 1, e.g. to
+  // verify words proposed by a draft model. The log-probs of the returned state have one entry per
+  // position: [1, dimPositions, dimBatch, dimVocab]. Positions that are not used afterwards have to
+  // be dropped with DecoderState::truncate().
+  virtual Ptr<DecoderState> stepPositions(Ptr<ExpressionGraph> /*graph*/,
+                                          Ptr<DecoderState> /*state*/,
+                                          const Words& /*words*/, // [position * dimBatch + batchIndex]
+                                          int /*dimPositions*/) {
+    ABORT("Decoding several positions at once is not supported by this model");
+  }
+
   virtual Ptr<Options> getOptions() = 0;
 
   virtual void setShortlistGenerator(
@@ -152,6 +163,11 @@ public:
                                  const std::vector<IndexType>& batchIndices,
                                  int beamSize) override;
 
+  virtual Ptr<DecoderState> stepPositions(Ptr<ExpressionGraph> graph,
+                                          Ptr<DecoderState> state,
+                                          const Words& words,
+                                          int dimPositions) override;
+
   virtual Ptr<DecoderState> stepAll(Ptr<ExpressionGraph> graph,
                                     Ptr<data::CorpusBatch> batch,
                                     bool clearGraph = true);
@@ -83,6 +83,12 @@ public:
     return selectedState;
   }
 
+  // Drops all target positions from the given one on, used to roll back positions that were computed
+  // by IEncoderDecoder::stepPositions() but not accepted. Only supported by transformer decoders.
+  virtual Ptr<DecoderState> truncate(size_t /*position*/) const {
+    ABORT("Truncating the decoder state is not supported by this decoder");
+  }
+
   virtual const rnn::States& getStates() const { return states_; }
 
   virtual Expr getTargetHistoryEmbeddings() const { return targetHistoryEmbeddings_; };
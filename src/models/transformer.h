@@ -117,13 +117,16 @@ public:
     return addPositionalEmbeddings(input, start, trainPosEmbeddings);
   }
 
-  Expr triangleMask(int length) const {
+  // Causal mask for length queries over offset + length keys, where the first offset keys are
+  // positions decoded earlier that every query may attend to.
+  Expr triangleMask(int length, int offset = 0) const {
     // fill triangle mask
-    std::vector<float> vMask(length * length, 0);
+    int dimKeys = offset + length;
+    std::vector<float> vMask(length * dimKeys, 0);
     for(int i = 0; i < length; ++i)
-      for(int j = 0; j <= i; ++j)
-        vMask[i * length + j] = 1.f;
-    return graph_->constant({1, length, length}, inits::fromVector(vMask));
+      for(int j = 0; j <= offset + i; ++j)
+        vMask[i * dimKeys + j] = 1.f;
+    return graph_->constant({1, length, dimKeys}, inits::fromVector(vMask));
   }
 
   // convert multiplicative 1/0 mask to additive 0/-inf log mask, and transpose to match result of bdot() op in Attention()
@@ -239,6 +242,11 @@ public:
 
     // multiplicative attention with flattened softmax
     float scale = 1.0f / std::sqrt((float)dk); // scaling to avoid extreme values due to matrix multiplication
+
+    // without dropout and when the weights are not needed, let attention() pick a fused kernel
+    if(inference_ && !saveAttentionWeights)
+      return attention(q, k, v, mask, scale); // [-4: beam depth * batch size, -3: num heads, -2: max tgt length, -1: split vector dim]
+
     auto z = bdot(q, k, false, true, scale); // [-4: beam depth * batch size, -3: num heads, -2: max tgt length, -1: max src length]
 
     // mask out garbage beyond end of sequences
@@ -259,6 +267,14 @@ public:
     return output;
   }
 
+  // linear transformation of the keys (name = "k") or values (name = "v") of multi-head attention
+  Expr ProjectKeysOrValues(std::string prefix, std::string name, Expr input) {
+    int dimModel = input->shape()[-1];
+    auto W = graph_->param(prefix + "_W" + name, {dimModel, dimModel}, inits::glorotUniform());
+    auto b = graph_->param(prefix + "_b" + name, {1,        dimModel}, inits::zeros());
+    return affine(input, W, b); // [-4: beam depth, -3: batch size, -2: max length, -1: vector dim]
+  }
+
   Expr MultiHead(std::string prefix,
                  int dimOut,
                  int dimHeads,
@@ -267,7 +283,8 @@ public:
                  const Expr &values, // [-4: beam depth, -3: batch size, -2: max kv length, -1: vector dim]
                  const Expr &mask,   // [-4: batch size, -3: num heads broadcast=1, -2: max length broadcast=1, -1: max length]
                  bool cache = false,
-                 bool saveAttentionWeights = false) {
+                 bool saveAttentionWeights = false,
+                 bool projected = false) { // keys and values have already gone through ProjectKeysOrValues()
     int dimModel = q->shape()[-1];
     // @TODO: good opportunity to implement auto-batching here or do something manually?
     auto Wq = graph_->param(prefix + "_Wq", {dimModel, dimModel}, inits::glorotUniform());
@@ -285,10 +302,7 @@ public:
       kh = cache_[prefix + "_keys"];                                                   // then return cached tensor
     }
     else {
-      auto Wk = graph_->param(prefix + "_Wk", {dimModel, dimModel}, inits::glorotUniform());
-      auto bk = graph_->param(prefix + "_bk", {1,        dimModel}, inits::zeros());
-
-      kh = affine(keys, Wk, bk);     // [-4: beam depth, -3: batch size, -2: max length, -1: vector dim]
+      kh = projected ? keys : ProjectKeysOrValues(prefix, "k", keys); // [-4: beam depth, -3: batch size, -2: max length, -1: vector dim]
       kh = SplitHeads(kh, dimHeads); // [-4: batch size, -3: num heads, -2: max length, -1: split vector dim]
       cache_[prefix + "_keys"] = kh;
     }
@@ -299,10 +313,7 @@ public:
         && cache_[prefix + "_values"]->shape().elements() == values->shape().elements()) {
       vh = cache_[prefix + "_values"];
     } else {
-      auto Wv = graph_->param(prefix + "_Wv", {dimModel, dimModel}, inits::glorotUniform());
-      auto bv = graph_->param(prefix + "_bv", {1,        dimModel}, inits::zeros());
-
-      vh = affine(values, Wv, bv); // [-4: batch size, -3: num heads, -2: max length, -1: split vector dim]
+      vh = projected ? values : ProjectKeysOrValues(prefix, "v", values); // [-4: batch size, -3: num heads, -2: max length, -1: split vector dim]
       vh = SplitHeads(vh, dimHeads);
       cache_[prefix + "_values"] = vh;
     }
@@ -358,7 +369,8 @@ public:
                       const Expr& mask,   // [-4: batch size, -3: num heads broadcast=1, -2: max length broadcast=1, -1: max length]
                       int dimHeads,
                       bool cache = false,
-                      bool saveAttentionWeights = false) {
+                      bool saveAttentionWeights = false,
+                      bool projected = false) {
     int dimModel = input->shape()[-1];
 
     float dropProb = inference_ ? 0 : opt<float>("transformer-dropout");
@@ -366,7 +378,7 @@ public:
     auto output = preProcess(prefix + "_Wo", opsPre, input, dropProb);
 
     // multi-head self-attention over previous input
-    output = MultiHead(prefix, dimModel, dimHeads, output, keys, values, mask, cache, saveAttentionWeights);
+    output = MultiHead(prefix, dimModel, dimHeads, output, keys, values, mask, cache, saveAttentionWeights, projected);
     
     auto opsPost = opt<std::string>("transformer-postprocess");
     output = postProcess(prefix + "_Wo", opsPost, output, input, dropProb);
@@ -382,6 +394,24 @@ public:
                                  int startPos) {
     selfMask = transposedLogMask(selfMask);
 
+    // During translation the state holds the already projected keys (output) and values (cell) of
+    // all previous positions, so that only the current position needs to be projected. The state
+    // is reordered along with the hypotheses by TransformerState::select().
+    if(inference_) {
+      auto keys   = ProjectKeysOrValues(prefix, "k", input);
+      auto values = ProjectKeysOrValues(prefix, "v", input);
+      if(startPos > 0) {
+        keys   = concatenate({prevdecoderLayerState.output, keys},   /*axis=*/-2);
+        values = concatenate({prevdecoderLayerState.cell,   values}, /*axis=*/-2);
+      }
+      decoderLayerState.output = keys;
+      decoderLayerState.cell   = values;
+
+      return LayerAttention(prefix, input, keys, values, selfMask,
+                            opt<int>("transformer-heads"), /*cache=*/false,
+                            /*saveAttentionWeights=*/false, /*projected=*/true);
+    }
+
     auto values = input;
     if(startPos > 0) {
       values = concatenate({prevdecoderLayerState.output, input}, /*axis=*/-2);
@@ -626,6 +656,20 @@ public:
     selectedState->setPosition(getPosition());
     return selectedState;
   }
+
+  virtual Ptr<DecoderState> truncate(size_t position) const override {
+    // the keys (output) and values (cell) of the self-attention are [beam depth, batch size, position, vector dim]
+    auto truncateKeysOrValues = [position](Expr kv) {
+      return kv ? slice(kv, /*axis=*/-2, Slice(0, (int)position)) : kv;
+    };
+    std::vector<rnn::State> states;
+    for(const auto& state : states_)
+      states.push_back({truncateKeysOrValues(state.output), truncateKeysOrValues(state.cell)});
+
+    auto truncatedState = New<TransformerState>(rnn::States(states), logProbs_, encStates_, batch_);
+    truncatedState->setPosition(position);
+    return truncatedState;
+  }
 };
 
 class DecoderTransformer : public Transformer<DecoderBase> {
@@ -723,7 +767,9 @@ public:
 
     int dimTrgWords = query->shape()[-2];
     int dimBatch    = query->shape()[-3];
-    auto selfMask = triangleMask(dimTrgWords);  // [ (1,) 1, max length, max length]
+    // several positions decoded at once after earlier ones (see stepPositions()) also attend to those
+    int dimPrevWords = inference_ && dimTrgWords > 1 ? startPos : 0;
+    auto selfMask = triangleMask(dimTrgWords, dimPrevWords);  // [ (1,) 1, max length, previous + max length]
     if(decoderMask) {
       decoderMask = atleast_nd(decoderMask, 4);             // [ 1, max length, batch size, 1 ]
       decoderMask = reshape(transposeTimeBatch(decoderMask),// [ 1, batch size, max length, 1 ]
@@ -875,7 +921,7 @@ public:
       nextState = New<TransformerState>(
         decoderStates, logits, state->getEncoderStates(), state->getBatch());
     }
-    nextState->setPosition(state->getPosition() + 1);
+    nextState->setPosition(state->getPosition() + (inference_ ? dimTrgWords : 1));
     return nextState;
   }
 
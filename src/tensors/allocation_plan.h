@@ -0,0 +1,157 @@
+#pragma once
+
+#include "common/definitions.h"
+#include "tensors/backend.h"
+#include "tensors/tensor.h"
+
+#include <vector>
+
+namespace marian {
+
+// Records the sequence of forward tensor allocations of a computation that is run many times with
+// the same shapes, e.g. one decoder step for a given batch, beam and shortlist size, and replays it
+// on later runs. During a replay the i-th allocation is served from a fixed offset of an arena if it
+// has the same size as in the recorded run, bypassing the gap search and bookkeeping of the general
+// allocator. Allocations that differ in size (e.g. tensors that grow with the output position) are
+// left to the general allocator and do not disturb the other positions.
+//
+// An arena is only reused once all tensors served from it have been freed. Tensors of one step are
+// typically still alive during the next step (decoder states), so a plan ping-pongs between arenas.
+// The memory of the arenas is taken from the workspace by the owner of the plan (see Tensors), which
+// passes it to addArena() when start() finds no idle arena and releases it with releaseArenas().
+// Tensors served from an arena carry its tag (see MemoryPiece::tag()), so the owner can find the plan
+// of a tensor in O(1) when it is freed.
+class AllocationPlan {
+private:
+  struct Arena {
+    Tensor memory;
+    size_t tag;
+    size_t live{0}; // number of tensors currently served from this arena
+  };
+
+  const size_t MAX_ARENAS = 3; // beyond that, replays fall back to the general allocator
+
+  Ptr<Backend> backend_;
+  size_t alignment_;
+
+  std::vector<size_t> sizes_;   // [position] aligned size in bytes of the recorded allocation
+  std::vector<size_t> offsets_; // [position] offset of that allocation within an arena
+  bool recorded_{false};
+
+  std::vector<Arena> arenas_;
+  int current_{-1};     // arena used by the ongoing replay, -1 if not replaying
+  size_t position_{0};  // index of the next allocation in the ongoing run
+
+  size_t alignedSize(size_t size) const {
+    return (size_t)(ceil(size / (double)alignment_) * alignment_);
+  }
+
+public:
+  AllocationPlan(Ptr<Backend> backend, size_t alignment = 256)
+      : backend_(backend), alignment_(alignment) {}
+
+  // Begins a run. The first run is recorded, later runs replay the recorded plan from an idle arena.
+  // Returns false if the plan is recorded, has no idle arena and may get another one with addArena().
+  bool start() {
+    position_ = 0;
+    current_ = -1;
+    if(!recorded_)
+      return true;
+
+    for(size_t i = 0; i < arenas_.size(); ++i) {
+      if(arenas_[i].live == 0) {
+        current_ = (int)i;
+        return true;
+      }
+    }
+    return arenas_.size() >= MAX_ARENAS;
+  }
+
+  // bytes of memory an arena needs
+  size_t arenaBytes() const { return offsets_.empty() ? alignment_ : offsets_.back() + sizes_.back(); }
+
+  // Adds an arena of arenaBytes() and replays the ongoing run from it
+  void addArena(Tensor memory, size_t tag) {
+    ABORT_IF(memory->memory()->size() < arenaBytes(), "Arena of allocation plan is too small");
+    Arena arena;
+    arena.memory = memory;
+    arena.tag = tag;
+    arenas_.push_back(arena);
+    current_ = (int)arenas_.size() - 1;
+  }
+
+  // Removes all arenas and returns their memory. Tensors still served from them are not freed here.
+  std::vector<Tensor> releaseArenas() {
+    std::vector<Tensor> memory;
+    for(auto& arena : arenas_)
+      memory.push_back(arena.memory);
+    arenas_.clear();
+    current_ = -1;
+    return memory;
+  }
+
+  // tags of the memory served from the arenas
+  std::vector<size_t> arenaTags() const {
+    std::vector<size_t> tags;
+    for(auto& arena : arenas_)
+      tags.push_back(arena.tag);
+    return tags;
+  }
+
+  void stop() {
+    if(!recorded_) {
+      size_t offset = 0;
+      for(auto size : sizes_) {
+        offsets_.push_back(offset);
+        offset += size;
+      }
+      recorded_ = true;
+    }
+    current_ = -1;
+  }
+
+  // Returns true if the allocation could be served from the plan, otherwise the caller has to
+  // use the general allocator.
+  bool allocate(/*out*/ Tensor& t, Shape shape, Type type) {
+    size_t bytes = alignedSize(requiredBytes(shape, type));
+    size_t position = position_++;
+
+    if(!recorded_) {
+      sizes_.push_back(bytes);
+      return false;
+    }
+
+    if(current_ < 0 || position >= sizes_.size() || sizes_[position] != bytes)
+      return false;
+
+    auto& arena = arenas_[current_];
+    auto mem = MemoryPiece::New(arena.memory->memory()->data() + offsets_[position], bytes);
+    mem->setTag(arena.tag);
+    t = Tensor(TensorBase::New(mem, shape, type, backend_));
+    arena.live++;
+    return true;
+  }
+
+  // Releases a tensor served from one of the arenas, found by its tag
+  void free(const Tensor& t) {
+    for(auto& arena : arenas_) {
+      if(arena.tag == t->memory()->tag()) {
+        ABORT_IF(arena.live == 0, "Freeing tensor from allocation plan arena without live tensors??");
+        arena.live--;
+        t->memory()->set(nullptr, 0);
+        return;
+      }
+    }
+    ABORT("Tensor has not been served by this allocation plan");
+  }
+
+  // true if some tensors served by this plan are still alive
+  bool busy() const {
+    for(auto& arena : arenas_)
+      if(arena.live > 0)
+        return true;
+    return false;
+  }
+};
+
+}  // namespace marian
@@ -4,6 +4,7 @@
 #include <deque>
 #include <memory>
 #include <set>
+#include <sstream>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -33,6 +34,42 @@ public:
   virtual const char* what() const noexcept override { return message_; }
 };
 
+// Counters kept by the tensor allocators, see ExpressionGraph::getAllocatorStats()
+struct AllocatorStats {
+  size_t allocs{0};    // number of allocations
+  size_t frees{0};     // number of frees
+  size_t grows{0};     // number of times memory was added (and for Allocator relocated)
+  size_t inUse{0};     // bytes currently handed out for live allocations (aligned)
+  size_t peakInUse{0}; // maximum of inUse
+  size_t reserved{0};  // bytes currently reserved from the device
+
+  void alloc(size_t bytes) {
+    allocs++;
+    inUse += bytes;
+    peakInUse = std::max(peakInUse, inUse);
+  }
+
+  void free(size_t bytes) {
+    frees++;
+    inUse -= bytes;
+  }
+
+  // fraction of the reserved memory that was never needed at the same time, i.e. lost to gaps,
+  // size-class rounding and free lists
+  float fragmentation() const {
+    return reserved > 0 ? 1.f - peakInUse / (float)reserved : 0.f;
+  }
+
+  std::string toString() const {
+    std::stringstream ss;
+    ss << "allocs: " << allocs << ", frees: " << frees << ", grows: " << grows
+       << ", peak: " << peakInUse / (1024 * 1024) << " MB"
+       << ", reserved: " << reserved / (1024 * 1024) << " MB"
+       << ", fragmentation: " << fragmentation();
+    return ss.str();
+  }
+};
+
 class Gap {
 private:
   uint8_t* data_;
@@ -90,12 +127,16 @@ private:
   std::set<Gap> gaps_;
   std::unordered_map<uint8_t*, MemoryPiece::PtrType> allocated_;
 
+  AllocatorStats stats_;
+
   void grow(size_t add) {
     add = alignedSize(add);
     uint8_t* oldData = device_->data();
     size_t oldSize = device_->size();
 
     device_->reserve(oldSize + add);
+    stats_.grows++;
+    stats_.reserved = device_->size();
 
     std::set<Gap> oldGaps;
     gaps_.swap(oldGaps);
@@ -209,6 +250,7 @@ public:
     auto ptr = gap.data();
     auto mp = MemoryPiece::New(ptr, bytes);
     allocated_[ptr] = mp;
+    stats_.alloc(bytes);
     return mp;
   }
 
@@ -224,6 +266,7 @@ public:
     if(it != allocated_.end()) {
       allocated_.erase(ptr);
       insertGap(Gap(ptr, bytes), true);
+      stats_.free(bytes);
       return true;
     }
     return false;
@@ -242,6 +285,8 @@ public:
     gaps_.clear();
     allocated_.clear();
     insertGap({device_->data(), device_->size()}, false);
+    stats_.inUse = 0;
+    stats_.reserved = device_->size();
   }
 
   MemoryPiece::PtrType memory() {
@@ -252,6 +297,8 @@ public:
 
   size_t available() { return available_; }
 
+  const AllocatorStats& stats() const { return stats_; }
+
   DeviceId getDeviceId() { return device_->getDeviceId(); }
 };
 }  // namespace marian
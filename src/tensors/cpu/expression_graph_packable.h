@@ -31,8 +31,13 @@ public:
   void packAndSave(const std::string& name, const std::string& meta, Type gemmElementType = Type::float32, Type saveElementType = Type::float32) {
     std::vector<io::Item> ioItems;
 
-    // sorted by name in std::map
-    for (auto p : params()->getMap()) {
+    // sorted by name in std::map, includes parameters of all element types (e.g. uint32 LSH indices)
+    std::map<std::string, Expr> allParams;
+    for (auto kvParams : paramsByElementType_)
+      for (auto p : kvParams.second->getMap())
+        allParams.insert(p);
+
+    for (auto p : allParams) {
       std::string pName = p.first;
 
       if (!namespace_.empty()) {
@@ -252,7 +257,8 @@ public:
         ABORT_IF(saveElementType != Type::float32, "We currently do not know how to save matrices as {}", saveElementType);
         io::Item item;
         val->get(item, pName);
-        item.convert(saveElementType);
+        if (isFloat(item.type)) // index types are saved as they are
+          item.convert(saveElementType);
         ioItems.emplace_back(std::move(item));
       }
     }
@@ -446,6 +446,127 @@ void Softmax(Tensor out, Tensor in) {
   }
 }
 
+// Online softmax attention: for every query row keep the running maximum and sum of the
+// exponentiated scores and accumulate the weighted values directly in the output row, rescaling
+// whenever a new maximum is seen. ElementType vectorizes over the depth of a head.
+template <typename ElementType>
+void FusedAttention(Tensor out, Tensor q, Tensor k, Tensor v, Tensor mask, float scale) {
+  using namespace functional;
+  const int width = sizeof(ElementType) / sizeof(float);
+
+  int dimDepth = q->shape()[-1];
+  int dimQuery = q->shape()[-2];
+  int dimKeys  = k->shape()[-2];
+  int dimHeads = q->shape()[-3];
+  int batchQ   = q->shape().elements() / (dimQuery * dimDepth);
+  int batchK   = k->shape().elements() / (dimKeys * dimDepth);
+  // keys and values are broadcast over the beam like in bdot(): in cross-attention the queries are
+  // [beam depth * batch size, heads, ...] (beam-major) while keys and values are [batch size, heads, ...]
+  ABORT_IF(batchQ % batchK != 0,
+           "Fused attention cannot broadcast keys {} over queries {}",
+           std::string(k->shape()), std::string(q->shape()));
+
+  // mask is broadcast over all dimensions of size 1 and over the beam like the keys, see attention()
+  // for the layout; a single key position occurs when decoding a step with cached keys and values
+  int maskBatch = 0, maskHeads = 0, maskQuery = 0, maskKeys = 0;
+  if(mask) {
+    ABORT_IF(mask->shape().size() != 4 || (mask->shape()[-1] != 1 && mask->shape()[-1] != dimKeys),
+             "Fused attention mask {} does not match keys {}",
+             std::string(mask->shape()), std::string(k->shape()));
+    maskBatch = mask->shape()[-4];
+    maskHeads = mask->shape()[-3];
+    maskQuery = mask->shape()[-2];
+    maskKeys  = mask->shape()[-1];
+    ABORT_IF((batchQ / dimHeads) % maskBatch != 0
+             || (maskHeads != 1 && maskHeads != dimHeads)
+             || (maskQuery != 1 && maskQuery != dimQuery),
+             "Fused attention cannot broadcast mask {} over queries {}",
+             std::string(mask->shape()), std::string(q->shape()));
+  }
+
+  int cols = dimDepth / width;
+  const ElementType* pQ = (const ElementType*)q->data();
+  const ElementType* pK = (const ElementType*)k->data();
+  const ElementType* pV = (const ElementType*)v->data();
+  ElementType* pOut = (ElementType*)out->data();
+  const float* pMask = mask ? mask->data() : nullptr;
+
+#pragma omp parallel for
+  for(int bh = 0; bh < batchQ; ++bh) {
+    int b = bh / dimHeads;
+    int h = bh % dimHeads;
+    const ElementType* kb = pK + (bh % batchK) * dimKeys * cols;
+    const ElementType* vb = pV + (bh % batchK) * dimKeys * cols;
+
+    for(int i = 0; i < dimQuery; ++i) {
+      const ElementType* qi = pQ + (bh * dimQuery + i) * cols;
+      ElementType* oi = pOut + (bh * dimQuery + i) * cols;
+
+      const float* mi = nullptr;
+      if(pMask)
+        mi = pMask + (((b % maskBatch) * maskHeads + (maskHeads == 1 ? 0 : h)) * maskQuery
+                      + (maskQuery == 1 ? 0 : i)) * maskKeys;
+
+      for(int d = 0; d < cols; ++d)
+        oi[d] = 0.f;
+
+      float max = -std::numeric_limits<float>::infinity();
+      float sum = 0.f;
+      for(int j = 0; j < dimKeys; ++j) {
+        const ElementType* kj = kb + j * cols;
+        const ElementType* vj = vb + j * cols;
+
+        ElementType dot = 0.f;
+        for(int d = 0; d < cols; ++d)
+          dot = Ops<ElementType>::add(dot, Ops<ElementType>::mul(qi[d], kj[d]));
+        float score = scale * Ops<ElementType>::sumReduce(dot);
+        if(mi)
+          score += mi[maskKeys == 1 ? 0 : j];
+
+        if(score > max) {
+          float correction = std::exp(max - score); // 0 for the first key
+          sum *= correction;
+          ElementType c = correction;
+          for(int d = 0; d < cols; ++d)
+            oi[d] = Ops<ElementType>::mul(oi[d], c);
+          max = score;
+        }
+
+        float weight = std::exp(score - max);
+        sum += weight;
+        ElementType w = weight;
+        for(int d = 0; d < cols; ++d)
+          oi[d] = Ops<ElementType>::add(oi[d], Ops<ElementType>::mul(w, vj[d]));
+      }
+
+      ElementType norm = 1.f / sum;
+      for(int d = 0; d < cols; ++d)
+        oi[d] = Ops<ElementType>::mul(oi[d], norm);
+    }
+  }
+}
+
+void FusedAttention(Tensor out, Tensor q, Tensor k, Tensor v, Tensor mask, float scale) {
+  matchOrAbort<float>(out->type());
+  matchOrAbort<float>(q->type());
+  matchOrAbort<float>(k->type());
+  matchOrAbort<float>(v->type());
+  if(mask)
+    matchOrAbort<float>(mask->type());
+
+#ifdef __AVX__
+  if(q->shape()[-1] % 8 == 0) {
+    FusedAttention<float32x8>(out, q, k, v, mask, scale);
+    return;
+  }
+#endif
+  if(q->shape()[-1] % 4 == 0) {
+    FusedAttention<float32x4>(out, q, k, v, mask, scale);
+  } else {
+    FusedAttention<float>(out, q, k, v, mask, scale);
+  }
+}
+
 
 template <typename ElementType>
 void LogSoftmax(Tensor out, Tensor in) {
@@ -2,6 +2,7 @@
 
 #include "common/definitions.h"
 
+#include <atomic>
 #include <iostream>
 
 namespace marian {
@@ -10,6 +11,7 @@ class MemoryPiece {
 private:
   uint8_t* data_;
   size_t size_;
+  size_t tag_{0}; // identifies the allocator that handed out the memory, see tag()
 
   ENABLE_INTRUSIVE_PTR(MemoryPiece)
   
@@ -48,6 +50,17 @@ public:
 
   void setPtr(uint8_t* data) { data_ = data; }
 
+  // Set by SizeClassAllocator and AllocationPlan to find out in O(1) whether they own the memory
+  // when it is freed. 0 for memory of the other allocators, other tags are taken from newTag().
+  size_t tag() const { return tag_; }
+  void setTag(size_t tag) { tag_ = tag; }
+
+  // a tag that has not been handed out before in this process
+  static size_t newTag() {
+    static std::atomic<size_t> counter{0};
+    return ++counter;
+  }
+
   friend std::ostream& operator<<(std::ostream& out, const MemoryPiece mp) {
     out << "MemoryPiece - ptr: " << std::hex << (size_t)mp.data() << std::dec
         << " size: " << mp.size();
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "common/definitions.h"
+#include "tensors/allocator.h"
+#include "tensors/backend.h"
+#include "tensors/device.h"
+#include "tensors/tensor.h"
+
+#include <vector>
+
+namespace marian {
+
+// Alternative to Allocator for the tensors of a graph, selected with --tensor-allocator size-classes.
+// Allocation sizes are rounded up to size classes (four classes per power of two, so at most 25%
+// padding) and freed blocks are kept in one free list per class. A request is served from the free
+// list of its class or a few larger ones or, if those are empty, bumped off the current slab. Both allocate and free are
+// O(1) without the tree and hash map operations of Allocator. Slabs are never resized, so memory
+// of live tensors never moves; when a slab is full another one is added, and clear() merges all
+// slabs into one so that the steady state is a single slab. Memory handed out is tagged with the
+// generation of the allocator, which changes with every clear(), so that tensors which outlive a
+// clear() (e.g. cached keys and values released after the graph) are not put on a free list again.
+class SizeClassAllocator {
+private:
+  struct Slab {
+    Ptr<Device> device;
+    size_t used{0}; // bump offset
+  };
+
+  Ptr<Backend> backend_;
+  size_t step_;
+  size_t alignment_;
+
+  std::vector<Slab> slabs_;
+  size_t current_{0}; // slab the next bump allocation is taken from
+
+  std::vector<std::vector<uint8_t*>> freeLists_; // [size class] blocks ready for reuse
+
+  size_t generation_; // tag of the memory handed out since the last clear(), see MemoryPiece::tag()
+
+  AllocatorStats stats_;
+
+  // Larger classes to look at when the free list of a class is empty, 16 classes are four powers of
+  // two. Lets tensors that grow with the output length reuse blocks of earlier, shorter ones.
+  const size_t MAX_CLASS_STEPS = 16;
+
+  // Size classes in units of alignment: 1, 2, 3, 4, then four classes per power of two,
+  // e.g. 5, 6, 7, 8, 10, 12, 14, 16, 20, 24, ...
+  static size_t msb(size_t v) {
+    size_t k = 0;
+    while(v >>= 1)
+      k++;
+    return k;
+  }
+
+  static size_t classIndex(size_t units) {
+    if(units <= 4)
+      return units - 1;
+    size_t v = units - 1;
+    size_t k = msb(v);
+    size_t i = (v >> (k - 2)) & 3;
+    return 4 + (k - 2) * 4 + i;
+  }
+
+  static size_t classUnits(size_t index) {
+    if(index < 4)
+      return index + 1;
+    size_t k = (index - 4) / 4 + 2;
+    size_t i = (index - 4) % 4;
+    return (4 + i + 1) << (k - 2);
+  }
+
+  size_t alignedSize(size_t size) const {
+    return (size_t)(ceil(size / (double)alignment_) * alignment_);
+  }
+
+  void addSlab(size_t bytes) {
+    Slab slab;
+    slab.device = DispatchDevice(backend_->getDeviceId(), alignment_);
+    slab.device->reserve(alignedSize(bytes));
+    slabs_.push_back(slab);
+    stats_.reserved += slab.device->size();
+  }
+
+  uint8_t* bump(size_t bytes) {
+    while(current_ < slabs_.size() && slabs_[current_].device->size() - slabs_[current_].used < bytes)
+      current_++;
+    if(current_ == slabs_.size()) {
+      addSlab(std::max(step_, bytes));
+      stats_.grows++;
+    }
+
+    auto& slab = slabs_[current_];
+    uint8_t* ptr = slab.device->data() + slab.used;
+    slab.used += bytes;
+    return ptr;
+  }
+
+public:
+  SizeClassAllocator(Ptr<Backend> backend, size_t step = 64 * 1024 * 1024, size_t alignment = 256)
+      : backend_(backend), step_(step), alignment_(alignment), generation_(MemoryPiece::newTag()) {}
+
+  // Replaces all slabs by a single one of the given size. Invalidates all tensors.
+  void reserve(size_t bytes) {
+    slabs_.clear();
+    stats_.reserved = 0;
+    if(bytes > 0)
+      addSlab(bytes);
+    clear();
+  }
+
+  void allocate(/*out*/ Tensor& t, Shape shape, Type type = Type::float32) {
+    if(t && t->shape() == shape)
+      return;
+
+    size_t bytes = alignedSize(requiredBytes(shape, type));
+    size_t index = classIndex(std::max(bytes / alignment_, (size_t)1));
+    if(index >= freeLists_.size())
+      freeLists_.resize(index + 1);
+
+    // Take a free block of this class or of one of the next larger ones before taking new memory
+    // from the slab. The block keeps its class when it is freed again.
+    uint8_t* ptr = nullptr;
+    for(size_t i = index; i < std::min(index + MAX_CLASS_STEPS + 1, freeLists_.size()) && !ptr; ++i) {
+      if(!freeLists_[i].empty()) {
+        ptr = freeLists_[i].back();
+        freeLists_[i].pop_back();
+        index = i;
+      }
+    }
+    if(!ptr)
+      ptr = bump(classUnits(index) * alignment_);
+
+    bytes = classUnits(index) * alignment_;
+    stats_.alloc(bytes);
+    auto mem = MemoryPiece::New(ptr, bytes);
+    mem->setTag(generation_);
+    t = Tensor(TensorBase::New(mem, shape, type, backend_));
+  }
+
+  // Returns false if the tensor has not been allocated here. Tensors allocated before the last
+  // clear() are only detached from their memory, which may be in use by other tensors by now.
+  bool free(const Tensor& t) {
+    auto mem = t->memory();
+    if(mem->tag() == 0)
+      return false;
+    if(mem->tag() != generation_) {
+      mem->set(nullptr, 0);
+      return true;
+    }
+
+    uint8_t* ptr = mem->data();
+    size_t bytes = mem->size();
+    freeLists_[classIndex(std::max(bytes / alignment_, (size_t)1))].push_back(ptr);
+    stats_.free(bytes);
+    mem->set(nullptr, 0);
+    return true;
+  }
+
+  // Forgets all allocations. If the last run needed more than one slab, they are merged into one.
+  void clear() {
+    if(slabs_.size() > 1) {
+      size_t total = stats_.reserved;
+      slabs_.clear();
+      stats_.reserved = 0;
+      addSlab(total);
+    }
+    for(auto& slab : slabs_)
+      slab.used = 0;
+    current_ = 0;
+    for(auto& freeList : freeLists_)
+      freeList.clear();
+    stats_.inUse = 0;
+    generation_ = MemoryPiece::newTag();
+  }
+
+  const AllocatorStats& stats() const { return stats_; }
+};
+
+}  // namespace marian
@@ -333,6 +333,27 @@ static inline float L2Norm(marian::Tensor in, Ptr<Allocator> allocator) {
     return cpu::L2Norm(in, allocator);
 }
 
+// Fused scaled dot-product attention, only implemented for the CPU backend
+namespace cpu {
+void FusedAttention(marian::Tensor out,
+                    const marian::Tensor q,
+                    const marian::Tensor k,
+                    const marian::Tensor v,
+                    const marian::Tensor mask,
+                    float scale);
+}
+
+static inline void FusedAttention(marian::Tensor out,
+                                  const marian::Tensor q,
+                                  const marian::Tensor k,
+                                  const marian::Tensor v,
+                                  const marian::Tensor mask,
+                                  float scale) {
+  ABORT_IF(out->getBackend()->getDeviceId().type != DeviceType::cpu,
+           "Fused attention is only implemented for the CPU backend");
+  cpu::FusedAttention(out, q, k, v, mask, scale);
+}
+
 // clang-format off
 DISPATCH5(PoolingWithMaskingForward, marian::Tensor, marian::Tensor, marian::Tensor, int, bool)
 DISPATCH6(PoolingWithMaskingBackward, marian::Tensor, marian::Tensor, marian::Tensor, marian::Tensor, int, bool)
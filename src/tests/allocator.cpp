@@ -0,0 +1,84 @@
+#include "marian.h"
+#include "common/timer.h"
+#include "tensors/size_class_allocator.h"
+
+// Replays the tensor allocations of a transformer decoding workload against the default and the
+// size-class allocator: per step a number of short-lived temporaries is allocated and freed in
+// order of creation, while the decoder states of a step (growing with the output position) live
+// until the end of the next step.
+int main(int /*argc*/, char** /*argv*/) {
+  using namespace marian;
+
+  createLoggers();
+
+  const int batches = 50, steps = 50, layers = 6;
+  const int beamBatch = 5 * 16, dimModel = 512, dimFfn = 2048, dimVoc = 32000, heads = 8;
+
+  auto backend = BackendByDeviceId({0, DeviceType::cpu}, 1234);
+
+  auto run = [&](const std::string& name,
+                 std::function<void(Tensor&, Shape)> allocate,
+                 std::function<void(Tensor&)> free,
+                 std::function<void()> clear,
+                 std::function<const AllocatorStats&()> stats) {
+    timer::Timer timer;
+    for(int b = 0; b < batches; ++b) {
+      std::vector<Tensor> states;
+      for(int t = 1; t <= steps; ++t) {
+        std::vector<Tensor> temps, newStates;
+        for(int l = 0; l < layers; ++l) {
+          // self-attention over t positions, keys and values are kept as decoder state
+          for(auto shape : std::vector<Shape>({{beamBatch, dimModel},
+                                               {beamBatch, heads, 1, t},
+                                               {beamBatch, heads, 1, t},
+                                               {beamBatch, dimModel},
+                                               {beamBatch, dimModel},
+                                               {beamBatch, dimFfn},
+                                               {beamBatch, dimFfn},
+                                               {beamBatch, dimModel}})) {
+            temps.emplace_back();
+            allocate(temps.back(), shape);
+          }
+          for(int kv = 0; kv < 2; ++kv) {
+            newStates.emplace_back();
+            allocate(newStates.back(), {beamBatch, t, dimModel});
+          }
+        }
+        temps.emplace_back();
+        allocate(temps.back(), {beamBatch, dimVoc}); // logits
+
+        for(auto& tensor : temps)
+          free(tensor);
+        for(auto& tensor : states)
+          free(tensor);
+        states = newStates;
+      }
+      for(auto& tensor : states)
+        free(tensor);
+      clear();
+    }
+    LOG(info, "[{}] {:.3f}s, {}", name, timer.elapsed(), stats().toString());
+  };
+
+  {
+    auto alloc = New<TensorAllocator>(backend);
+    alloc->reserve(512 * 1024 * 1024);
+    run("default",
+        [&](Tensor& t, Shape shape) { alloc->allocate(t, shape); },
+        [&](Tensor& t) { alloc->free(t); },
+        [&]() { alloc->clear(); },
+        [&]() -> const AllocatorStats& { return alloc->allocator()->stats(); });
+  }
+
+  {
+    auto alloc = New<SizeClassAllocator>(backend);
+    alloc->reserve(512 * 1024 * 1024);
+    run("size-classes",
+        [&](Tensor& t, Shape shape) { alloc->allocate(t, shape); },
+        [&](Tensor& t) { alloc->free(t); },
+        [&]() { alloc->clear(); },
+        [&]() -> const AllocatorStats& { return alloc->stats(); });
+  }
+
+  return 0;
+}
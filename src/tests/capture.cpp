@@ -0,0 +1,80 @@
+#include "marian.h"
+#include "common/timer.h"
+
+// Times decoder-step-like computations with and without allocation replay (--capture-steps), see
+// ExpressionGraph::startCapture(). Each step runs a stack of feed-forward blocks with layer
+// normalization and an output layer on a [beam * batch, model] input with the same shapes every
+// step, and its output stays alive during the next step like decoder states. Both runs have to
+// produce the same values; the time per step and the allocator statistics are logged.
+int main(int /*argc*/, char** /*argv*/) {
+  using namespace marian;
+
+  createLoggers();
+
+  const int batches = 20, steps = 50, layers = 6;
+  const int beamBatch = 4 * 8, dimModel = 256, dimFfn = 1024, dimVoc = 8000;
+
+  auto run = [&](size_t maxCaptures) {
+    Config::seed = 1234;
+    auto graph = New<ExpressionGraph>(/*inference=*/true);
+    graph->setDevice({0, DeviceType::cpu});
+    graph->reserveWorkspaceMB(512);
+    graph->setMaxCaptures(maxCaptures);
+
+    std::vector<Expr> W1, b1, W2, b2, gamma, beta;
+    for(int l = 0; l < layers; ++l) {
+      auto prefix = "l" + std::to_string(l);
+      W1.push_back(graph->param(prefix + "_W1", {dimModel, dimFfn}, inits::glorotUniform()));
+      b1.push_back(graph->param(prefix + "_b1", {1, dimFfn}, inits::zeros()));
+      W2.push_back(graph->param(prefix + "_W2", {dimFfn, dimModel}, inits::glorotUniform()));
+      b2.push_back(graph->param(prefix + "_b2", {1, dimModel}, inits::zeros()));
+      gamma.push_back(graph->param(prefix + "_gamma", {1, dimModel}, inits::ones()));
+      beta.push_back(graph->param(prefix + "_beta", {1, dimModel}, inits::zeros()));
+    }
+    auto Wout = graph->param("Wout", {dimModel, dimVoc}, inits::glorotUniform());
+    auto bout = graph->param("bout", {1, dimVoc}, inits::zeros());
+    graph->forward(); // runs the initializers
+
+    std::vector<float> input(beamBatch * dimModel);
+    for(size_t i = 0; i < input.size(); ++i)
+      input[i] = std::sin(0.1f * i);
+
+    float checksum = 0;
+    timer::Timer timer;
+    for(int b = 0; b < batches; ++b) {
+      graph->clear();
+      auto state = graph->constant({beamBatch, dimModel}, inits::fromVector(input));
+      Expr scores;
+      for(int t = 0; t < steps; ++t) {
+        graph->startCapture(/*key=*/0); // all steps have the same shapes
+        auto x = state;
+        for(int l = 0; l < layers; ++l) {
+          auto h = relu(affine(x, W1[l], b1[l]));
+          x = layerNorm(x + affine(h, W2[l], b2[l]), gamma[l], beta[l]);
+        }
+        scores = logsoftmax(affine(x, Wout, bout));
+        graph->forwardNext();
+        graph->stopCapture();
+        state = x;
+      }
+      std::vector<float> values;
+      scores->val()->get(values);
+      for(auto value : values)
+        checksum += value;
+    }
+    double elapsed = timer.elapsed();
+
+    LOG(info, "[capture-steps {}] {:.3f}s, {:.3f}ms per step, checksum {}, {}",
+        maxCaptures, elapsed, 1000.0 * elapsed / (batches * steps), checksum,
+        graph->getAllocatorStats().toString());
+    return checksum;
+  };
+
+  float withoutCapture = run(0);
+  float withCapture = run(4);
+  if(withoutCapture != withCapture) {
+    LOG(info, "Allocation replay changed the results");
+    return 1;
+  }
+  return 0;
+}
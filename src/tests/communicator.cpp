@@ -0,0 +1,54 @@
+#include "marian.h"
+#include "common/timer.h"
+#include "training/communicator.h"
+
+// Measures the latency of one synchronous update round of the DefaultCommunicator
+// (scatterReduceAndResetGrads() followed by allGatherParams()) for CPU training with a
+// growing number of threads (one graph per thread, as with --cpu-threads N), summing the gradients
+// through temporary tensors and in place. Pass --large to also measure 1 << 24 parameters, which
+// needs about 2 GB of memory with 16 threads.
+int main(int argc, char** argv) {
+  using namespace marian;
+
+  createLoggers();
+
+  std::vector<int> sizes = {1 << 16, 1 << 20};
+  if(argc > 1 && std::string(argv[1]) == "--large")
+    sizes.push_back(1 << 24);
+
+  for(int numParams : sizes) {
+    for(size_t numThreads : {1, 2, 4, 8, 16}) {
+      std::vector<Ptr<ExpressionGraph>> graphs;
+      for(size_t i = 0; i < numThreads; ++i) {
+        auto graph = New<ExpressionGraph>();
+        graph->setDevice({i, DeviceType::cpu});
+        graph->reserveWorkspaceMB(8);
+        graph->param("W", {1, numParams}, inits::ones());
+        graph->forward();
+        graph->params()->allocateBackward();
+        graph->params()->set_zero_adjoint();
+        graphs.push_back(graph);
+      }
+
+      // sharedMemory = false is the copy through temporary tensors used before the in-place sum
+      for(bool sharedMemory : {false, true}) {
+        auto comm = New<DefaultCommunicator>(graphs, /*mpi=*/nullptr, sharedMemory);
+
+        int iterations = numParams > (1 << 20) ? 10 : 100;
+        comm->scatterReduceAndResetGrads(); // warm-up, creates threads
+        comm->allGatherParams();
+
+        timer::Timer timer;
+        for(int i = 0; i < iterations; ++i) {
+          comm->scatterReduceAndResetGrads();
+          comm->allGatherParams();
+        }
+        LOG(info, "params: {}, threads: {}, {}: update latency: {:.1f} us",
+            numParams, numThreads, sharedMemory ? "in place" : "copy",
+            timer.elapsed<std::chrono::microseconds>() / iterations);
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include "marian.h"
+#include "common/timer.h"
+#include "translator/decoder_worker_pool.h"
+
+#include "3rd_party/threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+
+// Compares the persistent DecoderWorkerPool with the previous way of decoding a request, a
+// ThreadPool created for every call to run() and destroyed at its end. A request consists of a few
+// batches, each batch of a fixed amount of arithmetic standing in for a decoder run, so that the
+// measurements mostly reflect the cost of thread creation and scheduling.
+//   latency:    requests are sent one after the other, the time per request is logged (mean, p50, p99)
+//   throughput: several clients send requests concurrently, requests per second are logged
+// Usage: ./test_decoder_worker_pool [workers=4] [requests=2000] [clients=8]
+int main(int argc, char** argv) {
+  using namespace marian;
+
+  createLoggers();
+
+  const size_t workers  = argc > 1 ? std::stoul(argv[1]) : 4;
+  const size_t requests = argc > 2 ? std::stoul(argv[2]) : 2000;
+  const size_t clients  = argc > 3 ? std::stoul(argv[3]) : 8;
+  ABORT_IF(workers == 0 || requests == 0 || clients == 0, "Workers, requests and clients have to be positive");
+  ABORT_IF(clients > requests, "Cannot send {} requests from {} clients", requests, clients);
+  const size_t batchesPerRequest = 2;
+  const size_t workPerBatch = 50000; // multiply-adds, roughly 50 microseconds
+
+  std::atomic<size_t> sink{0}; // keeps the compiler from removing the work
+  auto decode = [&](size_t /*workerId*/) {
+    float acc = 0.f;
+    for(size_t i = 0; i < workPerBatch; ++i)
+      acc = acc * 0.999f + (float)(i & 7);
+    sink += (size_t)acc;
+  };
+
+  // one request with a pool of its own, as before
+  auto perCallPool = [&]() {
+    ThreadPool pool(workers, workers);
+    for(size_t b = 0; b < batchesPerRequest; ++b)
+      pool.enqueue(decode, b);
+  };
+
+  // one request with the shared persistent pool, completion is tracked per request since other
+  // clients may be using the pool at the same time
+  DecoderWorkerPool persistent(workers);
+  auto persistentPool = [&]() {
+    auto pending = New<std::atomic<size_t>>(batchesPerRequest);
+    auto done = New<std::promise<void>>();
+    auto finished = done->get_future();
+    for(size_t b = 0; b < batchesPerRequest; ++b)
+      persistent.enqueue([&decode, pending, done](size_t id) {
+        decode(id);
+        if(--(*pending) == 0)
+          done->set_value();
+      });
+    finished.wait();
+  };
+
+  auto latency = [&](const std::string& name, std::function<void()> request) {
+    std::vector<double> times;
+    for(size_t r = 0; r < requests; ++r) {
+      timer::Timer timer;
+      request();
+      times.push_back(timer.elapsed() * 1e6);
+    }
+    std::sort(times.begin(), times.end());
+    double mean = 0;
+    for(auto t : times)
+      mean += t / times.size();
+    LOG(info, "[latency] {}: mean {:.1f}us, p50 {:.1f}us, p99 {:.1f}us",
+        name, mean, times[times.size() / 2], times[times.size() * 99 / 100]);
+  };
+
+  auto throughput = [&](const std::string& name, std::function<void()> request) {
+    timer::Timer timer;
+    std::vector<std::thread> threads;
+    for(size_t c = 0; c < clients; ++c)
+      threads.emplace_back([&]() {
+        for(size_t r = 0; r < requests / clients; ++r)
+          request();
+      });
+    for(auto& thread : threads)
+      thread.join();
+    LOG(info, "[throughput] {}: {:.0f} requests/s with {} clients",
+        name, (requests / clients) * clients / timer.elapsed(), clients);
+  };
+
+  LOG(info, "{} workers, {} requests of {} batches", workers, requests, batchesPerRequest);
+  latency("per-call ThreadPool", perCallPool);
+  latency("DecoderWorkerPool", persistentPool);
+  throughput("per-call ThreadPool", perCallPool);
+  throughput("DecoderWorkerPool", persistentPool);
+
+  LOG(debug, "Checksum {}", (size_t)sink);
+  return 0;
+}
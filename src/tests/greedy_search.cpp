@@ -0,0 +1,85 @@
+#include "marian.h"
+#include "common/timer.h"
+#include "data/batch_generator.h"
+#include "data/corpus.h"
+#include "translator/beam_search.h"
+#include "translator/greedy_search.h"
+#include "translator/speculative_search.h"
+#include "translator/scorers.h"
+
+// Compares GreedySearch with BeamSearch at beam size 1 on the input of a marian-decoder command line,
+// e.g. ./test_greedy_search -m model.npz -v vocab.spm vocab.spm -i input.txt --cpu-threads 1
+// Both searches decode the same batches with the same graph and scorers; the decoding time of each
+// and the number of sentences whose translations differ are logged. With --speculative-draft, the
+// same is done for SpeculativeSearch.
+int main(int argc, char** argv) {
+  using namespace marian;
+
+  auto options = parseOptions(argc, argv, cli::mode::translation);
+  options->set("inference", true, "shuffle", "none", "beam-size", 1);
+
+  auto corpus = New<data::Corpus>(options, true);
+  auto vocabs = options->get<std::vector<std::string>>("vocabs");
+  auto trgVocab = New<Vocab>(options, vocabs.size() - 1);
+  trgVocab->load(vocabs.back());
+
+  auto graph = New<ExpressionGraph>(true);
+  graph->setDevice(Config::getDevices(options)[0]);
+  graph->reserveWorkspaceMB(options->get<size_t>("workspace"));
+  auto scorers = createScorers(options);
+  for(auto scorer : scorers)
+    scorer->init(graph);
+  Ptr<Scorer> draft;
+  if(SpeculativeSearch::isEnabled(options)) {
+    draft = createDraftScorer(options, trgVocab);
+    draft->init(graph);
+  }
+  graph->forward();
+
+  std::vector<Ptr<data::CorpusBatch>> batches;
+  data::BatchGenerator<data::Corpus> bg(corpus, options);
+  bg.prepare();
+  for(auto batch : bg)
+    batches.push_back(batch);
+
+  // translations of the first run, compared with those of the second
+  std::vector<Words> translations;
+  auto run = [&](const std::string& name, std::function<Histories(Ptr<data::CorpusBatch>)> search) {
+    search(batches.front()); // warm-up
+
+    timer::Timer timer;
+    size_t sentences = 0, words = 0, differences = 0;
+    bool first = translations.empty();
+    for(auto batch : batches) {
+      for(auto history : search(batch)) {
+        auto targetWords = std::get<0>(history->top());
+        if(first)
+          translations.push_back(targetWords);
+        else if(translations[sentences] != targetWords)
+          differences++;
+        sentences++;
+        words += targetWords.size();
+      }
+    }
+    double seconds = timer.elapsed();
+    LOG(info, "{}: {} sentences, {} words in {:.3f}s ({:.1f} words/s), {} different from BeamSearch",
+        name, sentences, words, seconds, words / seconds, differences);
+  };
+
+  run("BeamSearch, beam size 1", [&](Ptr<data::CorpusBatch> batch) {
+    return BeamSearch(options, scorers, trgVocab).search(graph, batch);
+  });
+  run("GreedySearch", [&](Ptr<data::CorpusBatch> batch) {
+    return GreedySearch(options, scorers, trgVocab).search(graph, batch);
+  });
+  if(draft) {
+    auto speculativeScorers = scorers;
+    speculativeScorers.push_back(draft);
+    run("SpeculativeSearch", [&](Ptr<data::CorpusBatch> batch) {
+      return SpeculativeSearch(options, speculativeScorers, trgVocab).search(graph, batch);
+    });
+    SpeculativeSearch::logStatistics();
+  }
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include "marian.h"
+#include "common/timer.h"
+#include "translator/nth_element.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+// Times the n-best selection of beam search on the CPU: NthElementCPU (createGetNBestListFn), the
+// previous std::partial_sort over an index vector of size beam x vocab, and the topk() operator.
+// Usage: ./test_nth_element [beam=6] [vocab=32000] [batch=16] [repeats=200]
+int main(int argc, char** argv) {
+  using namespace marian;
+
+  createLoggers();
+
+  const int beamSize = argc > 1 ? std::stoi(argv[1]) : 6;
+  const int dimVocab = argc > 2 ? std::stoi(argv[2]) : 32000;
+  const int dimBatch = argc > 3 ? std::stoi(argv[3]) : 16;
+  const int repeats  = argc > 4 ? std::stoi(argv[4]) : 200;
+  const int batchOffset = beamSize * dimVocab;
+
+  // log-probabilities of a softmax over random logits, accumulated over the beam
+  std::mt19937 rng(1234);
+  std::normal_distribution<float> normal(0.f, 3.f);
+  std::vector<float> scores((size_t)dimBatch * batchOffset);
+  for(auto& score : scores)
+    score = normal(rng) - 10.f;
+
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(512);
+  auto logProbs = graph->constant({dimBatch, 1, beamSize, dimVocab}, inits::fromVector(scores));
+  graph->forward();
+
+  auto report = [&](const std::string& name, double elapsed, const std::vector<float>& costs) {
+    LOG(info, "[{}] {:.1f}us per batch entry, best score {}",
+        name, 1e6 * elapsed / (repeats * dimBatch), costs.empty() ? 0.f : costs.front());
+  };
+
+  {
+    auto getNBestList = createGetNBestListFn(beamSize, dimBatch, graph->getDeviceId());
+    std::vector<float> costs;
+    std::vector<unsigned> keys;
+    timer::Timer timer;
+    for(int r = 0; r < repeats; ++r) {
+      costs.clear();
+      keys.clear();
+      getNBestList(logProbs->val(), beamSize, costs, keys, /*isFirst=*/false);
+    }
+    report("NthElementCPU", timer.elapsed(), costs);
+  }
+
+  {
+    std::vector<float> costs;
+    std::vector<int> idxs(batchOffset);
+    timer::Timer timer;
+    for(int r = 0; r < repeats; ++r) {
+      costs.clear();
+      for(int b = 0; b < dimBatch; ++b) {
+        const float* entry = scores.data() + (size_t)b * batchOffset;
+        std::iota(idxs.begin(), idxs.end(), 0);
+        std::partial_sort(idxs.begin(), idxs.begin() + beamSize, idxs.end(),
+                          [&](int a, int c) { return entry[a] > entry[c]; });
+        for(int i = 0; i < beamSize; ++i)
+          costs.push_back(entry[idxs[i]]);
+      }
+    }
+    report("std::partial_sort", timer.elapsed(), costs);
+  }
+
+  {
+    Expr values, indices;
+    std::tie(values, indices) = topk(reshape(logProbs, {dimBatch, batchOffset}), beamSize, /*axis=*/-1);
+    graph->forwardNext(); // allocates and runs the operator once
+
+    std::vector<float> costs;
+    timer::Timer timer;
+    for(int r = 0; r < repeats; ++r)
+      values->forward(); // runs the kernel again
+    double elapsed = timer.elapsed();
+    values->val()->get(costs);
+    report("topk", elapsed, costs);
+  }
+
+  return 0;
+}
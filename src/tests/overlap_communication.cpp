@@ -0,0 +1,86 @@
+#include "marian.h"
+#include "common/timer.h"
+#include "training/communicator.h"
+#include "training/gradient_buckets.h"
+
+// Measures the time of a synchronous CPU training step with one graph per thread, as with
+// --cpu-threads N, without and with --overlap-communication:
+//   off: forward and backward passes, then DefaultCommunicator::scatterReduceAndResetGrads()
+//   on:  forward and backward passes while GradientBuckets reduces the final buckets into shards
+// Each graph is a stack of tanh layers on a fixed batch of 64 inputs. Resetting the gradient shards
+// stands in for the optimizer update, which is the same with and without overlap.
+// Usage: ./test_overlap_communication [threads=4] [layers=8] [dim=512] [bucketMB=4]
+int main(int argc, char** argv) {
+  using namespace marian;
+
+  createLoggers();
+
+  const size_t threads  = argc > 1 ? std::stoul(argv[1]) : 4;
+  const int layers      = argc > 2 ? std::stoi(argv[2]) : 8;
+  const int dim         = argc > 3 ? std::stoi(argv[3]) : 512;
+  const size_t bucketMB = argc > 4 ? std::stoul(argv[4]) : 4;
+  ABORT_IF(threads < 2, "Overlapping communication needs at least 2 threads");
+  ABORT_IF(layers < 1 || dim < 1 || bucketMB == 0, "Layers, dim and bucketMB have to be positive");
+  const int batchSize = 64;
+  const int steps = 20;
+
+  auto build = [&](Ptr<ExpressionGraph> graph) {
+    graph->clear();
+    auto h = graph->constant({batchSize, dim}, inits::uniform());
+    for(int l = 0; l < layers; ++l) {
+      auto W = graph->param("W" + std::to_string(l), {dim, dim}, inits::glorotUniform());
+      auto b = graph->param("b" + std::to_string(l), {1, dim}, inits::zeros());
+      h = tanh(affine(h, W, b));
+    }
+    return sum(flatten(h * h), /*axis=*/-1);
+  };
+
+  std::vector<Ptr<ExpressionGraph>> graphs;
+  for(size_t i = 0; i < threads; ++i) {
+    auto graph = New<ExpressionGraph>();
+    graph->setDevice({i, DeviceType::cpu});
+    graph->reserveWorkspaceMB(256);
+    build(graph);
+    graph->forward();
+    graph->params()->allocateBackward();
+    graph->params()->set_zero_adjoint();
+    graphs.push_back(graph);
+  }
+
+  auto comm = createCommunicator(graphs, /*noNccl=*/true, /*mpi=*/nullptr);
+  GradientBuckets buckets(graphs, bucketMB * 1024 * 1024);
+
+  auto step = [&](bool overlap) {
+    if(overlap)
+      buckets.start();
+    comm->foreach([&](size_t idx, size_t /*begin*/, size_t /*end*/) {
+      auto graph = graphs[idx];
+      build(graph);
+      graph->forward();
+      if(overlap)
+        graph->setGradientReadyCallback([&, idx](Expr param) { buckets.gradientReady(idx, param); });
+      graph->backward(/*zero=*/false);
+      graph->setGradientReadyCallback(nullptr);
+    });
+    if(overlap)
+      buckets.wait();
+    else
+      comm->scatterReduceAndResetGrads();
+    comm->foreach([&](size_t idx, size_t begin, size_t end) {
+      graphs[idx]->params()->grads()->subtensor(begin, end - begin)->set(0.f);
+    });
+  };
+
+  LOG(info, "threads: {}, layers: {}, dim: {}, params: {}, bucket size: {} MB",
+      threads, layers, dim, graphs[0]->params()->vals()->size(), bucketMB);
+  for(bool overlap : {false, true}) {
+    step(overlap); // warm-up
+    timer::Timer timer;
+    for(int i = 0; i < steps; ++i)
+      step(overlap);
+    LOG(info, "--overlap-communication {}: {:.2f} ms per step",
+        overlap ? "on" : "off", timer.elapsed<std::chrono::microseconds>() / 1000.0 / steps);
+  }
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include "marian.h"
+#include "common/timer.h"
+#include "data/shortlist.h"
+
+#include <algorithm>
+#include <random>
+#include <unordered_set>
+
+// Measures the per-batch cost of shortlist generation: the union of the candidates of all source
+// words of a batch as collected by ShortlistGenerator::generateFromCandidates() (thread-local
+// bitsets) and, for comparison, with hash sets and a final sort as before. The lex table is random
+// with a fixed number of translations per source word.
+// Usage: ./test_shortlist [vocab=32000] [translations=100] [sentences=8] [length=20] [repeats=2000]
+using namespace marian;
+
+namespace {
+
+struct CandidateGenerator : public data::ShortlistGenerator {
+  using data::ShortlistGenerator::generateFromCandidates;
+  Ptr<data::Shortlist> generate(Ptr<data::CorpusBatch> /*batch*/) const override { return nullptr; }
+};
+
+std::vector<WordIndex> hashSetCandidates(const Words& srcWords,
+                                         size_t firstNum,
+                                         size_t trgVocabSize,
+                                         const std::vector<uint64_t>& offsets,
+                                         const std::vector<WordIndex>& trgIds) {
+  std::unordered_set<WordIndex> indexSet;
+  for(WordIndex i = 0; i < firstNum && i < trgVocabSize; ++i)
+    indexSet.insert(i);
+
+  std::unordered_set<WordIndex> srcSet;
+  for(auto w : srcWords)
+    srcSet.insert(w.toWordIndex());
+  for(auto i : srcSet)
+    for(uint64_t j = offsets[i]; j < offsets[i + 1]; ++j)
+      indexSet.insert(trgIds[j]);
+
+  WordIndex i = static_cast<WordIndex>(firstNum);
+  while(indexSet.size() % 8 != 0)
+    indexSet.insert(i++);
+
+  std::vector<WordIndex> indices(indexSet.begin(), indexSet.end());
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  createLoggers();
+
+  const int dimVocab     = argc > 1 ? std::stoi(argv[1]) : 32000;
+  const int translations = argc > 2 ? std::stoi(argv[2]) : 100;
+  const int sentences    = argc > 3 ? std::stoi(argv[3]) : 8;
+  const int length       = argc > 4 ? std::stoi(argv[4]) : 20;
+  const int repeats      = argc > 5 ? std::stoi(argv[5]) : 2000;
+  const size_t firstNum  = 100;
+
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> word(0, dimVocab - 1);
+
+  std::vector<uint64_t> offsets = {0};
+  std::vector<WordIndex> trgIds;
+  for(int w = 0; w < dimVocab; ++w) {
+    std::vector<WordIndex> candidates;
+    for(int k = 0; k < translations; ++k)
+      candidates.push_back((WordIndex)word(rng));
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    trgIds.insert(trgIds.end(), candidates.begin(), candidates.end());
+    offsets.push_back(trgIds.size());
+  }
+
+  // a different batch for every repetition, drawn beforehand
+  std::vector<Words> batches(repeats);
+  for(auto& batch : batches)
+    for(int i = 0; i < sentences * length; ++i)
+      batch.push_back(Word::fromWordIndex(word(rng)));
+
+  size_t total = 0;
+  timer::Timer timer;
+  for(const auto& batch : batches)
+    total += CandidateGenerator::generateFromCandidates(batch, firstNum, dimVocab, /*shared=*/false,
+                                                        offsets.data(), trgIds.data(), dimVocab)->indices().size();
+  LOG(info, "[bitsets] {:.1f}us per batch, {:.0f} words per shortlist",
+      1e6 * timer.elapsed() / repeats, total / (double)repeats);
+
+  total = 0;
+  timer.start();
+  for(const auto& batch : batches)
+    total += hashSetCandidates(batch, firstNum, dimVocab, offsets, trgIds).size();
+  LOG(info, "[hash sets] {:.1f}us per batch, {:.0f} words per shortlist",
+      1e6 * timer.elapsed() / repeats, total / (double)repeats);
+
+  return 0;
+}
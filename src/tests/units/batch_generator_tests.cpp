@@ -0,0 +1,119 @@
+#include "catch.hpp"
+#include "common/config.h"
+#include "common/options.h"
+#include "data/batch_generator.h"
+#include "data/corpus.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+using namespace marian;
+
+namespace {
+
+void writeLines(const std::string& fname, const std::vector<std::string>& lines) {
+  std::ofstream out(fname);
+  for(const auto& line : lines)
+    out << line << "\n";
+}
+
+// A parallel corpus of sentences with random lengths, some longer than max-length 20
+struct TestCorpus {
+  const std::string prefix = "batch_generator_tests";
+  const std::vector<std::string> paths = {prefix + ".src", prefix + ".trg"};
+  const std::vector<std::string> vocabPaths = {prefix + ".vocab", prefix + ".vocab"};
+  const size_t numLines = 1000;
+
+  TestCorpus() {
+    std::vector<std::string> vocab = {"</s>", "<unk>"};
+    for(int i = 0; i < 20; ++i)
+      vocab.push_back("w" + std::to_string(i));
+    writeLines(vocabPaths[0], vocab);
+
+    std::mt19937 rng(1234);
+    for(const auto& path : paths) {
+      std::vector<std::string> lines;
+      for(size_t i = 0; i < numLines; ++i) {
+        std::string line;
+        for(size_t j = 0, n = 1 + rng() % 24; j < n; ++j)
+          line += (j > 0 ? " w" : "w") + std::to_string(rng() % 20);
+        lines.push_back(line);
+      }
+      writeLines(path, lines);
+    }
+  }
+
+  ~TestCorpus() {
+    for(const auto& path : paths)
+      std::remove(path.c_str());
+    std::remove(vocabPaths[0].c_str());
+  }
+
+  Ptr<Options> options() const {
+    auto options = New<Options>();
+    options->set("train-sets", paths, "vocabs", vocabPaths, "dim-vocabs", std::vector<int>({0, 0}));
+    options->set("max-length", 20, "max-length-crop", false, "right-left", false);
+    options->set("mini-batch", 8, "maxi-batch", 10, "maxi-batch-sort", "trg", "shuffle", "none");
+    return options;
+  }
+};
+
+// all batches of one epoch of the corpus
+std::vector<Ptr<data::CorpusBatch>> readBatches(Ptr<Options> options) {
+  Config::seed = 1234;
+  auto corpus = New<data::Corpus>(options);
+  data::BatchGenerator<data::Corpus> batchGenerator(corpus, options);
+  batchGenerator.prepare();
+  std::vector<Ptr<data::CorpusBatch>> batches;
+  for(auto batch : batchGenerator)
+    batches.push_back(batch);
+  return batches;
+}
+
+}  // namespace
+
+TEST_CASE("BatchGenerator gives the same batches with --data-threads", "[data]") {
+  TestCorpus corpus;
+  auto options = corpus.options();
+  options->set("all-caps-every", 3); // preprocessing, which logs once, runs on the encoding threads
+
+  auto expected = readBatches(options);
+  REQUIRE(!expected.empty());
+
+  options->set("data-threads", 4);
+  auto batches = readBatches(options);
+
+  REQUIRE(batches.size() == expected.size());
+  for(size_t b = 0; b < batches.size(); ++b) {
+    CHECK(batches[b]->getSentenceIds() == expected[b]->getSentenceIds());
+    REQUIRE(batches[b]->sets() == expected[b]->sets());
+    for(size_t j = 0; j < batches[b]->sets(); ++j) {
+      CHECK((*batches[b])[j]->data() == (*expected[b])[j]->data());
+      CHECK((*batches[b])[j]->mask() == (*expected[b])[j]->mask());
+    }
+  }
+}
+
+TEST_CASE("BatchGenerator keeps batches within --mini-batch-tokens", "[data]") {
+  TestCorpus corpus;
+  auto options = corpus.options();
+  size_t numSentences = 0;
+  for(auto batch : readBatches(options))
+    numSentences += batch->size();
+
+  const size_t budget = 64;
+  options->set("mini-batch-tokens", budget); // overrides --maxi-batch-sort trg with src
+  auto batches = readBatches(options);
+
+  size_t batchedSentences = 0, minSize = numSentences, maxSize = 0;
+  for(auto batch : batches) {
+    // a single sentence longer than the budget cannot be split
+    CHECK((batch->size() * batch->width() <= budget || batch->size() == 1));
+    batchedSentences += batch->size();
+    minSize = std::min(minSize, batch->size());
+    maxSize = std::max(maxSize, batch->size());
+  }
+  CHECK(batchedSentences == numSentences);
+  CHECK(minSize < maxSize); // batch sizes adapt to the length
+}
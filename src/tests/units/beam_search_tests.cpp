@@ -0,0 +1,130 @@
+#include "catch.hpp"
+#include "data/vocab.h"
+#include "graph/expression_graph.h"
+#include "translator/beam_search.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+using namespace marian;
+
+namespace {
+
+// toHyps() only asks the scorers for a shortlist and alignments
+class NoScorer : public Scorer {
+public:
+  NoScorer() : Scorer("none", 1.f) {}
+  void clear(Ptr<ExpressionGraph>) override {}
+  Ptr<ScorerState> startState(Ptr<ExpressionGraph>, Ptr<data::CorpusBatch>) override { return nullptr; }
+  Ptr<ScorerState> step(Ptr<ExpressionGraph>, Ptr<ScorerState>, const std::vector<IndexType>&,
+                        const Words&, const std::vector<IndexType>&, int) override { return nullptr; }
+};
+
+}  // namespace
+
+TEST_CASE("Gathered n-best score breakdowns equal the per-element reads", "[translator]") {
+  const size_t dimVocab = 6, dimBatch = 3, beamSize = 2, numScorers = 2;
+
+  const std::string vocabPath = "beam_search_tests.vocab";
+  {
+    std::ofstream out(vocabPath);
+    for(auto word : {"</s>", "<unk>", "a", "b", "c", "d"})
+      out << word << "\n";
+  }
+  auto trgVocab = New<Vocab>(New<Options>(), 0);
+  trgVocab->load(vocabPath);
+  std::remove(vocabPath.c_str());
+  const WordIndex eosIdx = trgVocab->getEosId().toWordIndex();
+
+  auto options = New<Options>("n-best", true, "beam-size", beamSize);
+  std::vector<Ptr<Scorer>> scorers = {New<NoScorer>(), New<NoScorer>()};
+  BeamSearch search(options, scorers, trgVocab);
+
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(16);
+
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> uniform(-10.f, 0.f);
+
+  // logits of every scorer with beamDepth hypotheses per batch entry
+  auto makeLogits = [&](size_t beamDepth) {
+    std::vector<Expr> logits;
+    for(size_t j = 0; j < numScorers; ++j) {
+      std::vector<float> values(beamDepth * dimBatch * dimVocab);
+      for(auto& value : values)
+        value = uniform(rng);
+      logits.push_back(graph->constant({(int)beamDepth, 1, (int)dimBatch, (int)dimVocab}, inits::fromVector(values)));
+    }
+    graph->forward();
+    return logits;
+  };
+
+  // as BeamSearch::toHyps() did before the gathering: one read of the logits per hypothesis and scorer
+  auto perElementBreakdown = [&](const std::vector<Expr>& logits, const IPtr<Hypothesis>& prevHyp,
+                                 size_t beamHypIdx, size_t batchIdx, WordIndex wordIdx) {
+    auto breakDown = prevHyp->getScoreBreakdown();
+    breakDown.resize(numScorers, 0);
+    for(size_t j = 0; j < numScorers; ++j)
+      breakDown[j] += logits[j]->val()->get((beamHypIdx * dimBatch + batchIdx) * dimVocab + wordIdx);
+    return breakDown;
+  };
+
+  std::vector<IndexType> batchIdxMap = {0, 1, 2};
+
+  SECTION("first step") {
+    Beams beams(dimBatch, Beam(1, Hypothesis::New()));
+    auto logits = makeLogits(1);
+
+    std::vector<unsigned int> keys = {3, 2, 6 + 5, 6 + 1, 12 + 4, 12 + 0}; // [batch, beam], beam depth 1
+    std::vector<float> pathScores(keys.size(), -1.f);
+    auto newBeams = search.toHyps(keys, pathScores, /*nBestBeamSize=*/1, dimVocab, beams, logits,
+                                  nullptr, nullptr, 0, /*dropBatchEntries=*/{}, batchIdxMap);
+
+    REQUIRE(newBeams.size() == dimBatch);
+    for(size_t b = 0; b < dimBatch; ++b) {
+      REQUIRE(newBeams[b].size() == 1); // as many as the beam had
+      auto wordIdx = keys[b * beamSize] % dimVocab;
+      CHECK(newBeams[b][0]->getWord().toWordIndex() == wordIdx);
+      CHECK(newBeams[b][0]->getScoreBreakdown() == perElementBreakdown(logits, beams[b][0], 0, b, wordIdx));
+    }
+  }
+
+  SECTION("later step with a dropped batch entry") {
+    Beams beams(dimBatch);
+    for(size_t b = 0; b < dimBatch; ++b) {
+      for(size_t h = 0; h < beamSize; ++h) {
+        auto hyp = Hypothesis::New(Hypothesis::New(), Word::fromWordIndex(2), 0, -1.f);
+        hyp->setScoreBreakdown({-0.5f * (b + 1), -0.25f * (h + 1)});
+        beams[b].push_back(hyp);
+      }
+    }
+    auto logits = makeLogits(beamSize);
+
+    // keys of (batch, beam hypothesis, word) as produced by the n-best search of the step
+    std::vector<size_t> hypIdxs = {1, 0, 0, 0, 1, 1};
+    std::vector<WordIndex> wordIdxs = {4, 2, 5, 3, 1, 2};
+    std::vector<unsigned int> keys;
+    for(size_t i = 0; i < hypIdxs.size(); ++i)
+      keys.push_back((unsigned int)(((i / beamSize) * beamSize + hypIdxs[i]) * dimVocab + wordIdxs[i]));
+    std::vector<float> pathScores(keys.size(), -2.f);
+
+    std::vector<bool> dropBatchEntries = {false, true, false};
+    auto newBeams = search.toHyps(keys, pathScores, beamSize, dimVocab, beams, logits,
+                                  nullptr, nullptr, 0, dropBatchEntries, batchIdxMap);
+
+    REQUIRE(newBeams.size() == dimBatch);
+    for(size_t b = 0; b < dimBatch; ++b) {
+      REQUIRE(newBeams[b].size() == beamSize);
+      for(size_t k = 0; k < beamSize; ++k) {
+        size_t i = b * beamSize + k;
+        WordIndex wordIdx = dropBatchEntries[b] ? eosIdx : wordIdxs[i]; // dropped entries end with EOS
+        const auto& hyp = newBeams[b][k];
+        CHECK(hyp->getWord().toWordIndex() == wordIdx);
+        CHECK(hyp->getPathScore() == (dropBatchEntries[b] ? 0.f : pathScores[i]));
+        CHECK(hyp->getScoreBreakdown() == perElementBreakdown(logits, beams[b][hypIdxs[i]], hypIdxs[i], b, wordIdx));
+      }
+    }
+  }
+}
@@ -0,0 +1,100 @@
+#include "catch.hpp"
+#include "common/filesystem.h"
+#include "training/checkpoint_writer.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace marian;
+
+namespace {
+
+std::string readFile(const std::string& fname) {
+  std::ifstream in(fname);
+  std::stringstream text;
+  text << in.rdbuf();
+  return text.str();
+}
+
+io::Item makeItem(const std::string& name, size_t elements, float value) {
+  io::Item item;
+  item.name = name;
+  item.shape = Shape({1, (int)elements});
+  item.type = Type::float32;
+  item.bytes.resize(elements * sizeof(float));
+  for(size_t i = 0; i < elements; ++i)
+    ((float*)item.bytes.data())[i] = value + i;
+  return item;
+}
+
+}  // namespace
+
+TEST_CASE("CheckpointWriter writes queued files", "[training]") {
+  const std::string prefix = "checkpoint_writer_tests";
+
+  SECTION("model files are complete after wait()") {
+    const std::string fname = prefix + ".npz";
+    CheckpointWriter writer(/*maxBytes=*/1024 * 1024);
+    for(int i = 0; i < 3; ++i) { // the last save of the same file wins, as at the final save
+      std::vector<io::Item> items = {makeItem("a", 100000, (float)i), makeItem("b", 10, -(float)i)};
+      writer.saveItems(fname, std::move(items));
+    }
+    writer.wait();
+
+    auto items = io::loadItems(fname);
+    REQUIRE(items.size() == 2);
+    CHECK(items[0].name == "a");
+    CHECK(items[0].shape == Shape({1, 100000}));
+    CHECK(((const float*)items[0].data())[99999] == 2.f + 99999);
+    CHECK(items[1].name == "b");
+    CHECK(((const float*)items[1].data())[0] == -2.f);
+    CHECK(!filesystem::exists(prefix + ".tmp.npz"));
+    std::remove(fname.c_str());
+  }
+
+  SECTION("files are written in the order they were queued") {
+    const std::string fname = prefix + ".yml";
+    {
+      // a budget of one byte lets only one file wait at a time, so queuing blocks on the writer
+      CheckpointWriter writer(/*maxBytes=*/1);
+      for(int i = 0; i < 20; ++i) {
+        writer.saveText(fname, "progress: " + std::to_string(i) + "\n");
+        writer.saveText(prefix + "." + std::to_string(i) + ".yml", std::to_string(i));
+      }
+    } // the destructor writes everything that is still queued
+
+    CHECK(readFile(fname) == "progress: 19\n");
+    for(int i = 0; i < 20; ++i) {
+      auto name = prefix + "." + std::to_string(i) + ".yml";
+      CHECK(readFile(name) == std::to_string(i));
+      std::remove(name.c_str());
+    }
+    CHECK(!filesystem::exists(prefix + ".tmp.yml"));
+    std::remove(fname.c_str());
+  }
+
+#ifndef _WIN32
+  SECTION("files are written into a temporary file that replaces the old one") {
+    // the old file has a second name; writing into the old file directly would change both
+    const std::string fname = prefix + ".yml", link = prefix + ".link.yml";
+    {
+      std::ofstream out(fname);
+      out << "old";
+    }
+    REQUIRE(::link(fname.c_str(), link.c_str()) == 0);
+
+    CheckpointWriter writer(/*maxBytes=*/1024);
+    writer.saveText(fname, "new");
+    writer.wait();
+
+    CHECK(readFile(fname) == "new");
+    CHECK(readFile(link) == "old");
+    std::remove(fname.c_str());
+    std::remove(link.c_str());
+  }
+#endif
+}
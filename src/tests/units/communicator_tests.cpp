@@ -0,0 +1,56 @@
+#include "catch.hpp"
+#include "graph/expression_graph.h"
+#include "training/communicator.h"
+
+#include <random>
+
+using namespace marian;
+
+namespace {
+
+// CPU graphs with a single parameter of numParams elements and random gradients, the same for the
+// same seed
+std::vector<Ptr<ExpressionGraph>> graphsWithGradients(size_t numGraphs, int numParams, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+
+  std::vector<Ptr<ExpressionGraph>> graphs;
+  for(size_t i = 0; i < numGraphs; ++i) {
+    auto graph = New<ExpressionGraph>();
+    graph->setDevice({i, DeviceType::cpu});
+    graph->reserveWorkspaceMB(8);
+    graph->param("W", {1, numParams}, inits::zeros());
+    graph->forward();
+    graph->params()->allocateBackward();
+
+    std::vector<float> grads(graph->params()->grads()->size()); // including padding
+    for(auto& grad : grads)
+      grad = uniform(rng);
+    graph->params()->grads()->set(grads);
+    graphs.push_back(graph);
+  }
+  return graphs;
+}
+
+}  // namespace
+
+TEST_CASE("DefaultCommunicator sums CPU gradients in place as through temporary tensors", "[training]") {
+  // sizes that do not divide into the shards and that span several blocks of the in-place sum
+  for(int numParams : {1000, 12345}) {
+    for(size_t numGraphs : {1, 2, 3, 4}) {
+      auto graphs = graphsWithGradients(numGraphs, numParams, 1234);
+      auto expectedGraphs = graphsWithGradients(numGraphs, numParams, 1234);
+
+      DefaultCommunicator(graphs, /*mpi=*/nullptr).scatterReduceAndResetGrads();
+      DefaultCommunicator(expectedGraphs, /*mpi=*/nullptr, /*sharedMemory=*/false).scatterReduceAndResetGrads();
+
+      for(size_t i = 0; i < numGraphs; ++i) {
+        std::vector<float> grads, expected;
+        graphs[i]->params()->grads()->get(grads);
+        expectedGraphs[i]->params()->grads()->get(expected);
+        // the gradients are summed in the same order on both paths
+        CHECK(grads == expected);
+      }
+    }
+  }
+}
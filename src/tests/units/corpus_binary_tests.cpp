@@ -0,0 +1,100 @@
+#include "catch.hpp"
+#include "common/options.h"
+#include "data/corpus.h"
+#include "data/corpus_binary.h"
+#include "data/vocab.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace marian;
+
+namespace {
+
+void writeLines(const std::string& fname, const std::vector<std::string>& lines) {
+  std::ofstream out(fname);
+  for(const auto& line : lines)
+    out << line << "\n";
+}
+
+std::vector<data::SentenceTuple> readAll(data::CorpusBase& corpus) {
+  std::vector<data::SentenceTuple> tuples;
+  corpus.reset();
+  for(auto tup = corpus.next(); !tup.empty(); tup = corpus.next())
+    tuples.push_back(tup);
+  return tuples;
+}
+
+}  // namespace
+
+TEST_CASE("Binary corpus reads the sentences of the text corpus", "[data]") {
+  const std::string prefix = "corpus_binary_tests";
+  const std::vector<std::string> paths = {prefix + ".src", prefix + ".trg"};
+  const std::vector<std::string> vocabPaths = {prefix + ".src.vocab", prefix + ".trg.vocab"};
+  const std::string binaryPath = prefix + ".bin";
+
+  writeLines(vocabPaths[0], {"</s>", "<unk>", "a", "small", "house", "the"});
+  writeLines(vocabPaths[1], {"</s>", "<unk>", "ein", "kleines", "Haus", "das"});
+  writeLines(paths[0], {"the house", "a small house", "the unknown house", "house"});
+  writeLines(paths[1], {"das Haus", "ein kleines Haus", "das unbekannte Haus", "Haus"});
+
+  std::vector<Ptr<Vocab>> vocabs;
+  for(size_t i = 0; i < vocabPaths.size(); ++i) {
+    vocabs.push_back(New<Vocab>(New<Options>(), i));
+    vocabs.back()->load(vocabPaths[i]);
+  }
+
+  auto options = New<Options>();
+  options->set("train-sets", paths, "vocabs", vocabPaths, "dim-vocabs", std::vector<int>({0, 0}));
+  options->set("max-length", 50, "max-length-crop", false, "right-left", false);
+  options->set("binary-corpus", binaryPath);
+
+  SECTION("round trip") {
+    data::CorpusBinary::save(binaryPath, paths, vocabs);
+
+    std::vector<data::SentenceTuple> expected;
+    {
+      data::Corpus text(options);
+      expected = readAll(text);
+    }
+
+    // the text files are not needed anymore once converted
+    for(const auto& path : paths)
+      std::remove(path.c_str());
+    data::CorpusBinary binary(options);
+    auto tuples = readAll(binary);
+
+    REQUIRE(expected.size() == 4);
+    REQUIRE(tuples.size() == expected.size());
+    for(size_t i = 0; i < tuples.size(); ++i) {
+      CHECK(tuples[i].getId() == expected[i].getId());
+      REQUIRE(tuples[i].size() == 2);
+      for(size_t j = 0; j < tuples[i].size(); ++j)
+        CHECK(tuples[i][j] == expected[i][j]);
+    }
+    CHECK(tuples[2][0][1] == vocabs[0]->getUnkId());
+  }
+
+  SECTION("word ids out of range of the vocabulary") {
+    data::CorpusBinary::save(binaryPath, paths, vocabs);
+    {
+      // overwrite the first word id of the first stream, which follows the file and stream headers
+      std::fstream file(binaryPath, std::ios::in | std::ios::out | std::ios::binary);
+      file.seekp(3 * sizeof(uint64_t) + 2 * 4 * sizeof(uint64_t));
+      WordIndex outOfRange = (WordIndex)vocabs[0]->size();
+      file.write((const char*)&outOfRange, sizeof(outOfRange));
+    }
+
+    // word ids are checked while reading, not with a full pass when loading
+    marian::setThrowExceptionOnAbort(true);
+    data::CorpusBinary binary(options);
+    CHECK_THROWS_AS(readAll(binary), MarianRuntimeException);
+    marian::setThrowExceptionOnAbort(false);
+  }
+
+  for(const auto& path : paths)
+    std::remove(path.c_str());
+  for(const auto& path : vocabPaths)
+    std::remove(path.c_str());
+  std::remove(binaryPath.c_str());
+}
@@ -0,0 +1,95 @@
+#include "catch.hpp"
+#include "common/config.h"
+#include "common/options.h"
+#include "data/corpus.h"
+#include "data/line_index.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+using namespace marian;
+
+namespace {
+
+void writeLines(const std::string& fname, const std::vector<std::string>& lines) {
+  std::ofstream out(fname);
+  for(const auto& line : lines)
+    out << line << "\n";
+}
+
+// sentence ids and source words of all tuples of the corpus in reading order
+std::vector<std::pair<size_t, Words>> readAll(data::Corpus& corpus) {
+  std::vector<std::pair<size_t, Words>> tuples;
+  for(auto tup = corpus.next(); !tup.empty(); tup = corpus.next())
+    tuples.emplace_back(tup.getId(), tup[0]);
+  return tuples;
+}
+
+}  // namespace
+
+TEST_CASE("Shuffling through the line index yields a permutation of the corpus", "[data]") {
+  const std::string prefix = "corpus_tests";
+  const std::vector<std::string> paths = {prefix + ".src", prefix + ".trg"};
+  const std::vector<std::string> vocabPaths = {prefix + ".vocab", prefix + ".vocab"};
+
+  std::vector<std::string> vocab = {"</s>", "<unk>"};
+  for(int i = 0; i < 50; ++i)
+    vocab.push_back("w" + std::to_string(i));
+  writeLines(vocabPaths[0], vocab);
+
+  // more sentences than fit into a few blocks of the line index, the words encode the line number
+  const size_t numLines = 2000;
+  std::vector<std::string> lines;
+  for(size_t i = 0; i < numLines; ++i)
+    lines.push_back("w" + std::to_string(i / 50) + " w" + std::to_string(i % 50));
+  writeLines(paths[0], lines);
+  writeLines(paths[1], lines);
+
+  auto options = New<Options>();
+  options->set("train-sets", paths, "vocabs", vocabPaths, "dim-vocabs", std::vector<int>({0, 0}));
+  options->set("max-length", 50, "max-length-crop", false, "right-left", false);
+  options->set("shuffle-index", true, "shuffle-buffer", 300);
+
+  auto shuffled = [&](size_t epochs) {
+    Config::seed = 1234;
+    data::Corpus corpus(options);
+    std::vector<std::pair<size_t, Words>> tuples;
+    for(size_t epoch = 0; epoch < epochs; ++epoch) {
+      corpus.shuffle();
+      tuples = readAll(corpus);
+    }
+    return tuples;
+  };
+
+  auto tuples = shuffled(1);
+  REQUIRE(tuples.size() == numLines);
+
+  std::vector<bool> seen(numLines, false);
+  for(const auto& tuple : tuples) {
+    size_t id = tuple.first;
+    REQUIRE(id < numLines);
+    CHECK(!seen[id]);
+    seen[id] = true;
+    // the sentence is the one of line id
+    REQUIRE(tuple.second.size() == 3); // with EOS
+    CHECK(tuple.second[0].toWordIndex() == 2 + id / 50);
+    CHECK(tuple.second[1].toWordIndex() == 2 + id % 50);
+  }
+
+  bool inOrder = true;
+  for(size_t i = 0; i < tuples.size(); ++i)
+    inOrder = inOrder && tuples[i].first == i;
+  CHECK(!inOrder);
+
+  // the same seed gives the same order, the next epoch another one
+  CHECK(shuffled(1) == tuples);
+  CHECK(shuffled(2) != tuples);
+
+  for(const auto& path : paths) {
+    std::remove(path.c_str());
+    std::remove(data::LineIndex::indexPath(path).c_str());
+  }
+  std::remove(vocabPaths[0].c_str());
+}
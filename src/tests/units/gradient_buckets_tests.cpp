@@ -0,0 +1,86 @@
+#include "catch.hpp"
+#include "graph/expression_graph.h"
+#include "training/communicator.h"
+#include "training/gradient_buckets.h"
+
+#include <random>
+#include <thread>
+
+using namespace marian;
+
+namespace {
+
+// CPU graphs with parameters of different sizes, their gradients allocated
+std::vector<Ptr<ExpressionGraph>> createGraphs(size_t numGraphs) {
+  std::vector<Ptr<ExpressionGraph>> graphs;
+  for(size_t i = 0; i < numGraphs; ++i) {
+    auto graph = New<ExpressionGraph>();
+    graph->setDevice({i, DeviceType::cpu});
+    graph->reserveWorkspaceMB(8);
+    graph->param("a", {1, 1000}, inits::zeros());
+    graph->param("b", {10, 300}, inits::zeros());
+    graph->param("c", {1, 7}, inits::zeros());
+    graph->param("d", {50, 50}, inits::zeros());
+    graph->forward();
+    graph->params()->allocateBackward();
+    graphs.push_back(graph);
+  }
+  return graphs;
+}
+
+void setRandomGradients(const std::vector<Ptr<ExpressionGraph>>& graphs, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+  for(auto graph : graphs) {
+    std::vector<float> grads(graph->params()->grads()->size());
+    for(auto& grad : grads)
+      grad = uniform(rng);
+    graph->params()->grads()->set(grads);
+  }
+}
+
+}  // namespace
+
+TEST_CASE("GradientBuckets reduces as DefaultCommunicator::scatterReduceAndResetGrads", "[training]") {
+  for(size_t numGraphs : {2, 3, 4}) {
+    for(size_t bucketBytes : {1, 2048, 1 << 20}) { // a bucket per parameter, several, a single one
+      auto graphs = createGraphs(numGraphs);
+      auto expectedGraphs = createGraphs(numGraphs);
+      GradientBuckets buckets(graphs, bucketBytes);
+      DefaultCommunicator comm(expectedGraphs, /*mpi=*/nullptr);
+
+      for(unsigned int round = 0; round < 3; ++round) {
+        setRandomGradients(graphs, round);
+        setRandomGradients(expectedGraphs, round);
+
+        // as in SyncGraphGroup::update(), the backward passes report parameters in reverse order
+        // and concurrently, the last graph reports all at once as if it had no sub-batch
+        buckets.start();
+        std::vector<std::thread> backward;
+        for(size_t idx = 0; idx < numGraphs; ++idx) {
+          backward.emplace_back([&, idx]() {
+            if(idx + 1 == numGraphs) {
+              buckets.allReady(idx);
+              return;
+            }
+            std::vector<Expr> params(graphs[idx]->params()->begin(), graphs[idx]->params()->end());
+            for(auto it = params.rbegin(); it != params.rend(); ++it)
+              buckets.gradientReady(idx, *it);
+          });
+        }
+        for(auto& thread : backward)
+          thread.join();
+        buckets.wait();
+
+        comm.scatterReduceAndResetGrads();
+
+        for(size_t i = 0; i < numGraphs; ++i) {
+          std::vector<float> grads, expected;
+          graphs[i]->params()->grads()->get(grads);
+          expectedGraphs[i]->params()->grads()->get(expected);
+          CHECK(grads == expected);
+        }
+      }
+    }
+  }
+}
@@ -121,3 +121,101 @@ TEST_CASE("Expression graph can be initialized with constant values (cpu)",
     REQUIRE(values == v);
   }
 }
+
+TEST_CASE("Captured allocation plans replay forward allocations (cpu)", "[graph]") {
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(4);
+  graph->setMaxCaptures(1);
+
+  std::vector<float> v({1, 2, 3, 4, 5, 6});
+  auto step = [&](float scale) {
+    graph->startCapture(/*key=*/0);
+    auto y = exp(graph->constant({2, 3}, inits::fromVector(v)) * scale);
+    graph->forwardNext();
+    graph->stopCapture();
+    return y;
+  };
+
+  auto y1 = step(1.f); // recorded, allocated from the workspace
+  auto y2 = step(2.f); // replayed from an arena
+  REQUIRE(y1->val()->memory()->data() != y2->val()->memory()->data());
+
+  std::vector<float> values1, values2;
+  y1->val()->get(values1);
+  y2->val()->get(values2);
+  for(size_t i = 0; i < v.size(); ++i) {
+    CHECK(values1[i] == Approx(std::exp(v[i])));
+    CHECK(values2[i] == Approx(std::exp(2.f * v[i])));
+  }
+
+  // once all tensors of a replay have been freed its arena is used again
+  auto ptr2 = y2->val()->memory()->data();
+  y2 = nullptr;
+  auto y3 = step(3.f);
+  REQUIRE(y3->val()->memory()->data() == ptr2);
+
+  // arenas are taken from the workspace and released by clear(), tensors that outlive it are only
+  // detached from their memory when they are freed
+  graph->clear();
+  y1 = nullptr;
+  y3 = nullptr;
+  auto y4 = step(4.f);
+  std::vector<float> values4;
+  y4->val()->get(values4);
+  for(size_t i = 0; i < v.size(); ++i)
+    CHECK(values4[i] == Approx(std::exp(4.f * v[i])));
+}
+
+TEST_CASE("Size-class tensor allocator (cpu)", "[graph]") {
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->setTensorAllocator("size-classes");
+  graph->reserveWorkspaceMB(4);
+
+  std::vector<float> v({1, 2, 3, 4, 5, 6});
+  auto x = graph->constant({2, 3}, inits::fromVector(v));
+  auto y = exp(x) + x;
+  graph->forward();
+
+  std::vector<float> values;
+  y->val()->get(values);
+  for(size_t i = 0; i < v.size(); ++i)
+    CHECK(values[i] == Approx(std::exp(v[i]) + v[i]));
+
+  const auto& stats = graph->getAllocatorStats();
+  CHECK(stats.allocs >= 2);
+  CHECK(stats.grows == 0);
+
+  // a freed block is handed out again for a request of the same size class
+  auto ptr = y->val()->memory()->data();
+  y = nullptr;
+  auto z = sqrt(x);
+  graph->forwardNext();
+  REQUIRE(z->val()->memory()->data() == ptr);
+}
+
+TEST_CASE("Size-class tensor allocator ignores frees after clear (cpu)", "[graph]") {
+  auto backend = BackendByDeviceId({0, DeviceType::cpu}, /*seed=*/1234);
+  SizeClassAllocator alloc(backend, /*step=*/1024 * 1024);
+  alloc.reserve(1024 * 1024);
+
+  // e.g. cached keys and values of a decoder that are released after the graph has been cleared
+  Tensor stale;
+  alloc.allocate(stale, {4, 8});
+  alloc.clear();
+
+  Tensor live;
+  alloc.allocate(live, {4, 8});
+  auto ptr = live->memory()->data();
+  REQUIRE(stale->memory()->data() == ptr);
+
+  // freeing the stale tensor must not hand out the memory of the live one again
+  CHECK(alloc.free(stale));
+  CHECK(stale->memory()->data() == nullptr);
+
+  Tensor other;
+  alloc.allocate(other, {4, 8});
+  CHECK(other->memory()->data() != ptr);
+  CHECK(live->memory()->data() == ptr);
+}
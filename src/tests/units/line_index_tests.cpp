@@ -0,0 +1,78 @@
+#include "catch.hpp"
+#include "common/logging.h"
+#include "data/line_index.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace marian;
+
+namespace {
+
+void writeLines(const std::string& fname, const std::vector<std::string>& lines) {
+  std::ofstream out(fname, std::ios::out | std::ios::binary);
+  for(const auto& line : lines)
+    out << line << "\n";
+}
+
+std::vector<std::string> readAll(data::LineIndex& index) {
+  std::vector<std::string> lines;
+  for(size_t block = 0; block < index.blocks(); ++block)
+    index.readBlock(block, lines);
+  return lines;
+}
+
+}  // namespace
+
+TEST_CASE("Line index reads blocks of lines", "[data]") {
+  const std::string fname = "line_index_tests.txt";
+  std::vector<std::string> lines;
+  for(int i = 0; i < 10; ++i)
+    lines.push_back("line " + std::to_string(i) + std::string(i, 'x'));
+  lines[4] = ""; // empty lines are lines, too
+  writeLines(fname, lines);
+  std::remove(data::LineIndex::indexPath(fname).c_str());
+
+  SECTION("build") {
+    data::LineIndex index(fname, /*stride=*/3);
+    CHECK(index.size() == 10);
+    CHECK(index.blocks() == 4);
+    CHECK(readAll(index) == lines);
+
+    std::vector<std::string> block;
+    index.readBlock(1, block);
+    CHECK(block == std::vector<std::string>(lines.begin() + 3, lines.begin() + 6));
+    block.clear();
+    index.readBlock(3, block); // the last block is shorter
+    CHECK(block == std::vector<std::string>({lines[9]}));
+  }
+
+  SECTION("reload") {
+    { data::LineIndex index(fname, /*stride=*/3); }
+    CHECK(std::ifstream(data::LineIndex::indexPath(fname)).good());
+
+    data::LineIndex index(fname, /*stride=*/3);
+    CHECK(index.size() == 10);
+    CHECK(readAll(index) == lines);
+
+    data::LineIndex other(fname, /*stride=*/4); // different stride, rebuilt
+    CHECK(other.blocks() == 3);
+    CHECK(readAll(other) == lines);
+  }
+
+  SECTION("stale index of a file with the same size") {
+    { data::LineIndex index(fname, /*stride=*/3); }
+
+    // same number of bytes and a modification time that may not differ from the indexed one
+    std::vector<std::string> joined = {lines[0] + " " + lines[1]};
+    joined.insert(joined.end(), lines.begin() + 2, lines.end());
+    writeLines(fname, joined);
+
+    data::LineIndex index(fname, /*stride=*/3);
+    CHECK(index.size() == 9);
+    CHECK(readAll(index) == joined);
+  }
+
+  std::remove(fname.c_str());
+  std::remove(data::LineIndex::indexPath(fname).c_str());
+}
@@ -0,0 +1,53 @@
+#include "catch.hpp"
+#include "graph/expression_graph.h"
+#include "graph/expression_operators.h"
+#include "layers/lsh.h"
+
+using namespace marian;
+
+TEST_CASE("LSH index is added for the output matrix of the decoder", "[lsh]") {
+  SECTION("untied output layer") {
+    CHECK(LSH::outputMatrixName(New<Options>()) == "decoder_ff_logit_out_Wt");
+  }
+
+  SECTION("tied source embeddings are not tied to the output") {
+    auto options = New<Options>("tied-embeddings-src", true);
+    CHECK(LSH::outputMatrixName(options) == "decoder_ff_logit_out_Wt");
+  }
+
+  SECTION("tied target embeddings") {
+    auto options = New<Options>("tied-embeddings", true);
+    CHECK(LSH::outputMatrixName(options) == "decoder_Wemb");
+  }
+
+  SECTION("tied target embeddings shared with the source") {
+    auto options = New<Options>("tied-embeddings", true, "tied-embeddings-src", true);
+    CHECK(LSH::outputMatrixName(options) == "Wemb");
+  }
+
+  SECTION("all embeddings tied") {
+    auto options = New<Options>("tied-embeddings-all", true);
+    CHECK(LSH::outputMatrixName(options) == "Wemb");
+  }
+}
+
+#if BLAS_FOUND
+TEST_CASE("LSH index is stored under the name the output layer looks for (cpu)", "[lsh]") {
+  Config::seed = 1234;
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(16);
+
+  int rows = 50, dim = 32, nbits = 128;
+  auto W = graph->param("decoder_ff_logit_out_Wt", {rows, dim}, inits::glorotUniform());
+  graph->forward();
+
+  auto index = LSH::addIndex(graph, W, nbits);
+  graph->forward();
+
+  CHECK(LSH::indexName(W) == "decoder_ff_logit_out_Wt_lsh");
+  CHECK(graph->get(LSH::indexName(W)) == index);
+  CHECK(index->value_type() == Type::uint32);
+  CHECK(index->shape() == Shape({rows, 2 * (nbits / 64)}));
+}
+#endif
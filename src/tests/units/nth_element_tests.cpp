@@ -0,0 +1,88 @@
+#include "catch.hpp"
+#include "graph/expression_graph.h"
+#include "translator/nth_element.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+
+using namespace marian;
+
+namespace {
+
+// n-best keys and scores of all batch entries as found by std::partial_sort over each entry
+void partialSortNBest(const std::vector<float>& scores, size_t dimBatch, size_t N,
+                      std::vector<float>& outCosts, std::vector<unsigned>& outKeys) {
+  size_t batchOffset = scores.size() / dimBatch;
+  for(size_t b = 0; b < dimBatch; ++b) {
+    std::vector<unsigned> idxs(batchOffset);
+    std::iota(idxs.begin(), idxs.end(), (unsigned)(b * batchOffset));
+    std::partial_sort(idxs.begin(), idxs.begin() + N, idxs.end(),
+                      [&](unsigned a, unsigned c) { return scores[a] > scores[c]; });
+    for(size_t i = 0; i < N; ++i) {
+      outKeys.push_back(idxs[i]);
+      outCosts.push_back(scores[idxs[i]]);
+    }
+  }
+}
+
+}  // namespace
+
+TEST_CASE("NthElementCPU selects the same n-best lists as std::partial_sort (cpu)", "[translator]") {
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(16);
+
+  std::mt19937 rng(1234);
+  auto uniform = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+
+  for(bool ties : {false, true}) {
+    for(int trial = 0; trial < 500; ++trial) {
+      graph->clear();
+
+      // sizes that are no multiples of the vector width and first steps with a single hypothesis
+      size_t dimBatch = uniform(1, 4);
+      size_t N        = uniform(1, 8);
+      bool isFirst    = uniform(0, 1) == 1;
+      size_t inputN   = isFirst ? 1 : N;
+      size_t dimVocab = uniform((int)N, 300);
+      size_t batchOffset = inputN * dimVocab;
+
+      // distinct scores unless ties are tested, then drawn from a few values only; some hypotheses
+      // are masked as in BeamSearch, leaving at least N valid ones per batch entry
+      std::vector<float> scores(dimBatch * batchOffset);
+      for(size_t b = 0; b < dimBatch; ++b) {
+        auto entry = scores.begin() + b * batchOffset;
+        for(size_t i = 0; i < batchOffset; ++i)
+          entry[i] = ties ? -(float)uniform(0, 5) : -0.01f * (float)i;
+        std::shuffle(entry, entry + batchOffset, rng);
+        size_t masked = uniform(0, (int)(batchOffset - N));
+        for(size_t i = 0; i < batchOffset && masked > 0; ++i)
+          if(entry[i] < -0.5f) {
+            entry[i] = std::numeric_limits<float>::lowest();
+            masked--;
+          }
+      }
+
+      auto logProbs = graph->constant({(int)dimBatch, 1, (int)inputN, (int)dimVocab}, inits::fromVector(scores));
+      graph->forward();
+
+      std::vector<float> costs, expectedCosts;
+      std::vector<unsigned> keys, expectedKeys;
+      auto getNBestList = createGetNBestListFn(N, dimBatch, graph->getDeviceId());
+      getNBestList(logProbs->val(), N, costs, keys, isFirst);
+      partialSortNBest(scores, dimBatch, N, expectedCosts, expectedKeys);
+
+      REQUIRE(costs == expectedCosts);
+      if(ties) { // the order of equal scores is unspecified, but they need to be the scores of the keys
+        for(size_t i = 0; i < keys.size(); ++i) {
+          CHECK(keys[i] / batchOffset == i / N);
+          CHECK(scores[keys[i]] == costs[i]);
+        }
+      } else {
+        REQUIRE(keys == expectedKeys);
+      }
+    }
+  }
+}
@@ -1049,3 +1049,154 @@ TEST_CASE("Compare aggregate operator", "[graph]") {
 
   #endif
   #endif
+
+#ifdef BLAS_FOUND
+TEST_CASE("Fused attention matches bdot and softmax composition (cpu)", "[operator]") {
+  auto floatApprox = [](float x, float y) -> bool { return x == Approx(y).margin(0.0001f); };
+
+  Config::seed = 1234;
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(16);
+
+  // depth 16 and 12 exercise the float32x8 and float32x4 kernels, depth 5 the scalar one
+  for(int dimDepth : {16, 12, 5}) {
+    graph->clear();
+
+    int dimBatch = 2, dimHeads = 3, dimQuery = 4, dimKeys = 7;
+    std::vector<float> vq(dimBatch * dimHeads * dimQuery * dimDepth);
+    std::vector<float> vk(dimBatch * dimHeads * dimKeys * dimDepth);
+    std::vector<float> vv(vk.size());
+    for(size_t i = 0; i < vq.size(); ++i)
+      vq[i] = std::sin(0.37f * i);
+    for(size_t i = 0; i < vk.size(); ++i) {
+      vk[i] = std::cos(0.21f * i);
+      vv[i] = std::sin(0.11f * i + 1.f);
+    }
+
+    // second sentence is only 5 keys long
+    std::vector<float> vmask(dimBatch * dimKeys, 0.f);
+    for(int j = 5; j < dimKeys; ++j)
+      vmask[dimKeys + j] = -99999999.f;
+
+    auto q    = graph->constant({dimBatch, dimHeads, dimQuery, dimDepth}, inits::fromVector(vq));
+    auto k    = graph->constant({dimBatch, dimHeads, dimKeys, dimDepth}, inits::fromVector(vk));
+    auto v    = graph->constant({dimBatch, dimHeads, dimKeys, dimDepth}, inits::fromVector(vv));
+    auto mask = graph->constant({dimBatch, 1, 1, dimKeys}, inits::fromVector(vmask));
+
+    float scale = 1.f / std::sqrt((float)dimDepth);
+    auto fused = attention(q, k, v, mask, scale);
+    auto composed = bdot(softmax(bdot(q, k, false, true, scale) + mask), v);
+    CHECK(fused->type() == "fused_attention");
+
+    graph->forward();
+
+    std::vector<float> values1, values2;
+    fused->val()->get(values1);
+    composed->val()->get(values2);
+
+    CHECK(fused->shape() == composed->shape());
+    CHECK( std::equal(values1.begin(), values1.end(), values2.begin(), floatApprox) );
+  }
+}
+
+TEST_CASE("Fused attention broadcasts keys and mask over the beam (cpu)", "[operator]") {
+  auto floatApprox = [](float x, float y) -> bool { return x == Approx(y).margin(0.0001f); };
+
+  Config::seed = 1234;
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(16);
+
+  // cross-attention during beam search: queries are [beam depth * batch size, heads, ...] in
+  // beam-major order, keys, values and source mask only [batch size, ...]
+  for(int dimDepth : {16, 12, 5}) {
+    graph->clear();
+
+    int dimBeam = 3, dimBatch = 2, dimHeads = 2, dimQuery = 1, dimKeys = 6;
+    std::vector<float> vq(dimBeam * dimBatch * dimHeads * dimQuery * dimDepth);
+    std::vector<float> vk(dimBatch * dimHeads * dimKeys * dimDepth);
+    std::vector<float> vv(vk.size());
+    for(size_t i = 0; i < vq.size(); ++i)
+      vq[i] = std::sin(0.37f * i);
+    for(size_t i = 0; i < vk.size(); ++i) {
+      vk[i] = std::cos(0.21f * i);
+      vv[i] = std::sin(0.11f * i + 1.f);
+    }
+
+    // second sentence is only 4 keys long
+    std::vector<float> vmask(dimBatch * dimKeys, 0.f);
+    for(int j = 4; j < dimKeys; ++j)
+      vmask[dimKeys + j] = -99999999.f;
+
+    auto q    = graph->constant({dimBeam * dimBatch, dimHeads, dimQuery, dimDepth}, inits::fromVector(vq));
+    auto k    = graph->constant({dimBatch, dimHeads, dimKeys, dimDepth}, inits::fromVector(vk));
+    auto v    = graph->constant({dimBatch, dimHeads, dimKeys, dimDepth}, inits::fromVector(vv));
+    auto mask = graph->constant({dimBatch, 1, 1, dimKeys}, inits::fromVector(vmask));
+
+    float scale = 1.f / std::sqrt((float)dimDepth);
+    auto fused = attention(q, k, v, mask, scale);
+    CHECK(fused->type() == "fused_attention");
+
+    // reference with keys, values and mask tiled over the beam explicitly
+    auto kBeam    = repeat(k, dimBeam, /*axis=*/-4);
+    auto vBeam    = repeat(v, dimBeam, /*axis=*/-4);
+    auto maskBeam = repeat(mask, dimBeam, /*axis=*/-4);
+    auto composed = bdot(softmax(bdot(q, kBeam, false, true, scale) + maskBeam), vBeam);
+
+    graph->forward();
+
+    std::vector<float> values1, values2;
+    fused->val()->get(values1);
+    composed->val()->get(values2);
+
+    CHECK(fused->shape() == composed->shape());
+    CHECK( std::equal(values1.begin(), values1.end(), values2.begin(), floatApprox) );
+  }
+}
+
+TEST_CASE("Fused attention broadcasts a single mask position over the keys (cpu)", "[operator]") {
+  auto floatApprox = [](float x, float y) -> bool { return x == Approx(y).margin(0.0001f); };
+
+  Config::seed = 1234;
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(16);
+
+  // decoder self-attention of a single step with cached keys and values: the triangle mask of the
+  // step covers one position while the keys cover all previous ones
+  for(int dimDepth : {16, 12, 5}) {
+    graph->clear();
+
+    int dimBatch = 2, dimHeads = 2, dimQuery = 1, dimKeys = 3;
+    std::vector<float> vq(dimBatch * dimHeads * dimQuery * dimDepth);
+    std::vector<float> vk(dimBatch * dimHeads * dimKeys * dimDepth);
+    std::vector<float> vv(vk.size());
+    for(size_t i = 0; i < vq.size(); ++i)
+      vq[i] = std::sin(0.37f * i);
+    for(size_t i = 0; i < vk.size(); ++i) {
+      vk[i] = std::cos(0.21f * i);
+      vv[i] = std::sin(0.11f * i + 1.f);
+    }
+
+    auto q    = graph->constant({dimBatch, dimHeads, dimQuery, dimDepth}, inits::fromVector(vq));
+    auto k    = graph->constant({dimBatch, dimHeads, dimKeys, dimDepth}, inits::fromVector(vk));
+    auto v    = graph->constant({dimBatch, dimHeads, dimKeys, dimDepth}, inits::fromVector(vv));
+    auto mask = graph->constant({1, 1, 1, 1}, inits::fromValue(-1.f));
+
+    float scale = 1.f / std::sqrt((float)dimDepth);
+    auto fused = attention(q, k, v, mask, scale);
+    auto composed = bdot(softmax(bdot(q, k, false, true, scale) + mask), v);
+    CHECK(fused->type() == "fused_attention");
+
+    graph->forward();
+
+    std::vector<float> values1, values2;
+    fused->val()->get(values1);
+    composed->val()->get(values2);
+
+    CHECK(fused->shape() == composed->shape());
+    CHECK( std::equal(values1.begin(), values1.end(), values2.begin(), floatApprox) );
+  }
+}
+#endif
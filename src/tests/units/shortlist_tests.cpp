@@ -0,0 +1,161 @@
+#include "catch.hpp"
+#include "common/options.h"
+#include "data/corpus_base.h"
+#include "data/shortlist.h"
+#include "data/vocab.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <unordered_set>
+
+using namespace marian;
+
+namespace {
+
+void writeLines(const std::string& fname, const std::vector<std::string>& lines) {
+  std::ofstream out(fname);
+  for(const auto& line : lines)
+    out << line << "\n";
+}
+
+Ptr<Vocab> loadVocab(const std::string& fname, size_t batchIndex) {
+  auto vocab = New<Vocab>(New<Options>(), batchIndex);
+  vocab->load(fname);
+  return vocab;
+}
+
+// exposes the candidate union shared by the lexical and binary shortlist generators
+struct CandidateGenerator : public data::ShortlistGenerator {
+  using data::ShortlistGenerator::generateFromCandidates;
+  Ptr<data::Shortlist> generate(Ptr<data::CorpusBatch> /*batch*/) const override { return nullptr; }
+};
+
+// the union as computed before the bitset version, with hash sets and a final sort
+std::vector<WordIndex> hashSetCandidates(const Words& srcWords,
+                                         size_t firstNum,
+                                         size_t trgVocabSize,
+                                         bool shared,
+                                         const std::vector<uint64_t>& offsets,
+                                         const std::vector<WordIndex>& trgIds) {
+  std::unordered_set<WordIndex> indexSet;
+  for(WordIndex i = 0; i < firstNum && i < trgVocabSize; ++i)
+    indexSet.insert(i);
+
+  std::unordered_set<WordIndex> srcSet;
+  for(auto w : srcWords)
+    srcSet.insert(w.toWordIndex());
+
+  for(auto i : srcSet) {
+    if(shared)
+      indexSet.insert(i);
+    for(uint64_t j = offsets[i]; j < offsets[i + 1]; ++j)
+      indexSet.insert(trgIds[j]);
+  }
+
+  WordIndex i = static_cast<WordIndex>(firstNum);
+  while(indexSet.size() % 8 != 0) {
+    indexSet.insert(i);
+    i++;
+  }
+
+  std::vector<WordIndex> indices(indexSet.begin(), indexSet.end());
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+
+Ptr<data::CorpusBatch> sourceBatch(Ptr<const Vocab> vocab, const std::vector<WordIndex>& ids, size_t size) {
+  auto subBatch = New<data::SubBatch>(size, ids.size() / size, vocab);
+  for(size_t i = 0; i < ids.size(); ++i)
+    subBatch->data()[i] = Word::fromWordIndex(ids[i]);
+  return New<data::CorpusBatch>(std::vector<Ptr<data::SubBatch>>({subBatch}));
+}
+
+}  // namespace
+
+TEST_CASE("Binary shortlist round trip", "[data]") {
+  const std::string srcVocabPath = "shortlist_tests.src.txt";
+  const std::string trgVocabPath = "shortlist_tests.trg.txt";
+  const std::string smallVocabPath = "shortlist_tests.small.txt";
+  const std::string lexPath = "shortlist_tests.lex";
+  const std::string binPath = "shortlist_tests.lex.bin";
+
+  writeLines(srcVocabPath, {"</s>", "<unk>", "a", "b", "c", "d"});
+  std::vector<std::string> trgWords = {"</s>", "<unk>"};
+  for(int i = 0; i < 30; ++i)
+    trgWords.push_back("t" + std::to_string(i));
+  writeLines(trgVocabPath, trgWords);
+  writeLines(smallVocabPath, {"</s>", "<unk>", "t0", "t1"});
+  writeLines(lexPath, {"t3 a 0.5", "t7 a 0.3", "t9 a 0.1", "t12 b 0.9", "t25 b 0.05",
+                       "t20 c 0.4", "t21 c 0.4", "t22 c 0.1", "t23 c 0.05", "NULL d 0.5"});
+
+  auto srcVocab = loadVocab(srcVocabPath, 0);
+  auto trgVocab = loadVocab(trgVocabPath, 1);
+
+  auto lexOptions = New<Options>("shortlist", std::vector<std::string>({lexPath, "2", "2"}));
+  data::LexicalShortlistGenerator lexical(lexOptions, srcVocab, trgVocab);
+  lexical.saveBinary(binPath);
+
+  auto binOptions = New<Options>("shortlist", std::vector<std::string>({binPath}));
+  REQUIRE(data::BinaryShortlistGenerator::isBinaryShortlist(binPath));
+  REQUIRE_FALSE(data::BinaryShortlistGenerator::isBinaryShortlist(lexPath));
+  auto binary = data::createShortlistGenerator(binOptions, srcVocab, trgVocab);
+  REQUIRE(std::dynamic_pointer_cast<data::BinaryShortlistGenerator>(binary));
+
+  SECTION("the binary shortlist yields the same candidates as the text one") {
+    // source words a, c, </s> and b, d, </s>
+    auto batch = sourceBatch(srcVocab, {2, 3, 4, 5, 0, 0}, 2);
+    auto expected = lexical.generate(batch)->indices();
+    auto actual = binary->generate(batch)->indices();
+    CHECK(actual == expected);
+    CHECK(expected.size() % 8 == 0);
+  }
+
+  SECTION("the binary shortlist is rejected with other vocabularies") {
+    auto smallVocab = loadVocab(smallVocabPath, 1);
+    marian::setThrowExceptionOnAbort(true);
+    CHECK_THROWS_AS(data::createShortlistGenerator(binOptions, srcVocab, smallVocab), MarianRuntimeException);
+    marian::setThrowExceptionOnAbort(false);
+  }
+
+  for(auto path : {srcVocabPath, trgVocabPath, smallVocabPath, lexPath, binPath})
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Shortlist candidates from bitsets match those from hash sets", "[data]") {
+  std::mt19937 rng(1234);
+  auto uniform = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+
+  for(int trial = 0; trial < 300; ++trial) {
+    size_t numSrc       = uniform(1, 500);
+    size_t trgVocabSize = uniform(1, 1000);
+    size_t firstNum     = uniform(0, 120);
+    bool shared         = uniform(0, 1) == 1;
+    if(shared) // source words are target words as well
+      trgVocabSize = std::max(trgVocabSize, numSrc);
+
+    // random pruned lex table in CSR layout, sorted candidates per source word
+    std::vector<uint64_t> offsets = {0};
+    std::vector<WordIndex> trgIds;
+    for(size_t w = 0; w < numSrc; ++w) {
+      std::vector<WordIndex> candidates;
+      for(int k = uniform(0, 20); k > 0; --k)
+        candidates.push_back((WordIndex)uniform(0, (int)trgVocabSize - 1));
+      std::sort(candidates.begin(), candidates.end());
+      candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+      trgIds.insert(trgIds.end(), candidates.begin(), candidates.end());
+      offsets.push_back(trgIds.size());
+    }
+
+    // a batch with repeated source words
+    Words srcWords;
+    for(int k = uniform(1, 100); k > 0; --k)
+      srcWords.push_back(Word::fromWordIndex(uniform(0, (int)numSrc - 1)));
+
+    auto expected = hashSetCandidates(srcWords, firstNum, trgVocabSize, shared, offsets, trgIds);
+    auto shortlist = CandidateGenerator::generateFromCandidates(
+        srcWords, firstNum, trgVocabSize, shared, offsets.data(), trgIds.data(), numSrc);
+    REQUIRE(shortlist->indices() == expected);
+  }
+}
@@ -0,0 +1,124 @@
+#include "catch.hpp"
+#include "common/config.h"
+#include "common/config_parser.h"
+#include "data/batch_generator.h"
+#include "data/corpus.h"
+#include "graph/expression_graph.h"
+#include "models/model_factory.h"
+#include "translator/greedy_search.h"
+#include "translator/scorers.h"
+#include "translator/speculative_search.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+using namespace marian;
+
+namespace {
+
+void writeLines(const std::string& fname, const std::vector<std::string>& lines) {
+  std::ofstream out(fname);
+  for(const auto& line : lines)
+    out << line << "\n";
+}
+
+// Saves a randomly initialized tiny transformer with the given vocabulary size and decoder depth
+void saveModel(const std::string& fname, Ptr<Options> options, Ptr<Vocab> vocab, int dimVocab, int decDepth) {
+  auto modelOptions = New<Options>(options->clone());
+  modelOptions->set("type", "transformer", "dim-vocabs", std::vector<int>({dimVocab, dimVocab}));
+  modelOptions->set("dim-emb", 32, "transformer-heads", 4, "transformer-dim-ffn", 64, "tied-embeddings-all", true);
+  modelOptions->set("enc-depth", 1, "dec-depth", decDepth);
+
+  auto graph = New<ExpressionGraph>();
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(16);
+  auto model = models::createModelFromOptions(modelOptions, models::usage::raw);
+  auto batch = data::CorpusBatch::fakeBatch({5, 5}, {vocab, vocab}, 2, modelOptions);
+  model->build(graph, batch);
+  graph->forward();
+  model->save(graph, fname);
+}
+
+}  // namespace
+
+TEST_CASE("SpeculativeSearch translates as GreedySearch", "[translator]") {
+  const std::string prefix = "speculative_search_tests";
+  const std::string vocabPath = prefix + ".vocab", inputPath = prefix + ".src";
+  const std::string modelPath = prefix + ".model.npz", draftPath = prefix + ".draft.npz";
+
+  std::vector<std::string> words = {"</s>", "<unk>"};
+  for(int i = 0; i < 30; ++i)
+    words.push_back("w" + std::to_string(i));
+  writeLines(vocabPath, words);
+
+  std::mt19937 rng(1234);
+  std::vector<std::string> lines;
+  for(size_t i = 0; i < 12; ++i) {
+    std::string line;
+    for(size_t j = 0, n = 1 + rng() % 10; j < n; ++j)
+      line += (j > 0 ? " w" : "w") + std::to_string(rng() % 30);
+    lines.push_back(line);
+  }
+  writeLines(inputPath, lines);
+
+  // all options of marian-decoder with their defaults
+  auto options = New<Options>(ConfigParser(cli::mode::translation).getConfig());
+  options->set("models", std::vector<std::string>({modelPath}), "speculative-draft", draftPath);
+  options->set("vocabs", std::vector<std::string>({vocabPath, vocabPath}), "input", std::vector<std::string>({inputPath}));
+  options->set("beam-size", 1, "speculative-tokens", 3, "mini-batch", 4, "maxi-batch", 1);
+  options->set("inference", true, "shuffle", "none");
+
+  auto trgVocab = New<Vocab>(options, 1);
+  trgVocab->load(vocabPath);
+  const int dimVocab = (int)trgVocab->size();
+
+  Config::seed = 1234;
+  saveModel(modelPath, options, trgVocab, dimVocab, /*decDepth=*/2);
+
+  auto graph = New<ExpressionGraph>(/*inference=*/true);
+  graph->setDevice({0, DeviceType::cpu});
+  graph->reserveWorkspaceMB(64);
+  auto scorers = createScorers(options);
+  for(auto scorer : scorers)
+    scorer->init(graph);
+
+  SECTION("draft with the same target vocabulary") {
+    saveModel(draftPath, options, trgVocab, dimVocab, /*decDepth=*/1);
+    auto draft = createDraftScorer(options, trgVocab);
+    draft->init(graph);
+    graph->forward();
+
+    auto speculativeScorers = scorers;
+    speculativeScorers.push_back(draft);
+
+    auto corpus = New<data::Corpus>(options, /*translate=*/true);
+    data::BatchGenerator<data::Corpus> batchGenerator(corpus, options, nullptr, /*runAsync=*/false);
+    batchGenerator.prepare();
+
+    size_t sentences = 0, targetWords = 0;
+    for(auto batch : batchGenerator) {
+      auto expected = GreedySearch(options, scorers, trgVocab).search(graph, batch);
+      auto histories = SpeculativeSearch(options, speculativeScorers, trgVocab).search(graph, batch);
+      REQUIRE(histories.size() == expected.size());
+      for(size_t i = 0; i < histories.size(); ++i) {
+        CHECK(histories[i]->getLineNum() == expected[i]->getLineNum());
+        CHECK(std::get<0>(histories[i]->top()) == std::get<0>(expected[i]->top()));
+        targetWords += std::get<0>(expected[i]->top()).size();
+      }
+      sentences += histories.size();
+    }
+    CHECK(sentences == lines.size());
+    CHECK(targetWords > sentences); // not only empty translations
+  }
+
+  SECTION("draft with a different target vocabulary") {
+    saveModel(draftPath, options, trgVocab, dimVocab + 2, /*decDepth=*/1);
+    marian::setThrowExceptionOnAbort(true);
+    CHECK_THROWS_AS(createDraftScorer(options, trgVocab), MarianRuntimeException);
+    marian::setThrowExceptionOnAbort(false);
+  }
+
+  for(auto path : {vocabPath, inputPath, modelPath, draftPath})
+    std::remove(path.c_str());
+}
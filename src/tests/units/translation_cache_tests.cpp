@@ -0,0 +1,37 @@
+#include "catch.hpp"
+#include "translator/translation_cache.h"
+
+using namespace marian;
+
+TEST_CASE("TranslationCache", "[translator]") {
+  TranslationCache::Output output;
+
+  SECTION("cached outputs are found") {
+    TranslationCache cache(1024 * 1024, 4);
+    CHECK( !cache.get("a", output) );
+    cache.put("a", {"translation a", ""});
+    REQUIRE( cache.get("a", output) );
+    CHECK( output.best1 == "translation a" );
+    CHECK( cache.hits() == 1 );
+    CHECK( cache.misses() == 1 );
+  }
+
+  SECTION("the least recently used entry is evicted") {
+    TranslationCache cache(500, 1); // room for two entries of about 200 bytes
+    std::string padding(64, 'x');
+    cache.put("a", {padding, ""});
+    cache.put("b", {padding, ""});
+    CHECK( cache.get("a", output) ); // b is now the least recently used
+    cache.put("c", {padding, ""});
+    CHECK( cache.evictions() == 1 );
+    CHECK( cache.get("a", output) );
+    CHECK( !cache.get("b", output) );
+    CHECK( cache.get("c", output) );
+  }
+
+  SECTION("outputs larger than a shard are not cached") {
+    TranslationCache cache(1000, 4);
+    cache.put("a", {std::string(1000, 'x'), ""});
+    CHECK( !cache.get("a", output) );
+  }
+}
@@ -0,0 +1,98 @@
+#include "training/checkpoint_writer.h"
+#include "common/logging.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace marian {
+
+CheckpointWriter::CheckpointWriter(size_t maxBytes)
+    : maxBytes_(maxBytes), worker_([this]() { run(); }) {}
+
+CheckpointWriter::~CheckpointWriter() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true; // the worker drains the queue before it stops
+  }
+  changed_.notify_all();
+  worker_.join();
+}
+
+void CheckpointWriter::saveItems(const std::string& fileName, std::vector<io::Item>&& items) {
+  File file;
+  file.fileName = fileName;
+  file.items = std::move(items);
+  file.bytes = 0;
+  for(const auto& item : file.items)
+    file.bytes += item.bytes.size();
+  enqueue(std::move(file));
+}
+
+void CheckpointWriter::saveText(const std::string& fileName, const std::string& text) {
+  File file;
+  file.fileName = fileName;
+  file.text = text;
+  file.bytes = text.size();
+  enqueue(std::move(file));
+}
+
+void CheckpointWriter::enqueue(File&& file) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // always accept a file if nothing else is pending, even if it is larger than the budget
+  changed_.wait(lock, [&]() { return pendingBytes_ == 0 || pendingBytes_ + file.bytes <= maxBytes_; });
+  pendingBytes_ += file.bytes;
+  queue_.push_back(std::move(file));
+  changed_.notify_all();
+}
+
+void CheckpointWriter::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [&]() { return queue_.empty() && !writing_; });
+}
+
+void CheckpointWriter::run() {
+  for(;;) {
+    File file;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+      if(queue_.empty()) // stop_ and nothing left to write
+        return;
+      file = std::move(queue_.front());
+      queue_.pop_front();
+      writing_ = true;
+    }
+
+    write(file);
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      pendingBytes_ -= file.bytes;
+      writing_ = false;
+    }
+    changed_.notify_all();
+  }
+}
+
+void CheckpointWriter::write(const File& file) {
+  // keep the suffix, io::saveItems() determines the format from it
+  std::string tmpName = file.fileName;
+  auto dot = tmpName.find_last_of('.');
+  if(dot == std::string::npos || tmpName.find('/', dot) != std::string::npos)
+    tmpName += ".tmp";
+  else
+    tmpName.insert(dot, ".tmp");
+
+  if(file.items.empty()) {
+    std::ofstream fout(tmpName);
+    fout << file.text;
+  } else {
+    io::saveItems(tmpName, file.items);
+  }
+
+  ABORT_IF(std::rename(tmpName.c_str(), file.fileName.c_str()) != 0,
+           "Could not rename {} to {}", tmpName, file.fileName);
+  LOG(debug, "[training] Checkpoint file {} written in the background", file.fileName);
+}
+
+}  // namespace marian
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "common/definitions.h"
+#include "common/io.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace marian {
+
+// Writes checkpoint files on a background thread, used with --async-save. The training thread only
+// copies parameters and optimizer state to host memory (io::Item) and queues them here; serializing
+// them into .npz/.bin files and writing to disk happens off the critical path. Files are written in
+// the order they were queued, each into a temporary file that is renamed to its final name once it
+// is complete, so an interrupted write never leaves a truncated checkpoint behind.
+//
+// The host memory held by queued files is bounded by maxBytes: queuing blocks while the pending
+// files would exceed it, so at most about one checkpoint is being written while the next one is
+// snapshotted. wait() blocks until everything queued so far has been written.
+class CheckpointWriter {
+private:
+  struct File {
+    std::string fileName;
+    std::vector<io::Item> items; // model or optimizer file if not empty
+    std::string text;            // otherwise a text file, e.g. the training progress
+    size_t bytes;
+  };
+
+  size_t maxBytes_;
+
+  std::deque<File> queue_;
+  size_t pendingBytes_{0}; // bytes of queued files and of the file being written
+  bool writing_{false};
+  bool stop_{false};
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+
+  std::thread worker_; // declared last, started after all other members have been initialized
+
+  void enqueue(File&& file);
+  void run();
+  void write(const File& file);
+
+public:
+  CheckpointWriter(size_t maxBytes);
+  ~CheckpointWriter();
+
+  // Queues a model or optimizer file, blocks while the memory budget is exhausted
+  void saveItems(const std::string& fileName, std::vector<io::Item>&& items);
+
+  // Queues a text file, e.g. config or training progress
+  void saveText(const std::string& fileName, const std::string& text);
+
+  // Blocks until all queued files have been written
+  void wait();
+};
+
+}  // namespace marian
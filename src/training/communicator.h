@@ -5,6 +5,10 @@
 #include "functional/functional.h"
 #include "tensors/tensor_operators.h"
 #include "optimizers/optimizers.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #if MPI_FOUND
 #ifdef __GNUC__
 #pragma GCC diagnostic push
@@ -91,12 +95,106 @@ public:
 Ptr<IMPIWrapper> initMPI(bool multiThreaded);
 void finalizeMPI(Ptr<IMPIWrapper>&&);
 
+// Persistent threads for the shards of DefaultCommunicator. run(task) calls task(idx) for every
+// shard, shard 0 on the calling thread and the others on threads that wait for the next call, and
+// returns when all have finished. Tasks can call barrier() to wait for all other shards, e.g. between
+// reducing gradients and resetting them.
+class ShardThreadTeam {
+private:
+  size_t size_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable started_;
+  std::condition_variable finished_;
+  std::condition_variable barrierReached_;
+
+  const std::function<void(size_t)>* task_{nullptr};
+  size_t round_{0};   // incremented for each run()
+  size_t running_{0}; // threads still working on the current round
+  bool stop_{false};
+
+  size_t arrived_{0};      // shards waiting at the barrier
+  size_t barrierRound_{0}; // incremented each time all shards have reached the barrier
+
+  void work(size_t idx) {
+    size_t seen = 0;
+    for(;;) {
+      const std::function<void(size_t)>* task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        started_.wait(lock, [&]() { return stop_ || round_ != seen; });
+        if(stop_)
+          return;
+        seen = round_;
+        task = task_;
+      }
+
+      (*task)(idx);
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      if(--running_ == 0)
+        finished_.notify_one();
+    }
+  }
+
+public:
+  ShardThreadTeam(size_t size) : size_(size) {
+    for(size_t idx = 1; idx < size_; ++idx)
+      threads_.emplace_back([this, idx]() { work(idx); });
+  }
+
+  ~ShardThreadTeam() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    started_.notify_all();
+    for(auto& t : threads_)
+      t.join();
+  }
+
+  void run(const std::function<void(size_t)>& task) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_ = &task;
+      running_ = size_ - 1;
+      round_++;
+    }
+    started_.notify_all();
+
+    task(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [&]() { return running_ == 0; });
+  }
+
+  void barrier() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t round = barrierRound_;
+    if(++arrived_ == size_) {
+      arrived_ = 0;
+      barrierRound_++;
+      barrierReached_.notify_all();
+    } else {
+      barrierReached_.wait(lock, [&]() { return barrierRound_ != round; });
+    }
+  }
+};
+
 // DefaultCommunicator is used when we cannot use NCCLCommunicator, e.g. if it is not compiled in
 class DefaultCommunicator : public ICommunicator {
 private:
   std::vector<Ptr<TensorAllocator>> paramsAllocs_;
   std::vector<Tensor> tmpTensors_;
 
+  // threads running foreach(), kept alive between calls
+  mutable UPtr<ShardThreadTeam> team_;
+
+  // if all graphs are on the CPU with float32 gradients, the shards of the other graphs are summed
+  // directly from their memory instead of being copied to tmpTensors_ first
+  bool sharedMemory_{true};
+
   void lazyInit() {
     if(tmpTensors_.size() == 0) {
       int totalSize = (int)graphs_[0]->params()->vals()->size();
@@ -124,9 +222,12 @@ private:
   }
 
 public:
-  DefaultCommunicator(const std::vector<Ptr<ExpressionGraph>>& graphs, Ptr<IMPIWrapper> mpi)
-      : ICommunicator(graphs) {
+  // sharedMemory = false always copies the shards through tmpTensors_, as for GPUs
+  DefaultCommunicator(const std::vector<Ptr<ExpressionGraph>>& graphs, Ptr<IMPIWrapper> mpi, bool sharedMemory = true)
+      : ICommunicator(graphs), sharedMemory_(sharedMemory) {
     ABORT_IF(mpi && mpi->numMPIProcesses() != 1, "DefaultCommunicator does not support multi-process MPI");
+    for(auto graph : graphs_)
+      sharedMemory_ &= graph->getDeviceId().type == DeviceType::cpu;
   }
 
   ~DefaultCommunicator() override {}
@@ -137,31 +238,54 @@ public:
     size_t totalSize = graphs_[0]->params()->vals()->size();
     size_t shardSize = (size_t)ceil(totalSize / (float)graphs_.size());
 
-    size_t pos = 0;
-    std::vector<std::thread> group;
-    // iterate over all shards
-    for(size_t idx = 0; idx < graphs_.size(); ++idx) {
-      size_t size = std::min(shardSize, totalSize);
-
-      if (parallel)
-        group.emplace_back(func, idx, pos, pos+size);
-      else
-        func(idx, pos, pos+size);
+    // shard idx covers [begin, end)
+    auto shard = [&](size_t idx) {
+      size_t begin = std::min(idx * shardSize, totalSize);
+      size_t end   = std::min(begin + shardSize, totalSize);
+      func(idx, begin, end);
+    };
 
-      pos += size;
-      totalSize -= size;
+    if(parallel) {
+      if(!team_)
+        team_.reset(new ShardThreadTeam(graphs_.size()));
+      team_->run(shard);
+    } else {
+      // iterate over all shards
+      for(size_t idx = 0; idx < graphs_.size(); ++idx)
+        shard(idx);
     }
-    for(auto& t : group) // (note: group is empty is not parallel)
-      t.join();
   }
 
   void scatterReduceAndResetGrads() const override {
-    const_cast<DefaultCommunicator*>(this)->lazyInit();
+    bool sharedMemory = sharedMemory_;
+    for(auto graph : graphs_)
+      sharedMemory &= graph->params()->grads()->type() == Type::float32;
+
+    if(!sharedMemory)
+      const_cast<DefaultCommunicator*>(this)->lazyInit();
 
     // Gather gradients from different devices into current gradient shards
-    auto scatter = [this](size_t idx, size_t begin, size_t end) {
+    auto scatter = [this, sharedMemory](size_t idx, size_t begin, size_t end) {
       auto curGrad = graphs_[idx]->params()->grads()->subtensor(begin, end-begin);
 
+      if(sharedMemory) {
+        // sum all other shards in one pass over cache-sized blocks
+        std::vector<const float*> others;
+        for(auto graph : graphs_)
+          if(graph != graphs_[idx])
+            others.push_back(graph->params()->grads()->data<float>() + begin);
+
+        float* out = curGrad->data<float>();
+        const size_t block = 4096;
+        for(size_t pos = 0; pos < end - begin; pos += block) {
+          size_t n = std::min(block, end - begin - pos);
+          for(auto other : others)
+            for(size_t i = 0; i < n; ++i)
+              out[pos + i] += other[pos + i];
+        }
+        return;
+      }
+
       // collect and sum gradients
       for(auto graph : graphs_) {
         if(graph != graphs_[idx]) {
@@ -183,8 +307,13 @@ public:
         grad->subtensor(end, grad->size()-end)->set(0);
     };
 
-    foreach(scatter);
-    foreach(reset);
+    // other shards read the gradients of this graph until all have passed the barrier
+    foreach([&](size_t idx, size_t begin, size_t end) {
+      scatter(idx, begin, end);
+      if(team_)
+        team_->barrier();
+      reset(idx, begin, end);
+    });
   }
 
   void allGatherParams() const override {
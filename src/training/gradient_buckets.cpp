@@ -0,0 +1,170 @@
+#include "training/gradient_buckets.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace marian {
+
+GradientBuckets::GradientBuckets(const std::vector<Ptr<ExpressionGraph>>& graphs, size_t bucketBytes)
+    : graphs_(graphs), bucketSize_(std::max(bucketBytes / sizeof(float), (size_t)1)), shardSize_(0),
+      ready_(graphs.size()), team_(graphs.size()) {
+  for(auto graph : graphs_)
+    ABORT_IF(graph->getDeviceId().type != DeviceType::cpu,
+             "Overlapped gradient communication is only supported for CPU training");
+  reducer_ = std::thread([this]() { run(); });
+}
+
+GradientBuckets::~GradientBuckets() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  changed_.notify_all();
+  reducer_.join();
+}
+
+// Groups parameters into buckets of about bucketSize_ elements in memory order. Parameters are
+// never split, so a parameter larger than a bucket gets a bucket of its own.
+void GradientBuckets::init() {
+  auto params = graphs_[0]->params();
+  ABORT_IF(params->grads()->type() != Type::float32,
+           "Overlapped gradient communication requires float32 gradients");
+  const float* base = params->grads()->data<float>();
+
+  std::vector<size_t> offsets;
+  for(auto p : *params)
+    offsets.push_back(p->grad()->data<float>() - base);
+  std::sort(offsets.begin(), offsets.end());
+
+  for(auto offset : offsets) {
+    if(bucketBegins_.empty() || offset - bucketBegins_.back() >= bucketSize_) {
+      bucketBegins_.push_back(offset);
+      bucketParams_.push_back(0);
+    }
+    bucketParams_.back()++;
+  }
+  size_t totalSize = params->grads()->size();
+  bucketBegins_.push_back(totalSize);
+  ABORT_IF(bucketBegins_.front() != 0, "Gradient of first parameter does not start at offset 0??");
+
+  shardSize_ = (size_t)ceil(totalSize / (float)graphs_.size());
+  shardBuckets_.assign(graphs_.size(), 0);
+  for(size_t bucket = 0; bucket < bucketParams_.size(); ++bucket)
+    for(size_t shard = firstShard(bucket); shard < endShard(bucket); ++shard)
+      shardBuckets_[shard]++;
+
+  pending_.reset(new std::atomic<size_t>[bucketParams_.size()]);
+  LOG(info, "[training] Reducing gradients in {} buckets during the backward pass", bucketParams_.size());
+}
+
+size_t GradientBuckets::firstShard(size_t bucket) const {
+  return bucketBegins_[bucket] / shardSize_;
+}
+
+size_t GradientBuckets::endShard(size_t bucket) const {
+  return std::min((bucketBegins_[bucket + 1] + shardSize_ - 1) / shardSize_, graphs_.size());
+}
+
+void GradientBuckets::start() {
+  if(bucketBegins_.empty())
+    init();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  for(size_t bucket = 0; bucket < bucketParams_.size(); ++bucket)
+    pending_[bucket] = bucketParams_[bucket] * graphs_.size();
+  for(auto& ready : ready_)
+    ready.clear();
+  round_++;
+  changed_.notify_all();
+}
+
+size_t GradientBuckets::bucketOf(size_t idx, Expr param) {
+  size_t offset = param->grad()->data<float>() - graphs_[idx]->params()->grads()->data<float>();
+  auto it = std::upper_bound(bucketBegins_.begin(), bucketBegins_.end(), offset);
+  return std::distance(bucketBegins_.begin(), it) - 1;
+}
+
+void GradientBuckets::report(size_t bucket) {
+  if(--pending_[bucket] == 0) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      for(size_t shard = firstShard(bucket); shard < endShard(bucket); ++shard)
+        ready_[shard].push_back(bucket);
+    }
+    changed_.notify_all();
+  }
+}
+
+void GradientBuckets::gradientReady(size_t idx, Expr param) {
+  if(param->value_type() != Type::float32) // not part of graph->params(), e.g. an index
+    return;
+  report(bucketOf(idx, param));
+}
+
+void GradientBuckets::allReady(size_t /*idx*/) {
+  for(size_t bucket = 0; bucket < bucketParams_.size(); ++bucket)
+    for(size_t i = 0; i < bucketParams_[bucket]; ++i)
+      report(bucket);
+}
+
+void GradientBuckets::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [&]() { return reducedRound_ == round_; });
+}
+
+// Same result as DefaultCommunicator::scatterReduceAndResetGrads() restricted to the part of the
+// bucket in the shard
+void GradientBuckets::reduce(size_t bucket, size_t shard) {
+  size_t begin = std::max(bucketBegins_[bucket], shard * shardSize_);
+  size_t end   = std::min(bucketBegins_[bucket + 1], (shard + 1) * shardSize_);
+
+  float* out = graphs_[shard]->params()->grads()->data<float>();
+  for(size_t g = 0; g < graphs_.size(); ++g) {
+    if(g == shard)
+      continue;
+    float* other = graphs_[g]->params()->grads()->data<float>();
+    for(size_t i = begin; i < end; ++i)
+      out[i] += other[i];
+    std::fill(other + begin, other + end, 0.f);
+  }
+}
+
+// Reduces the buckets overlapping the shard in the order in which they become final
+void GradientBuckets::reduceShard(size_t shard) {
+  for(size_t reduced = 0; reduced < shardBuckets_[shard]; ++reduced) {
+    size_t bucket;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [&]() { return stop_ || !ready_[shard].empty(); });
+      if(stop_)
+        return;
+      bucket = ready_[shard].front();
+      ready_[shard].pop_front();
+    }
+    reduce(bucket, shard);
+  }
+}
+
+void GradientBuckets::run() {
+  size_t round = 0;
+  std::function<void(size_t)> task = [this](size_t shard) { reduceShard(shard); };
+  for(;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [&]() { return stop_ || round_ != round; });
+      if(stop_)
+        return;
+      round = round_;
+    }
+
+    team_.run(task); // shard 0 on this thread
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      reducedRound_ = round;
+    }
+    changed_.notify_all();
+  }
+}
+
+}  // namespace marian
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "graph/expression_graph.h"
+#include "training/communicator.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace marian {
+
+// Reduces gradients across local CPU graphs while their backward passes are still running, used by
+// SyncGraphGroup with --overlap-communication. The gradient memory is split into buckets of
+// contiguous parameters. Each graph reports parameters whose gradients are final (see
+// ExpressionGraph::setGradientReadyCallback()); once a bucket is final on all graphs, the part of it
+// in each shard is summed into the graph that owns the shard and zeroed in all others. The shards
+// are reduced in parallel by a ShardThreadTeam of its own, with one thread per shard, since the
+// team of the communicator runs the backward passes. After wait() the gradients are in the same
+// state as after DefaultCommunicator::scatterReduceAndResetGrads(), which is skipped.
+//
+// Only for graphs sharing one address space (CPU) with float32 gradients, shards are computed as in
+// DefaultCommunicator::foreach().
+class GradientBuckets {
+private:
+  std::vector<Ptr<ExpressionGraph>> graphs_;
+  size_t bucketSize_; // in elements
+  size_t shardSize_;  // in elements
+
+  std::vector<size_t> bucketBegins_; // [bucket] first element, followed by the total size
+  std::vector<size_t> bucketParams_; // [bucket] number of parameters starting in the bucket
+  std::vector<size_t> shardBuckets_; // [shard] number of buckets overlapping the shard
+  std::unique_ptr<std::atomic<size_t>[]> pending_; // [bucket] reports missing until the bucket is final
+
+  std::vector<std::deque<size_t>> ready_; // [shard] buckets final on all graphs, waiting to be reduced
+  size_t round_{0};         // incremented by start()
+  size_t reducedRound_{0};  // last round whose buckets have all been reduced
+  bool stop_{false};
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+
+  ShardThreadTeam team_;
+  std::thread reducer_; // runs each round on team_, declared last
+
+  void init();
+  size_t bucketOf(size_t idx, Expr param);
+  size_t firstShard(size_t bucket) const; // shards overlapping the bucket are [firstShard, endShard)
+  size_t endShard(size_t bucket) const;
+  void report(size_t bucket);
+  void reduce(size_t bucket, size_t shard);
+  void reduceShard(size_t shard);
+  void run();
+
+public:
+  GradientBuckets(const std::vector<Ptr<ExpressionGraph>>& graphs, size_t bucketBytes);
+  ~GradientBuckets();
+
+  // Starts a round, call before the backward passes whose gradients are to be reduced
+  void start();
+
+  // Parameter param of graph idx has its final gradient, thread-safe
+  void gradientReady(size_t idx, Expr param);
+
+  // All gradients of graph idx are final, for a graph that did not run a backward pass in this round
+  void allReady(size_t idx);
+
+  // Blocks until all buckets of the current round have been reduced
+  void wait();
+};
+
+}  // namespace marian
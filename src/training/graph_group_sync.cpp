@@ -23,6 +23,18 @@ SyncGraphGroup::SyncGraphGroup(Ptr<Options> config, Ptr<IMPIWrapper> mpi)
   // Rather, it is assumed that the communicator knows to reduce unnecessary transfers to no-ops.
   comm_ = createCommunicator(graphs_, /*noNccl=*/options_->get<bool>("no-nccl", false), /*mpi=*/mpi_);
 
+  if(options_->get<bool>("async-save", false))
+    checkpointWriter_.reset(new CheckpointWriter(options_->get<size_t>("async-save-memory") * 1024 * 1024));
+
+  overlapBucketBytes_ = options_->get<size_t>("overlap-communication", 0) * 1024 * 1024;
+  if(overlapBucketBytes_ > 0) {
+    bool allCpu = std::all_of(devices_.begin(), devices_.end(), [](DeviceId d) { return d.type == DeviceType::cpu; });
+    if(!allCpu || mpi_->numMPIProcesses() > 1 || devices_.size() < 2) {
+      LOG(warn, "[training] --overlap-communication is only supported for training on multiple CPU threads in a single process, ignored");
+      overlapBucketBytes_ = 0;
+    }
+  }
+
   auto formattedDeviceType = utils::utf8ToUpper(devices_.front().typeAsString()) + "s";
   if (mpi_->numMPIProcesses() > 1)
     LOG(info, "[training] Using {} {}, distributed over {} MPI processes", mpi_->numMPIProcesses() * devices_.size(), formattedDeviceType, mpi_->numMPIProcesses());
@@ -57,6 +69,10 @@ void SyncGraphGroup::initialize(const Ptr<data::Batch>& exampleBatch) {
     if (i > 0)
       graphs_[i]->params()->vals()->copyFrom(graphs_[0]->params()->vals());
   });
+
+  // Gradient memory is allocated now, buckets are formed from its layout
+  if(overlapBucketBytes_ > 0)
+    gradientBuckets_.reset(new GradientBuckets(graphs_, overlapBucketBytes_));
 }
 
 void SyncGraphGroup::initializeAvg() {
@@ -320,6 +336,10 @@ void SyncGraphGroup::update(std::vector<Ptr<data::Batch>> subBatches, size_t num
   }
 
   // Compute gradients
+  // With --overlap-communication, the backward pass of the last warp reports final gradients to
+  // gradientBuckets_, which reduces them into shards while the backward passes are still running.
+  if(gradientBuckets_)
+    gradientBuckets_->start();
   std::vector<StaticLoss> localDeviceLosses(devices_.size()); // [local device index] aggregate cost for each local device
   comm_->foreach([&](size_t localDeviceIndex, size_t /*begin*/, size_t /*end*/) { // parallel across devices. Aggregate for warp > 1.
     auto graph = graphs_[localDeviceIndex];
@@ -327,6 +347,7 @@ void SyncGraphGroup::update(std::vector<Ptr<data::Batch>> subBatches, size_t num
     //graph->params()->allocateBackward();
     //graph->params()->set_zero_adjoint();
     // This happens in multiple steps if there are more subbatches than devices.
+    bool reported = false;
     for (size_t warp = 0; ; warp++) {
       // Execute single forward/backward step
       auto subBatch = getSubBatch(warp, localDeviceIndex, mpi_->myMPIRank());
@@ -337,10 +358,23 @@ void SyncGraphGroup::update(std::vector<Ptr<data::Batch>> subBatches, size_t num
       graph->forward();
 
       localDeviceLosses[localDeviceIndex] += *rationalLoss;
+      bool last = !getSubBatch(warp + 1, localDeviceIndex, mpi_->myMPIRank());
+      if(gradientBuckets_ && last) {
+        graph->setGradientReadyCallback([&](Expr param) {
+          gradientBuckets_->gradientReady(localDeviceIndex, param);
+        });
+        reported = true;
+      }
       graph->backward(/*zero=*/false); // (gradients are reset before we get here)
+      graph->setGradientReadyCallback(nullptr);
     }
+    if(gradientBuckets_ && !reported) // no sub-batch for this device
+      gradientBuckets_->allReady(localDeviceIndex);
   });
+  if(gradientBuckets_)
+    gradientBuckets_->wait();
   // At this point, each device on each MPI process has a gradient aggregated over a subset of the sub-batches.
+  // With --overlap-communication, the gradients have already been reduced into shards and reset.
 
   // Update parameter shard with gradient shard
   auto update = [&](size_t idx, size_t begin, size_t end) {
@@ -366,7 +400,8 @@ void SyncGraphGroup::update(std::vector<Ptr<data::Batch>> subBatches, size_t num
   
   // model update
   if (std::isfinite(localLoss.loss) || mpi_->numMPIProcesses() > 1) { // guard against NaN (except with MPI, as this simple way could hang it)
-    comm_->scatterReduceAndResetGrads(); // reduce gradients across all devices and MPI nodes into shards
+    if(!gradientBuckets_)
+      comm_->scatterReduceAndResetGrads(); // reduce gradients across all devices and MPI nodes into shards
     comm_->foreach(update);              // per-shard model-update
     comm_->allGatherParams();            // distribute param value shards back
   
@@ -375,8 +410,13 @@ void SyncGraphGroup::update(std::vector<Ptr<data::Batch>> subBatches, size_t num
     if (options_->get<size_t>("quantize-bits") > 0)
       comm_->foreach(quantizeModel);
   }
-  else
+  else {
     LOG(info, "[training] skipping {}-th update due to loss being {}", scheduler_->numberOfBatches(), localLoss.loss);
+    if(gradientBuckets_) // the shards hold the reduced gradient, which is not used
+      comm_->foreach([&](size_t idx, size_t begin, size_t end) {
+        graphs_[idx]->params()->grads()->subtensor(begin, end - begin)->set(0.f);
+      });
+  }
 
   if(scheduler_) {
     // track and log localLoss
@@ -467,6 +507,22 @@ void SyncGraphGroup::save(bool final) /*override*/ {
   ABORT_IF(suffix != ".npz" && suffix != ".bin", "Unknown model suffix {}", suffix);
 
   barrier(); // (for better grouping of log messages)
+
+  // With --async-save, the files below are snapshotted into host memory here and written by the
+  // checkpoint writer in the background. Training continues while they are written.
+  io::SaveItemsHook hook;
+  io::SaveTextHook textHook; // the .decoder.yml files
+  if(checkpointWriter_) {
+    hook = [&](const std::string& fileName, std::vector<io::Item>&& items) {
+      checkpointWriter_->saveItems(fileName, std::move(items));
+    };
+    textHook = [&](const std::string& fileName, const std::string& text) {
+      checkpointWriter_->saveText(fileName, text);
+    };
+  }
+  io::ScopedSaveItemsHook scopedHook(hook);
+  io::ScopedSaveTextHook scopedTextHook(textHook);
+
   // if smoothing then save original (unsmoothed) parameters as well
   if(mvAvg_ && paramsAvg_.size() > 0 && isMainProcess()) // only save from one MPI process
     // Save the original parameters in model.npz.orig.npz
@@ -490,7 +546,11 @@ void SyncGraphGroup::save(bool final) /*override*/ {
     // save main model file
     builders_[0]->save(graphs_[0], name, true);
     // save scheduler-related state
-    if (scheduler_)
+    if (scheduler_ && checkpointWriter_)
+      scheduler_->save(name, [&](const std::string& fileName, const std::string& content) {
+        checkpointWriter_->saveText(fileName, content);
+      });
+    else if (scheduler_)
       scheduler_->save(name);
   }
 
@@ -506,11 +566,17 @@ void SyncGraphGroup::save(bool final) /*override*/ {
     },
     isMainProcess());
 
+  // the final checkpoint has to be on disk before training exits
+  if(final && checkpointWriter_)
+    checkpointWriter_->wait();
+
   barrier(); // (for better grouping of log messages)
 }
 
 void SyncGraphGroup::finalize() /*override*/ {
   validate();
+  if(checkpointWriter_)
+    checkpointWriter_->wait();
   Base::finalize();
 }
 
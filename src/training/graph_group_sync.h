@@ -1,9 +1,11 @@
 #pragma once
 
 #include "optimizers/quantizer.h"
+#include "training/checkpoint_writer.h"
 #include "training/graph_group.h"
 #include "training/communicator.h"
 #include "training/exponential_smoothing.h"
+#include "training/gradient_buckets.h"
 
 namespace marian {
 
@@ -26,6 +28,13 @@ class SyncGraphGroup : public GraphGroup, public ExponentialSmoothing {
 
   // model quantizer
   std::vector<Ptr<ModelQuantizer>> quantizers_;
+
+  // writes checkpoints in the background if --async-save is given
+  UPtr<CheckpointWriter> checkpointWriter_;
+
+  // reduces gradients during the backward pass if --overlap-communication is given, created in initialize()
+  UPtr<GradientBuckets> gradientBuckets_;
+  size_t overlapBucketBytes_{0};
   
   // state for update()
   bool first_{ true };                           // gets interpreted and cleared by update()
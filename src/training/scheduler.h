@@ -453,11 +453,22 @@ public:
   }
 
   void save(const std::string& name) {
+    save(name, [](const std::string& fileName, const std::string& content) {
+      std::ofstream fout(fileName);
+      fout << content;
+    });
+  }
+
+  // Serializes config options and training progress and passes them to write(fileName, content),
+  // e.g. to write them in the background together with the model
+  void save(const std::string& name,
+            const std::function<void(const std::string&, const std::string&)>& write) {
     // Save config options
-    std::ofstream fout(name + ".yml");
-    fout << options_->asYamlString();
+    write(name + ".yml", options_->asYamlString());
     // Save training progress
-    state_->save(name + ".progress.yml");
+    std::stringstream progress;
+    state_->save(progress);
+    write(name + ".progress.yml", progress.str());
   }
 
   size_t numberOfBatches() { return state_->batches; }
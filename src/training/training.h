@@ -3,6 +3,7 @@
 #include "common/config.h"
 #include "common/utils.h"
 #include "data/batch_generator.h"
+#include "data/corpus_binary.h"
 #ifndef _MSC_VER // @TODO: include SqLite in Visual Studio project
 #include "data/corpus_sqlite.h"
 #endif
@@ -31,6 +32,8 @@ public:
 #else
       ABORT("SqLite presently not supported on Windows");
 #endif
+    else if(!options_->get<std::string>("binary-corpus", "").empty())
+      dataset = New<CorpusBinary>(options_);
     else
       dataset = New<Corpus>(options_);
 
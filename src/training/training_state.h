@@ -270,6 +270,10 @@ public:
 
   void save(const std::string& name) const {
     std::ofstream fout(name);
+    save(fout);
+  }
+
+  void save(std::ostream& out) const {
     YAML::Node config;
 
     config["epochs"] = epochs;
@@ -302,7 +306,7 @@ public:
     config["seed-batch"] = seedBatch;
     config["seed-corpus"] = seedCorpus;
 
-    fout << config;
+    out << config;
   }
 
   std::string fillTemplate(const std::string& templ) const {
@@ -1,8 +1,10 @@
 #include "translator/beam_search.h"
 
+#include "common/hash.h"
 #include "data/factored_vocab.h"
 #include "translator/helpers.h"
 #include "translator/nth_element.h"
+#include "translator/parallel_ensemble.h"
 #include "data/shortlist.h"
 
 namespace marian {
@@ -13,7 +15,7 @@ Beams BeamSearch::toHyps(const std::vector<unsigned int>& nBestKeys, // [current
                          const size_t nBestBeamSize, // for interpretation of nBestKeys
                          const size_t vocabSize,     // ditto.
                          const Beams& beams,
-                         const std::vector<Ptr<ScorerState /*const*/>>& states,
+                         const std::vector<Expr>& scorerLogits,
                          Ptr<data::CorpusBatch /*const*/> batch, // for alignments only
                          Ptr<FactoredVocab/*const*/> factoredVocab, size_t factorGroup,
                          const std::vector<bool>& dropBatchEntries, // [origDimBatch] - empty source batch entries are marked with true, should be cleared after first use.
@@ -40,6 +42,16 @@ Beams BeamSearch::toHyps(const std::vector<unsigned int>& nBestKeys, // [current
     }
   }
 
+  // Keys are decomposed for all hypotheses first, so that the scores needed for n-best lists can be
+  // gathered for all of them at once
+  struct SelectedKey {
+    size_t beamHypIdx;
+    size_t currentBatchIdx;
+    size_t origBatchIdx;
+    WordIndex wordIdx;
+    bool dropHyp;
+  };
+  std::vector<SelectedKey> selectedKeys(nBestKeys.size());
   for(size_t i = 0; i < nBestKeys.size(); ++i) { // [currentDimBatch, beamSize] flattened
     // Keys encode batchIdx, beamHypIdx, and word index in the entire beam.
     // They can be between 0 and (vocabSize * nBestBeamSize * batchSize)-1.
@@ -65,6 +77,43 @@ Beams BeamSearch::toHyps(const std::vector<unsigned int>& nBestKeys, // [current
     } else { // we are not dropping anything, just assign the normal index
       wordIdx = (WordIndex)(key % vocabSize);
     }
+    selectedKeys[i] = {beamHypIdx, currentBatchIdx, origBatchIdx, wordIdx, dropHyp};
+  }
+
+  // Set score breakdown for n-best lists: the scores of the selected words under each scorer are
+  // gathered by one rows() node per scorer and copied to the host at once, instead of reading every
+  // element from the device separately
+  std::vector<float> breakDownScores; // [scorer][key] flattened
+  const bool nbest = options_->get<bool>("n-best");
+  if(nbest && !selectedKeys.empty()) {
+    std::vector<Expr> selectedLogits;
+    for(auto logits : scorerLogits) { // [maxBeamSize, 1, currentDimBatch, dimFactorVocab]
+      // @TODO: use a function on shape() to index, or new method val->at({i1, i2, i3, i4}) with broadcasting
+      bool firstStep = logits->shape() == Shape({1, 1, (int)currentDimBatch, (int)vocabSize});
+      ABORT_IF(logits->shape() != Shape({(int)nBestBeamSize, 1, (int)currentDimBatch, (int)vocabSize}) && !firstStep,
+               "Unexpected shape of logits?? {} != {}", logits->shape(), Shape({(int)nBestBeamSize, 1, (int)currentDimBatch, (int)vocabSize}));
+
+      std::vector<IndexType> flattenedLogitIndices;
+      for(const auto& selected : selectedKeys) {
+        // In the first step all beam entries stem from the single start hypothesis. The flatting happens
+        // based on actual (current) batch size and batch index computed with batch-pruning as we are
+        // looking into the pruned tensor.
+        size_t beamHypIdx = firstStep ? 0 : selected.beamHypIdx;
+        flattenedLogitIndices.push_back((IndexType)((beamHypIdx * currentDimBatch + selected.currentBatchIdx) * vocabSize + selected.wordIdx)); // (beam idx, batch idx, word idx); note: beam and batch are transposed, compared to 'key'
+      }
+      selectedLogits.push_back(rows(reshape(logits, {logits->shape().elements(), 1}), flattenedLogitIndices));
+    }
+    auto gathered = cast(concatenate(selectedLogits, /*axis=*/0), Type::float32); // [numScorers * numKeys, 1]
+    gathered->graph()->forwardNext();
+    gathered->val()->get(breakDownScores);
+  }
+
+  for(size_t i = 0; i < selectedKeys.size(); ++i) {
+    const auto beamHypIdx      = selectedKeys[i].beamHypIdx;
+    const auto currentBatchIdx = selectedKeys[i].currentBatchIdx;
+    const auto origBatchIdx    = selectedKeys[i].origBatchIdx;
+    const auto wordIdx         = selectedKeys[i].wordIdx;
+    const bool dropHyp         = selectedKeys[i].dropHyp;
 
     // @TODO: We currently assign a log probability of 0 to all beam entries of the dropped batch entry, instead it might be a good idea to use
     // the per Hyp pathScore without the current expansion (a bit hard to obtain). 
@@ -122,23 +171,13 @@ Beams BeamSearch::toHyps(const std::vector<unsigned int>& nBestKeys, // [current
     auto hyp = Hypothesis::New(prevHyp, word, prevBeamHypIdx, pathScore);
 
     // Set score breakdown for n-best lists
-    if(options_->get<bool>("n-best")) {
+    if(nbest) {
       auto breakDown = beam[beamHypIdx]->getScoreBreakdown();
       ABORT_IF(factoredVocab && factorGroup > 0 && !factoredVocab->canExpandFactoredWord(word, factorGroup),
                "A word without this factor snuck through to here??");
-      breakDown.resize(states.size(), 0); // at start, this is empty, so this will set the initial score to 0
-      for(size_t j = 0; j < states.size(); ++j) {
-        auto lval = states[j]->getLogProbs().getFactoredLogitsTensor(factorGroup); // [maxBeamSize, 1, currentDimBatch, dimFactorVocab]
-        // The flatting happens based on actual (current) batch size and batch index computed with batch-pruning as we are looking into the pruned tensor
-        size_t flattenedLogitIndex = (beamHypIdx * currentDimBatch + currentBatchIdx) * vocabSize + wordIdx;  // (beam idx, batch idx, word idx); note: beam and batch are transposed, compared to 'key'
-
-        // @TODO: use a function on shape() to index, or new method val->at({i1, i2, i3, i4}) with broadcasting
-        ABORT_IF(lval->shape() != Shape({(int)nBestBeamSize, 1, (int)currentDimBatch, (int)vocabSize}) &&
-                 (beamHypIdx == 0 && lval->shape() != Shape({1, 1, (int)currentDimBatch, (int)vocabSize})),
-                 "Unexpected shape of logits?? {} != {}", lval->shape(), Shape({(int)nBestBeamSize, 1, (int)currentDimBatch, (int)vocabSize}));
-
-        breakDown[j] += lval->get(flattenedLogitIndex);
-      }
+      breakDown.resize(scorerLogits.size(), 0); // at start, this is empty, so this will set the initial score to 0
+      for(size_t j = 0; j < scorerLogits.size(); ++j)
+        breakDown[j] += breakDownScores[j * selectedKeys.size() + i];
       hyp->setScoreBreakdown(breakDown);
     }
 
@@ -248,6 +287,13 @@ Beams BeamSearch::purgeBeams(const Beams& beams, /*in/out=*/std::vector<IndexTyp
 
 //**********************************************************************
 // main decoding function
+BeamSearch::BeamSearch(Ptr<Options> options, const std::vector<Ptr<Scorer>>& scorers, const Ptr<const Vocab> trgVocab)
+    : options_(options), scorers_(scorers), beamSize_(options_->get<size_t>("beam-size")), trgVocab_(trgVocab) {
+  // with --parallel-ensemble the scorers are evaluated in graphs of their own
+  if(ParallelEnsemble::isUsedBy(scorers_))
+    ensemble_ = New<ParallelEnsemble>(options_, scorers_);
+}
+
 Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch> batch) {
   auto factoredVocab = trgVocab_->tryAs<FactoredVocab>();
   size_t numFactorGroups = factoredVocab ? factoredVocab->getNumGroups() : 1;
@@ -262,8 +308,17 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
 
   auto getNBestList = createGetNBestListFn(beamSize_, origDimBatch, graph->getDeviceId());
 
-  for(auto scorer : scorers_) {
-    scorer->clear(graph);
+  // Number of step shapes for which the memory layout gets captured and replayed, see ExpressionGraph::startCapture()
+  graph->setMaxCaptures(options_->get<size_t>("capture-steps", 0));
+
+  if(ensemble_) {
+    ABORT_IF(factoredVocab, "Parallel evaluation of ensembles does not support factored vocabularies");
+    ensemble_->clear();
+    graph->clear();
+  } else {
+    for(auto scorer : scorers_) {
+      scorer->clear(graph);
+    }
   }
 
   Histories histories(origDimBatch);
@@ -276,8 +331,12 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
 
   // start states
   std::vector<Ptr<ScorerState>> states;
-  for(auto scorer : scorers_) {
-    states.push_back(scorer->startState(graph, batch));
+  if(ensemble_) {
+    states = ensemble_->startState(batch);
+  } else {
+    for(auto scorer : scorers_) {
+      states.push_back(scorer->startState(graph, batch));
+    }
   }
 
   // create one beam per batch entry with sentence-start hypothesis
@@ -405,8 +464,15 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
       // compute expanded path scores with word prediction probs from all scorers
       auto expandedPathScores = prevPathScores; // will become [maxBeamSize, 1, currDimBatch, dimVocab]
       Expr logProbs;
+      std::vector<Expr> memberLogProbs; // with --parallel-ensemble, computed concurrently in the graphs of the scorers
+      if(ensemble_)
+        memberLogProbs = ensemble_->step(graph, states, hypIndices, prevWords, batchIndices, (int)maxBeamSize, t == 0);
+      std::vector<Expr> scorerLogits;   // logits of each scorer in the graph of the search, for n-best score breakdowns
       for(size_t i = 0; i < scorers_.size(); ++i) {
-        if (factorGroup == 0) {
+        if (ensemble_) {
+          logProbs = memberLogProbs[i]; // [maxBeamSize, 1, currentDimBatch, dimVocab]
+        }
+        else if (factorGroup == 0) {
           // compute output probabilities for current output time step
           //  - uses hypIndices[index in beam, 1, batch index, 1] to reorder scorer state to reflect the top-N in beams[][]
           //  - adds prevWords [index in beam, 1, batch index, 1] to the scorer's target history
@@ -441,17 +507,31 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
         }
         // expand all hypotheses, [maxBeamSize, 1, currentDimBatch, 1] -> [maxBeamSize, 1, currentDimBatch, dimVocab]
         expandedPathScores = expandedPathScores + scorers_[i]->getWeight() * logProbs;
+        scorerLogits.push_back(ensemble_ ? memberLogProbs[i] : states[i]->getLogProbs().getFactoredLogitsExpr(factorGroup));
       }
 
       // make beams continuous
       expandedPathScores = swapAxes(expandedPathScores, 0, 2); // -> [currentDimBatch, 1, maxBeamSize, dimVocab]
 
+      // Steps with the same beam size, batch size and (shortlisted) vocabulary size allocate the same
+      // tensors, apart from those that grow with the output length. Their memory layout is captured
+      // the first time such a step is seen and replayed afterwards.
+      size_t captureKey = 0;
+      util::hash_combine(captureKey, t == 0);
+      util::hash_combine(captureKey, factorGroup);
+      util::hash_combine(captureKey, maxBeamSize);
+      util::hash_combine(captureKey, (size_t)currentDimBatch);
+      util::hash_combine(captureKey, (size_t)expandedPathScores->shape()[-1]);
+      graph->startCapture(captureKey);
+
       // perform NN computation
       if(t == 0 && factorGroup == 0)
         graph->forward();
       else
         graph->forwardNext();
 
+      graph->stopCapture();
+
       //**********************************************************************
       // suppress specific symbols if not at right positions
       if(unkColId != -1 && factorGroup == 0)
@@ -478,7 +558,7 @@ Histories BeamSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch>
                      /*nBestBeamSize*/expandedPathScores->shape()[-2], // used for interpretation of keys
                      /*vocabSize=*/expandedPathScores->shape()[-1],    // used for interpretation of keys
                      beams,
-                     states,            // used for keeping track of per-ensemble-member path score
+                     scorerLogits,      // used for keeping track of per-ensemble-member path score
                      batch,             // only used for propagating alignment info
                      factoredVocab, factorGroup,
                      emptyBatchEntries, // [origDimBatch] - empty source batch entries are marked with true
@@ -6,20 +6,21 @@
 
 namespace marian {
 
+class ParallelEnsemble;
+
 class BeamSearch {
 private:
   Ptr<Options> options_;
   std::vector<Ptr<Scorer>> scorers_;
   size_t beamSize_;
   Ptr<const Vocab> trgVocab_;
+  Ptr<ParallelEnsemble> ensemble_; // with --parallel-ensemble, kept for all batches searched with this object
 
   const float INVALID_PATH_SCORE = std::numeric_limits<float>::lowest(); // @TODO: observe this closely
   const bool PURGE_BATCH = true; // @TODO: diagnostic, to-be-removed once confirmed there are no issues.
 
 public:
-  BeamSearch(Ptr<Options> options, const std::vector<Ptr<Scorer>>& scorers, const Ptr<const Vocab> trgVocab)
-      : options_(options), scorers_(scorers), beamSize_(options_->get<size_t>("beam-size")), trgVocab_(trgVocab)
-  {}
+  BeamSearch(Ptr<Options> options, const std::vector<Ptr<Scorer>>& scorers, const Ptr<const Vocab> trgVocab);
 
   // combine new expandedPathScores and previous beams into new set of beams
   Beams toHyps(const std::vector<unsigned int>& nBestKeys, // [currentDimBatch, beamSize] flattened -> ((batchIdx, beamHypIdx) flattened, word idx) flattened
@@ -27,7 +28,7 @@ public:
                const size_t nBestBeamSize, // for interpretation of nBestKeys
                const size_t vocabSize,     // ditto.
                const Beams& beams,
-               const std::vector<Ptr<ScorerState /*const*/>>& states,
+               const std::vector<Expr>& scorerLogits, // [scorer][maxBeamSize, 1, currentDimBatch, dimFactorVocab], for n-best score breakdowns
                Ptr<data::CorpusBatch /*const*/> batch, // for alignments only
                Ptr<class FactoredVocab/*const*/> factoredVocab, size_t factorGroup,
                const std::vector<bool>& dropBatchEntries, // [origDimBatch] - empty source batch entries are marked with true, should be cleared after first use.
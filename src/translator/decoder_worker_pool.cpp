@@ -0,0 +1,98 @@
+#include "translator/decoder_worker_pool.h"
+#include "common/logging.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace marian {
+
+static void pinCurrentThread(size_t core) {
+#ifdef __linux__
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(core, &cpuSet);
+  int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+  if(rc != 0)
+    LOG(warn, "[warning] Could not pin decoding thread to CPU core {} (error {})", core, rc);
+#else
+  LOG_ONCE(warn, "[warning] Pinning decoding threads to CPU cores is only supported on Linux, ignoring core {}", core);
+#endif
+}
+
+DecoderWorkerPool::DecoderWorkerPool(size_t numWorkers,
+                                     const Task& init,
+                                     const std::vector<size_t>& cpuCores) {
+  ABORT_IF(numWorkers == 0, "Decoder worker pool needs at least one worker");
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    busy_ = numWorkers; // init counts as running task, so wait() below returns once all are set up
+  }
+  for(size_t id = 0; id < numWorkers; ++id)
+    workers_.emplace_back([this, id, init, cpuCores]() { work(id, init, cpuCores); });
+  wait();
+}
+
+DecoderWorkerPool::~DecoderWorkerPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  taskCondition_.notify_all();
+  spaceCondition_.notify_all();
+  for(auto& worker : workers_)
+    worker.join();
+}
+
+void DecoderWorkerPool::enqueue(Task task) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    spaceCondition_.wait(lock, [this] { return stop_ || tasks_.size() < workers_.size(); });
+    ABORT_IF(stop_, "Enqueue on stopped decoder worker pool");
+    tasks_.push_back(std::move(task));
+  }
+  taskCondition_.notify_one();
+}
+
+void DecoderWorkerPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idleCondition_.wait(lock, [this] { return tasks_.empty() && busy_ == 0; });
+}
+
+void DecoderWorkerPool::work(size_t workerId, Task init, const std::vector<size_t>& cpuCores) {
+  auto run = [workerId](const Task& task) {
+    try {
+      task(workerId);
+    } catch(const std::exception& e) {
+      ABORT("Caught std::exception in decoding thread {}: {}", workerId, e.what());
+    } catch(...) {
+      ABORT("Caught unknown exception in decoding thread {}", workerId);
+    }
+  };
+
+  if(!cpuCores.empty())
+    pinCurrentThread(cpuCores[workerId % cpuCores.size()]);
+  if(init)
+    run(init);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  for(;;) {
+    --busy_;
+    idleCondition_.notify_all();
+    taskCondition_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+    if(tasks_.empty()) // stop_ is set and nothing left to do
+      return;
+
+    Task task = std::move(tasks_.front());
+    tasks_.pop_front();
+    ++busy_;
+    spaceCondition_.notify_one();
+
+    lock.unlock();
+    run(task);
+    lock.lock();
+  }
+}
+
+}  // namespace marian
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common/definitions.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace marian {
+
+// Long-lived set of decoding threads. Worker i is created once and keeps running until the pool is
+// destroyed, so everything bound to it (graph, scorers, thread-local buffers) stays on the same
+// thread across calls. Tasks are taken from a shared queue and receive the id of the worker that
+// executes them, which is used to pick the graph and scorers owned by that worker.
+class DecoderWorkerPool {
+public:
+  typedef std::function<void(size_t /*workerId*/)> Task;
+
+  // Starts numWorkers threads and runs init(workerId) on each of them before any task is executed,
+  // e.g. to create the expression graph of that worker on its own thread. If cpuCores is not empty,
+  // worker i is pinned to core cpuCores[i % cpuCores.size()] (Linux only).
+  DecoderWorkerPool(size_t numWorkers,
+                    const Task& init = nullptr,
+                    const std::vector<size_t>& cpuCores = {});
+
+  // finishes all queued tasks and joins the workers
+  ~DecoderWorkerPool();
+
+  DecoderWorkerPool(const DecoderWorkerPool&) = delete;
+
+  // Blocks while there are already as many queued tasks as workers, so that callers reading
+  // their input lazily do not run arbitrarily far ahead of decoding.
+  void enqueue(Task task);
+
+  // blocks until the queue is empty and no task is running
+  void wait();
+
+  size_t size() const { return workers_.size(); }
+
+private:
+  void work(size_t workerId, Task init, const std::vector<size_t>& cpuCores);
+
+  std::vector<std::thread> workers_;
+  std::deque<Task> tasks_;
+  size_t busy_{0};        // number of tasks (incl. init) currently executing
+  bool stop_{false};
+
+  std::mutex mutex_;
+  std::condition_variable taskCondition_; // signalled when a task is added or the pool is stopped
+  std::condition_variable idleCondition_; // signalled when a worker finishes a task
+  std::condition_variable spaceCondition_; // signalled when a worker takes a task from the queue
+};
+
+}  // namespace marian
@@ -0,0 +1,200 @@
+#include "translator/greedy_search.h"
+
+#include "common/hash.h"
+#include "data/factored_vocab.h"
+#include "data/shortlist.h"
+#include "translator/beam_search.h"
+#include "translator/parallel_ensemble.h"
+
+#include <numeric>
+#include <tuple>
+
+namespace marian {
+
+Ptr<History> GreedySearch::toHistory(const Translation& translation, size_t sentId) const {
+  auto history = New<History>(sentId,
+                              options_->get<float>("normalize"),
+                              options_->get<float>("word-penalty"));
+  const auto trgEosId = trgVocab_->getEosId();
+
+  // same traceback grid as BeamSearch with a beam of one: the start hypothesis followed by one
+  // hypothesis per step, the last one is final
+  auto hyp = Hypothesis::New();
+  history->add(Beam(1, hyp), trgEosId);
+  for(size_t t = 0; t < translation.words.size(); ++t) {
+    hyp = Hypothesis::New(hyp, translation.words[t], 0, translation.pathScores[t]);
+    if(!translation.scoreBreakdowns.empty())
+      hyp->setScoreBreakdown(translation.scoreBreakdowns[t]);
+    if(!translation.alignments.empty())
+      hyp->setAlignment(translation.alignments[t]);
+    history->add(Beam(1, hyp), trgEosId, t + 1 == translation.words.size());
+  }
+  return history;
+}
+
+GreedySearch::GreedySearch(Ptr<Options> options, const std::vector<Ptr<Scorer>>& scorers, const Ptr<const Vocab> trgVocab)
+    : options_(options), scorers_(scorers), trgVocab_(trgVocab) {
+  // with --parallel-ensemble the scorers are evaluated in graphs of their own
+  if(ParallelEnsemble::isUsedBy(scorers_))
+    ensemble_ = New<ParallelEnsemble>(options_, scorers_);
+}
+
+Histories GreedySearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch> batch) {
+  // factors are predicted one group at a time, which needs the hypothesis handling of BeamSearch
+  if(trgVocab_->tryAs<FactoredVocab>())
+    return BeamSearch(options_, scorers_, trgVocab_).search(graph, batch);
+
+  const int dimBatch = (int)batch->size();
+  const auto trgEosId = trgVocab_->getEosId();
+  const auto trgUnkId = trgVocab_->getUnkId();
+  const bool nbest = options_->get<bool>("n-best");
+  const bool align = options_->hasAndNotEmpty("alignment");
+  const float maxLength = options_->get<float>("max-length-factor") * batch->front()->batchWidth();
+
+  graph->setMaxCaptures(options_->get<size_t>("capture-steps", 0));
+
+  std::vector<Ptr<ScorerState>> states;
+  if(ensemble_) {
+    ensemble_->clear();
+    graph->clear();
+    states = ensemble_->startState(batch);
+  } else {
+    for(auto scorer : scorers_)
+      scorer->clear(graph);
+    for(auto scorer : scorers_)
+      states.push_back(scorer->startState(graph, batch));
+  }
+
+  // all sentences stay in the batch, so the batch indices never change and no states are selected
+  std::vector<IndexType> batchIndices(dimBatch);
+  std::iota(batchIndices.begin(), batchIndices.end(), 0);
+
+  // empty lines consist only of source </s> and are translated into </s>
+  const auto srcEosId = batch->front()->vocab()->getEosId();
+  std::vector<Translation> translations(dimBatch);
+
+  // with --allow-unk false, the second best word is taken where the best one is <unk>
+  int unkColId = -1;
+  if(trgUnkId != Word::NONE && !options_->get<bool>("allow-unk", false)) {
+    unkColId = trgUnkId.toWordIndex();
+    auto shortlist = scorers_[0]->getShortlist();
+    if(shortlist)
+      unkColId = shortlist->tryForwardMap(unkColId);
+  }
+  const int k = unkColId != -1 ? 2 : 1;
+
+  Words prevWords; // empty in the first step
+  std::vector<float> values;
+  std::vector<IndexType> indices;
+  std::vector<float> breakDownScores; // [scorer, sentence, k] flattened
+  for(size_t t = 0; ; ++t) {
+    Expr pathScores; // [1, 1, dimBatch, dimVocab], scores of the next word
+    std::vector<Expr> memberLogProbs;
+    if(ensemble_)
+      memberLogProbs = ensemble_->step(graph, states, /*hypIndices=*/{}, prevWords, batchIndices, /*beamSize=*/1, t == 0);
+    for(size_t i = 0; i < scorers_.size(); ++i) {
+      if(!ensemble_)
+        states[i] = scorers_[i]->step(graph, states[i], /*hypIndices=*/{}, prevWords, batchIndices, /*beamSize=*/1);
+      auto logProbs = scorers_[i]->getWeight() * (ensemble_ ? memberLogProbs[i] : states[i]->getLogProbs().getLogits());
+      pathScores = pathScores ? pathScores + logProbs : logProbs;
+    }
+    Expr bestValues, bestIndices;
+    std::tie(bestValues, bestIndices) = topk(pathScores, k, /*axis=*/-1); // [1, 1, dimBatch, k]
+
+    // with --n-best, the scores of the k best words under each scorer are gathered in the same forward
+    // pass and copied at once, [numScorers, 1, dimBatch, k]
+    Expr memberScores;
+    if(nbest) {
+      std::vector<Expr> scores;
+      for(size_t i = 0; i < scorers_.size(); ++i)
+        scores.push_back(gather(ensemble_ ? memberLogProbs[i] : states[i]->getLogProbs().getFactoredLogitsExpr(0), -1, bestIndices));
+      memberScores = cast(concatenate(scores, /*axis=*/0), Type::float32);
+    }
+
+    size_t captureKey = 0;
+    util::hash_combine(captureKey, t == 0);
+    util::hash_combine(captureKey, (size_t)dimBatch);
+    util::hash_combine(captureKey, (size_t)pathScores->shape()[-1]);
+    graph->startCapture(captureKey);
+
+    if(t == 0)
+      graph->forward();
+    else
+      graph->forwardNext();
+
+    graph->stopCapture();
+
+    bestValues->val()->get(values);
+    bestIndices->val()->get(indices);
+    if(memberScores)
+      memberScores->val()->get(breakDownScores);
+
+    std::vector<float> alignAll; // [1, max src length, dimBatch, 1] flattened
+    if(align)
+      alignAll = scorers_[0]->getAlignment();
+
+    auto shortlist = scorers_[0]->getShortlist();
+    const size_t dimVocab = pathScores->shape()[-1];
+    const bool maxLengthReached = t + 1 >= maxLength; // length of the history before this step, as in BeamSearch
+    bool allFinished = true;
+
+    prevWords.resize(dimBatch);
+    for(int b = 0; b < dimBatch; ++b) {
+      auto& translation = translations[b];
+      if(translation.finished) {
+        prevWords[b] = trgEosId; // keeps the sentence in the batch, its output is ignored
+        continue;
+      }
+
+      Word word;
+      float score;
+      WordIndex wordIdx;
+      size_t best = 0;
+      if(t == 0 && batch->front()->data()[b] == srcEosId) {
+        word = trgEosId;
+        wordIdx = (WordIndex)dimVocab; // no logits to look up
+        score = 0.f;
+      } else {
+        best = (k == 2 && indices[b * k] == (IndexType)unkColId) ? 1 : 0;
+        wordIdx = indices[b * k + best];
+        word = Word::fromWordIndex(shortlist ? shortlist->reverseMap(wordIdx) : wordIdx);
+        score = (t == 0 ? 0.f : translation.pathScores.back()) + values[b * k + best];
+      }
+
+      if(nbest) {
+        auto breakDown = t == 0 ? std::vector<float>(states.size(), 0.f) : translation.scoreBreakdowns.back();
+        if(wordIdx < dimVocab)
+          for(size_t j = 0; j < states.size(); ++j)
+            breakDown[j] += breakDownScores[(j * dimBatch + b) * k + best];
+        translation.scoreBreakdowns.push_back(breakDown);
+      }
+
+      if(align) {
+        std::vector<float> alignment;
+        size_t batchWidth = batch->width();
+        for(size_t srcPos = 0; srcPos < batchWidth; ++srcPos) {
+          size_t idx = srcPos * dimBatch + b; // flatten [0, s, batch index, 0]
+          if(batch->front()->mask()[idx] != 0)
+            alignment.push_back(alignAll[idx]);
+        }
+        translation.alignments.push_back(alignment);
+      }
+
+      translation.words.push_back(word);
+      translation.pathScores.push_back(score);
+      translation.finished = word == trgEosId || maxLengthReached;
+      allFinished &= translation.finished;
+      prevWords[b] = word;
+    }
+
+    if(allFinished)
+      break;
+  }
+
+  Histories histories(dimBatch);
+  for(int b = 0; b < dimBatch; ++b)
+    histories[b] = toHistory(translations[b], batch->getSentenceIds()[b]);
+  return histories;
+}
+
+}  // namespace marian
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "marian.h"
+#include "translator/history.h"
+#include "translator/scorers.h"
+
+namespace marian {
+
+class ParallelEnsemble;
+
+// Search for --beam-size 1, used by marian-decoder and marian-server instead of BeamSearch. Produces
+// the same translations with less bookkeeping per step: the best word of each sentence is selected
+// by an argmax inside the graph, decoder states are never reordered (finished sentences stay in the
+// batch and are fed </s> until all are done), and hypotheses are only created from the collected
+// words once the batch is finished. Factored vocabularies are handed over to BeamSearch.
+class GreedySearch {
+private:
+  Ptr<Options> options_;
+  std::vector<Ptr<Scorer>> scorers_;
+  Ptr<const Vocab> trgVocab_;
+  Ptr<ParallelEnsemble> ensemble_; // with --parallel-ensemble, kept for all batches searched with this object
+
+  // per sentence, filled step by step and turned into a history at the end
+  struct Translation {
+    Words words;
+    std::vector<float> pathScores;
+    std::vector<std::vector<float>> scoreBreakdowns; // [t][scorer], with --n-best only
+    std::vector<std::vector<float>> alignments;      // [t][src pos], with --alignment only
+    bool finished{false};
+  };
+
+  Ptr<History> toHistory(const Translation& translation, size_t sentId) const;
+
+public:
+  GreedySearch(Ptr<Options> options, const std::vector<Ptr<Scorer>>& scorers, const Ptr<const Vocab> trgVocab);
+
+  Histories search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch> batch);
+};
+
+}  // namespace marian
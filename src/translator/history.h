@@ -71,6 +71,7 @@ public:
   }
 
   size_t getLineNum() const { return lineNo_; }
+  void setLineNum(size_t lineNo) { lineNo_ = lineNo; }
 
 private:
   std::vector<Beam> history_; // [time step][index into beam] search grid @TODO: simplify as this is currently an expensive length count
@@ -16,6 +16,55 @@ class NthElementCPU {
   std::vector<float> h_res;
   //size_t lastN_;
 
+  std::vector<std::pair<float, int>> best_; // current N best (score, idx) of one batch entry, sorted by descending score
+
+  // Inserts a candidate into best_ if it beats the current N-th best score.
+  void insert(float score, int idx) {
+    if(!(score > best_.back().first))
+      return;
+    size_t pos = best_.size() - 1;
+    while(pos > 0 && score > best_[pos - 1].first) {
+      best_[pos] = best_[pos - 1];
+      --pos;
+    }
+    best_[pos] = std::make_pair(score, idx);
+  }
+
+  // Finds the N best scores among scores[0, size) in a single pass. Instead of sorting the
+  // whole range, the scores are scanned in blocks against the current N-th best score, which
+  // only rarely lets a candidate through once the first few blocks have been seen.
+  void selectNBest(const float* scores, int size, size_t N) {
+    ABORT_IF(size < (int)N, "Cannot select {} best out of {} scores", N, size);
+
+    best_.resize(N);
+    for(size_t i = 0; i < N; ++i)
+      best_[i] = std::make_pair(scores[i], (int)i);
+    std::sort(best_.begin(), best_.end(), [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+      return a.first > b.first;
+    });
+
+    int i = (int)N;
+#ifdef __AVX__
+    for(; i + 8 <= size; i += 8) {
+      __m256 threshold = _mm256_set1_ps(best_.back().first);
+      int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(scores + i), threshold, _CMP_GT_OQ));
+      for(int j = 0; mask != 0; ++j, mask >>= 1)
+        if(mask & 1)
+          insert(scores[i + j], i + j);
+    }
+#else
+    for(; i + 4 <= size; i += 4) {
+      __m128 threshold = _mm_set1_ps(best_.back().first);
+      int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(scores + i), threshold));
+      for(int j = 0; mask != 0; ++j, mask >>= 1)
+        if(mask & 1)
+          insert(scores[i + j], i + j);
+    }
+#endif
+    for(; i < size; ++i)
+      insert(scores[i], i);
+  }
+
 public:
   NthElementCPU() {}
   NthElementCPU(const NthElementCPU& copy) = delete;
@@ -39,25 +88,16 @@ public:
     size_t pos = 0; // iterates through h_res and h_res_idx
 
     size_t batchOffset = inputN * vocabSize;
-    std::vector<int> idxs(batchOffset); // re-used for each batch
-    std::iota(idxs.begin(), idxs.end(), 0);
 
     for(size_t batchIdx = 0; batchIdx < dimBatch; ++batchIdx) {
-
-      std::partial_sort( 
-        // sorts the top N (beam size) idxs by score to the front
-        idxs.begin(),
-        idxs.begin() + N,
-        idxs.end(),
-        [&](int a, int b) { return scoresData[a] > scoresData[b]; }
-      );
+      // finds the top N (beam size) scores of this batch entry, sorted by score
+      selectNBest(scoresData, (int)batchOffset, N);
 
       // copy top N idxs and scores to return vectors
       for(size_t i = 0; i < N; ++i) {
-        int idx = idxs[i];
-        // since idxs is re-used for each batch, add batch offset to each idx to get absolute position
-        h_res_idx[pos] = (int) (idx + batchIdx * batchOffset);
-        h_res[pos] = scoresData[idx];
+        // idxs are relative to the batch entry, add batch offset to each idx to get absolute position
+        h_res_idx[pos] = (int) (best_[i].second + batchIdx * batchOffset);
+        h_res[pos] = best_[i].first;
         ++pos;
       }
 
@@ -0,0 +1,97 @@
+#include "translator/parallel_ensemble.h"
+
+#include "common/hash.h"
+#include "data/factored_vocab.h"
+
+#include "3rd_party/threadpool.h"
+
+namespace marian {
+
+ParallelEnsemble::ParallelEnsemble(Ptr<Options> options, const std::vector<Ptr<Scorer>>& scorers)
+    : scorers_(scorers), pool_(new ThreadPool(scorers.size() - 1)) {
+  for(auto scorer : scorers_)
+    scorer->getGraph()->setMaxCaptures(options->get<size_t>("capture-steps", 0));
+}
+
+ParallelEnsemble::~ParallelEnsemble() {}
+
+bool ParallelEnsemble::isEnabled(Ptr<Options> options,
+                                 const std::vector<DeviceId>& devices,
+                                 Ptr<const Vocab> trgVocab) {
+  if(!options->get<bool>("parallel-ensemble", false)
+     || options->get<std::vector<std::string>>("models").size() < 2)
+    return false;
+  for(auto device : devices) {
+    if(device.type != DeviceType::cpu) {
+      LOG(warn, "[ensemble] --parallel-ensemble is only supported for CPU decoding, ignoring it");
+      return false;
+    }
+  }
+  if(trgVocab->tryAs<FactoredVocab>()) {
+    LOG(warn, "[ensemble] --parallel-ensemble does not support factored vocabularies, ignoring it");
+    return false;
+  }
+  return true;
+}
+
+bool ParallelEnsemble::isUsedBy(const std::vector<Ptr<Scorer>>& scorers) {
+  return !scorers.empty() && scorers[0]->getGraph() != nullptr;
+}
+
+void ParallelEnsemble::clear() {
+  for(auto scorer : scorers_)
+    scorer->clear(scorer->getGraph());
+}
+
+std::vector<Ptr<ScorerState>> ParallelEnsemble::startState(Ptr<data::CorpusBatch> batch) {
+  std::vector<Ptr<ScorerState>> states;
+  for(auto scorer : scorers_)
+    states.push_back(scorer->startState(scorer->getGraph(), batch));
+  return states;
+}
+
+std::vector<Expr> ParallelEnsemble::step(Ptr<ExpressionGraph> graph,
+                                         std::vector<Ptr<ScorerState>>& states,
+                                         const std::vector<IndexType>& hypIndices,
+                                         const Words& words,
+                                         const std::vector<IndexType>& batchIndices,
+                                         int beamSize,
+                                         bool first) {
+  auto run = [&](size_t i) {
+    auto scorer = scorers_[i];
+    auto memberGraph = scorer->getGraph();
+    states[i] = scorer->step(memberGraph, states[i], hypIndices, words, batchIndices, beamSize);
+
+    // keyed like the steps of BeamSearch
+    size_t captureKey = 0;
+    util::hash_combine(captureKey, first);
+    util::hash_combine(captureKey, (size_t)0); // factor group
+    util::hash_combine(captureKey, (size_t)beamSize);
+    util::hash_combine(captureKey, batchIndices.size());
+    util::hash_combine(captureKey, (size_t)states[i]->getLogProbs().getLogits()->shape()[-1]);
+    memberGraph->startCapture(captureKey);
+
+    if(first) // the first step also runs the encoder
+      memberGraph->forward();
+    else
+      memberGraph->forwardNext();
+
+    memberGraph->stopCapture();
+  };
+
+  std::vector<std::future<void>> done;
+  for(size_t i = 1; i < scorers_.size(); ++i)
+    done.push_back(pool_->enqueue(run, i));
+  run(0);
+  for(auto& d : done)
+    d.get(); // rethrows exceptions of the members
+
+  std::vector<Expr> logProbs;
+  for(auto state : states) {
+    auto logits = state->getLogProbs().getFactoredLogitsTensor(0); // no factors with --parallel-ensemble
+    logProbs.push_back(graph->constant(logits->shape(), inits::fromTensor(logits), logits->type()));
+  }
+  return logProbs;
+}
+
+}  // namespace marian
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "marian.h"
+#include "translator/scorers.h"
+
+namespace marian {
+
+class ThreadPool;
+
+// Evaluates the members of an ensemble concurrently, used by the searches with --parallel-ensemble.
+// Every scorer has a graph of its own (see Scorer::setGraph()). In each step all members receive the
+// same hypothesis indices and words, build their step and run it in their own graph, one member per
+// thread. Only the resulting log-probabilities are copied into the graph of the search, where they
+// are weighted and summed into the path scores as for a shared graph. The searches create it once
+// when they are constructed, the translators keep one search per device for all batches.
+class ParallelEnsemble {
+private:
+  std::vector<Ptr<Scorer>> scorers_;
+  UPtr<ThreadPool> pool_; // runs all members but the first, which runs on the calling thread
+
+public:
+  ParallelEnsemble(Ptr<Options> options, const std::vector<Ptr<Scorer>>& scorers);
+  ~ParallelEnsemble();
+
+  // --parallel-ensemble applies to ensembles decoded on CPU without factored vocabularies, the
+  // translators then give every scorer a graph of its own
+  static bool isEnabled(Ptr<Options> options, const std::vector<DeviceId>& devices, Ptr<const Vocab> trgVocab);
+
+  // true if the scorers have graphs of their own and have to be evaluated with this class
+  static bool isUsedBy(const std::vector<Ptr<Scorer>>& scorers);
+
+  void clear();
+  std::vector<Ptr<ScorerState>> startState(Ptr<data::CorpusBatch> batch);
+
+  // Counterpart of Scorer::step() followed by forward() for all members. Updates states and returns
+  // the log-probabilities of every member as constants of graph, [beamSize, 1, dimBatch, dimVocab].
+  std::vector<Expr> step(Ptr<ExpressionGraph> graph,
+                         std::vector<Ptr<ScorerState>>& states,
+                         const std::vector<IndexType>& hypIndices,
+                         const Words& words,
+                         const std::vector<IndexType>& batchIndices,
+                         int beamSize,
+                         bool first);
+};
+
+}  // namespace marian
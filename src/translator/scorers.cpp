@@ -1,5 +1,7 @@
 #include "translator/scorers.h"
+#include "common/binary.h"
 #include "common/io.h"
+#include "common/utils.h"
 
 namespace marian {
 
@@ -131,4 +133,65 @@ std::vector<Ptr<Scorer>> createScorers(Ptr<Options> options, const std::vector<m
   return createScorers(options, ptrs);
 }
 
+Ptr<Scorer> createDraftScorer(Ptr<Options> options, Ptr<const Vocab> trgVocab) {
+  auto model = options->get<std::string>("speculative-draft");
+
+  auto modelOptions = New<Options>(options->clone());
+  try {
+    if(!options->get<bool>("ignore-model-config")) {
+      YAML::Node modelYaml;
+      io::getYamlFromModel(modelYaml, "special:model.yml", model);
+      modelOptions->merge(modelYaml, true);
+    }
+  } catch(std::runtime_error&) {
+    LOG(warn, "No model settings found in draft model file");
+  }
+
+  // the words proposed by the draft are fed to the models as they are
+  auto dimVocabs = modelOptions->get<std::vector<int>>("dim-vocabs");
+  ABORT_IF(dimVocabs.empty() || (size_t)dimVocabs.back() != trgVocab->size(),
+           "Draft model {} has a target vocabulary of size {}, but the models use one of size {}",
+           model, dimVocabs.empty() ? 0 : dimVocabs.back(), trgVocab->size());
+
+  return scorerByType("draft", 1.f, model, modelOptions);
+}
+
+std::vector<mio::mmap_source> mmapModels(Ptr<Options> options, const std::vector<DeviceId>& devices) {
+  std::vector<mio::mmap_source> mmaps;
+  if(!options->get<bool>("model-mmap", false))
+    return mmaps;
+
+  for(auto device : devices) {
+    if(device.type != DeviceType::cpu) {
+      LOG(warn, "[memory] --model-mmap is only supported for CPU decoding, loading models instead");
+      return mmaps;
+    }
+  }
+
+  auto models = options->get<std::vector<std::string>>("models");
+  for(const auto& model : models) {
+    if(!utils::endsWith(model, ".bin")) {
+      LOG(warn, "[memory] Model {} is not in .bin format and cannot be memory-mapped, loading models instead", model);
+      return std::vector<mio::mmap_source>();
+    }
+  }
+
+  for(const auto& model : models) {
+    mmaps.push_back(mio::mmap_source(model));
+    LOG(info, "[memory] Memory-mapped model {}, its parameters are shared by {} graph(s)", model, devices.size());
+  }
+  return mmaps;
+}
+
+void useReorderedModels(Ptr<Options> options) {
+  if(!options->get<bool>("intgemm-cache", false))
+    return;
+
+  auto models = options->get<std::vector<std::string>>("models");
+  for(auto& model : models)
+    if(io::isBin(model))
+      model = io::binary::reorderedModel(model);
+  options->set("models", models);
+}
+
 }  // namespace marian
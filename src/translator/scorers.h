@@ -21,6 +21,7 @@ class Scorer {
 protected:
   std::string name_;
   float weight_;
+  Ptr<ExpressionGraph> graph_; // graph of its own with --parallel-ensemble, see setGraph()
 
 public:
   Scorer(const std::string& name, float weight)
@@ -43,8 +44,25 @@ public:
                                 int beamSize)
       = 0;
 
+  // Counterparts of IEncoderDecoder::stepPositions() and DecoderState::truncate() for the verification
+  // of draft words in SpeculativeSearch
+  virtual Ptr<ScorerState> stepPositions(Ptr<ExpressionGraph>,
+                                         Ptr<ScorerState>,
+                                         const Words& /*words*/,
+                                         int /*dimPositions*/) {
+    ABORT("Scorer {} cannot decode several positions at once", name_);
+  }
+  virtual Ptr<ScorerState> truncate(Ptr<ScorerState>, size_t /*position*/) {
+    ABORT("Scorer {} cannot truncate its state", name_);
+  }
+
   virtual void init(Ptr<ExpressionGraph>) {}
 
+  // Gives the scorer a graph of its own, in which it is initialized and evaluated instead of the
+  // graph passed to the search. Lets the members of an ensemble run concurrently, see ParallelEnsemble.
+  void setGraph(Ptr<ExpressionGraph> graph) { graph_ = graph; }
+  Ptr<ExpressionGraph> getGraph() const { return graph_; }
+
   virtual void setShortlistGenerator(Ptr<const data::ShortlistGenerator> /*shortlistGenerator*/){};
   virtual Ptr<data::Shortlist> getShortlist() { return nullptr; };
 
@@ -126,6 +144,21 @@ public:
     return New<ScorerWrapperState>(newState);
   }
 
+  virtual Ptr<ScorerState> stepPositions(Ptr<ExpressionGraph> graph,
+                                         Ptr<ScorerState> state,
+                                         const Words& words,
+                                         int dimPositions) override {
+    graph->switchParams(getName());
+    auto wrapperState = std::dynamic_pointer_cast<ScorerWrapperState>(state);
+    auto newState = encdec_->stepPositions(graph, wrapperState->getState(), words, dimPositions);
+    return New<ScorerWrapperState>(newState);
+  }
+
+  virtual Ptr<ScorerState> truncate(Ptr<ScorerState> state, size_t position) override {
+    auto wrapperState = std::dynamic_pointer_cast<ScorerWrapperState>(state);
+    return New<ScorerWrapperState>(wrapperState->getState()->truncate(position));
+  }
+
   virtual void setShortlistGenerator(
       Ptr<const data::ShortlistGenerator> shortlistGenerator) override {
     encdec_->setShortlistGenerator(shortlistGenerator);
@@ -157,4 +190,18 @@ Ptr<Scorer> scorerByType(const std::string& fname,
 std::vector<Ptr<Scorer>> createScorers(Ptr<Options> options, const std::vector<const void*>& ptrs);
 std::vector<Ptr<Scorer>> createScorers(Ptr<Options> options, const std::vector<mio::mmap_source>& mmaps);
 
+// Creates the scorer of the draft model given with --speculative-draft, see SpeculativeSearch. Its
+// parameters are kept under the name "draft", apart from those of the scorers from createScorers().
+// Aborts if the target vocabulary of the draft does not have the size of trgVocab.
+Ptr<Scorer> createDraftScorer(Ptr<Options> options, Ptr<const Vocab> trgVocab);
+
+// Memory-maps all models with --model-mmap. The mappings are meant to be passed to createScorers()
+// for every graph, which then share the read-only parameters. Returns an empty vector if the models
+// are to be loaded instead, i.e. without --model-mmap, for GPU devices or for models not in .bin format.
+std::vector<mio::mmap_source> mmapModels(Ptr<Options> options, const std::vector<DeviceId>& devices);
+
+// With --intgemm-cache, replaces .bin models in the option "models" by copies with intgemm matrices
+// reordered for the current CPU, see io::binary::reorderedModel(). Call before mmapModels().
+void useReorderedModels(Ptr<Options> options);
+
 }  // namespace marian
@@ -0,0 +1,240 @@
+#include "translator/speculative_search.h"
+
+#include "data/factored_vocab.h"
+#include "data/shortlist.h"
+#include "translator/greedy_search.h"
+#include "translator/parallel_ensemble.h"
+
+#include <numeric>
+#include <tuple>
+
+namespace marian {
+
+std::atomic<size_t> SpeculativeSearch::rounds_{0};
+std::atomic<size_t> SpeculativeSearch::proposed_{0};
+std::atomic<size_t> SpeculativeSearch::accepted_{0};
+
+SpeculativeSearch::SpeculativeSearch(Ptr<Options> options,
+                                     const std::vector<Ptr<Scorer>>& scorers,
+                                     const Ptr<const Vocab> trgVocab)
+    : options_(options), trgVocab_(trgVocab) {
+  ABORT_IF(scorers.size() < 2 || scorers.back()->getName() != "draft",
+           "Speculative decoding needs the scorer of the draft model after those of the models");
+  scorers_.assign(scorers.begin(), scorers.end() - 1);
+  draft_ = scorers.back();
+  greedy_ = New<GreedySearch>(options_, scorers_, trgVocab_);
+}
+
+bool SpeculativeSearch::isEnabled(Ptr<Options> options) {
+  return options->hasAndNotEmpty("speculative-draft") && options->get<size_t>("beam-size") == 1;
+}
+
+void SpeculativeSearch::logStatistics() {
+  size_t rounds = rounds_, proposed = proposed_, accepted = accepted_;
+  if(rounds == 0)
+    return;
+  LOG(info,
+      "[speculative] {} verification steps, {} of {} proposed words accepted ({:.1f}%), {:.2f} words per step",
+      rounds, accepted, proposed, 100.0 * accepted / proposed, (double)(accepted + rounds) / rounds);
+}
+
+Ptr<History> SpeculativeSearch::toHistory(const Translation& translation, size_t sentId) const {
+  auto history = New<History>(sentId,
+                              options_->get<float>("normalize"),
+                              options_->get<float>("word-penalty"));
+  const auto trgEosId = trgVocab_->getEosId();
+
+  // same traceback grid as GreedySearch: the start hypothesis followed by one hypothesis per word
+  auto hyp = Hypothesis::New();
+  history->add(Beam(1, hyp), trgEosId);
+  for(size_t t = 0; t < translation.words.size(); ++t) {
+    hyp = Hypothesis::New(hyp, translation.words[t], 0, translation.pathScores[t]);
+    history->add(Beam(1, hyp), trgEosId, t + 1 == translation.words.size());
+  }
+  return history;
+}
+
+Histories SpeculativeSearch::search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch> batch) {
+  if(options_->get<bool>("n-best") || options_->hasAndNotEmpty("alignment")
+     || trgVocab_->tryAs<FactoredVocab>() || ParallelEnsemble::isUsedBy(scorers_))
+    return greedy_->search(graph, batch);
+
+  const int dimBatch = (int)batch->size();
+  const int numTokens = (int)std::max(options_->get<size_t>("speculative-tokens"), (size_t)1);
+  const auto trgEosId = trgVocab_->getEosId();
+  const auto trgUnkId = trgVocab_->getUnkId();
+  const float maxLength = options_->get<float>("max-length-factor") * batch->front()->batchWidth();
+
+  std::vector<Ptr<ScorerState>> states;
+  for(auto scorer : scorers_)
+    scorer->clear(graph);
+  draft_->clear(graph);
+  for(auto scorer : scorers_)
+    states.push_back(scorer->startState(graph, batch));
+  auto draftState = draft_->startState(graph, batch);
+
+  // all sentences stay in the batch as in GreedySearch
+  std::vector<IndexType> batchIndices(dimBatch);
+  std::iota(batchIndices.begin(), batchIndices.end(), 0);
+
+  // with --allow-unk false, the second best word is taken where the best one is <unk>, for the draft
+  // as well so that it proposes what the models would choose
+  const bool noUnk = trgUnkId != Word::NONE && !options_->get<bool>("allow-unk", false);
+  const int k = noUnk ? 2 : 1;
+  auto unkColumn = [&](Ptr<data::Shortlist> shortlist) {
+    int unkColId = trgUnkId.toWordIndex();
+    return shortlist ? (int)shortlist->tryForwardMap(unkColId) : unkColId;
+  };
+  const int unkColId      = noUnk ? unkColumn(scorers_[0]->getShortlist()) : -1;
+  const int draftUnkColId = noUnk ? unkColumn(draft_->getShortlist()) : -1;
+
+  // best word and its score in row 'row' of the values and indices of topk(), [rows * k]
+  auto bestOf = [&](const std::vector<float>& values, const std::vector<IndexType>& indices, size_t row,
+                    int unk, Ptr<data::Shortlist> shortlist) {
+    size_t best = (k == 2 && indices[row * k] == (IndexType)unk) ? 1 : 0;
+    WordIndex wordIdx = indices[row * k + best];
+    auto word = Word::fromWordIndex(shortlist ? shortlist->reverseMap(wordIdx) : wordIdx);
+    return std::make_pair(word, values[row * k + best]);
+  };
+
+  // adds a word to a translation, true if the translation is finished with it
+  std::vector<Translation> translations(dimBatch);
+  auto add = [&](Translation& translation, Word word, float logProb) {
+    bool maxLengthReached = translation.words.size() + 1 >= maxLength; // as in GreedySearch
+    translation.pathScores.push_back((translation.words.empty() ? 0.f : translation.pathScores.back()) + logProb);
+    translation.words.push_back(word);
+    translation.finished = word == trgEosId || maxLengthReached;
+    return translation.finished;
+  };
+
+  std::vector<float> values;
+  std::vector<IndexType> indices;
+
+  // first step, runs the encoders and translates the empty history
+  Expr pathScores;
+  for(size_t i = 0; i < scorers_.size(); ++i) {
+    states[i] = scorers_[i]->step(graph, states[i], /*hypIndices=*/{}, /*words=*/{}, batchIndices, /*beamSize=*/1);
+    auto logProbs = scorers_[i]->getWeight() * states[i]->getLogProbs().getLogits();
+    pathScores = pathScores ? pathScores + logProbs : logProbs;
+  }
+  draftState = draft_->step(graph, draftState, /*hypIndices=*/{}, /*words=*/{}, batchIndices, /*beamSize=*/1);
+
+  Expr bestValues, bestIndices;
+  std::tie(bestValues, bestIndices) = topk(pathScores, k, /*axis=*/-1); // [1, 1, dimBatch, k]
+  graph->forward();
+  bestValues->val()->get(values);
+  bestIndices->val()->get(indices);
+
+  // empty lines consist only of source </s> and are translated into </s>
+  const auto srcEosId = batch->front()->vocab()->getEosId();
+  Words lastWords(dimBatch); // translated but not yet fed to the decoders
+  bool allFinished = true;
+  for(int b = 0; b < dimBatch; ++b) {
+    auto best = std::make_pair(trgEosId, 0.f);
+    if(batch->front()->data()[b] != srcEosId)
+      best = bestOf(values, indices, b, unkColId, scorers_[0]->getShortlist());
+    allFinished &= add(translations[b], best.first, best.second);
+    lastWords[b] = best.first;
+  }
+
+  size_t position = 1;    // positions fed to the decoders of the models
+  Words draftPending;     // the last proposal, if it was accepted without having been fed to the draft
+  size_t batchRounds = 0, batchAccepted = 0;
+  while(!allFinished) {
+    // the draft proposes numTokens words per sentence, [proposal][batch]
+    Words proposals(numTokens * dimBatch, trgEosId);
+    Words draftInput = lastWords;
+    for(int i = 0; i < numTokens; ++i) {
+      int dimPositions = 1;
+      if(i == 0 && !draftPending.empty()) {
+        dimPositions = 2;
+        draftInput.insert(draftInput.begin(), draftPending.begin(), draftPending.end());
+        draftState = draft_->stepPositions(graph, draftState, draftInput, dimPositions);
+        draftPending.clear();
+      } else {
+        draftState = draft_->step(graph, draftState, /*hypIndices=*/{}, draftInput, batchIndices, /*beamSize=*/1);
+      }
+      std::tie(bestValues, bestIndices) = topk(draftState->getLogProbs().getLogits(), k, /*axis=*/-1);
+      graph->forwardNext();
+      bestValues->val()->get(values);
+      bestIndices->val()->get(indices);
+
+      for(int b = 0; b < dimBatch; ++b)
+        if(!translations[b].finished) // finished sentences are fed </s>
+          proposals[i * dimBatch + b] = bestOf(values, indices, (dimPositions - 1) * dimBatch + b,
+                                               draftUnkColId, draft_->getShortlist()).first;
+      draftInput.assign(proposals.begin() + i * dimBatch, proposals.begin() + (i + 1) * dimBatch);
+    }
+
+    // the models score the last translated word and all proposals at once
+    Words verifyInput = lastWords;
+    verifyInput.insert(verifyInput.end(), proposals.begin(), proposals.end());
+    const int dimPositions = numTokens + 1;
+    pathScores = nullptr;
+    for(size_t i = 0; i < scorers_.size(); ++i) {
+      states[i] = scorers_[i]->stepPositions(graph, states[i], verifyInput, dimPositions);
+      auto logProbs = scorers_[i]->getWeight() * states[i]->getLogProbs().getLogits();
+      pathScores = pathScores ? pathScores + logProbs : logProbs;
+    }
+    std::tie(bestValues, bestIndices) = topk(pathScores, k, /*axis=*/-1); // [1, dimPositions, dimBatch, k]
+    graph->forwardNext();
+    bestValues->val()->get(values);
+    bestIndices->val()->get(indices);
+
+    // Words of the models, [position][batch]. Row j is valid for a sentence if it agrees with the
+    // draft on all rows before. Each unfinished sentence allows all rows up to and including its first
+    // disagreement, unless it is finished within them. The batch keeps the rows all sentences allow.
+    std::vector<std::pair<Word, float>> chosen(dimPositions * dimBatch);
+    int numRows = dimPositions;
+    for(int b = 0; b < dimBatch; ++b) {
+      if(translations[b].finished)
+        continue;
+      size_t length = translations[b].words.size();
+      for(int j = 0; j < dimPositions; ++j) {
+        chosen[j * dimBatch + b] = bestOf(values, indices, j * dimBatch + b, unkColId, scorers_[0]->getShortlist());
+        auto word = chosen[j * dimBatch + b].first;
+        if(word == trgEosId || length + j + 1 >= maxLength)
+          break;
+        if(j == numTokens || word != proposals[j * dimBatch + b]) {
+          numRows = std::min(numRows, j + 1);
+          break;
+        }
+      }
+    }
+
+    allFinished = true;
+    for(int b = 0; b < dimBatch; ++b) {
+      auto& translation = translations[b];
+      for(int j = 0; j < numRows && !translation.finished; ++j)
+        add(translation, chosen[j * dimBatch + b].first, chosen[j * dimBatch + b].second);
+      lastWords[b] = translation.finished ? trgEosId : translation.words.back();
+      allFinished &= translation.finished;
+    }
+
+    // drop the positions that were not accepted, the draft has seen all proposals but the last
+    position += numRows;
+    if(numRows < dimPositions)
+      for(size_t i = 0; i < scorers_.size(); ++i)
+        states[i] = scorers_[i]->truncate(states[i], position);
+    if(numRows < numTokens)
+      draftState = draft_->truncate(draftState, position);
+    else if(numRows == dimPositions)
+      draftPending.assign(proposals.end() - dimBatch, proposals.end());
+
+    batchRounds++;
+    batchAccepted += numRows - 1;
+  }
+
+  rounds_ += batchRounds;
+  proposed_ += batchRounds * numTokens;
+  accepted_ += batchAccepted;
+  LOG(debug, "[speculative] Batch of {} sentences in {} verification steps, {} of {} proposed words accepted",
+      dimBatch, batchRounds, batchAccepted, batchRounds * numTokens);
+
+  Histories histories(dimBatch);
+  for(int b = 0; b < dimBatch; ++b)
+    histories[b] = toHistory(translations[b], batch->getSentenceIds()[b]);
+  return histories;
+}
+
+}  // namespace marian
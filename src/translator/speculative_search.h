@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+
+#include "marian.h"
+#include "translator/history.h"
+#include "translator/scorers.h"
+
+namespace marian {
+
+class GreedySearch;
+
+// Search for --beam-size 1 with a draft model given by --speculative-draft. In each round the draft
+// proposes --speculative-tokens words per sentence greedily, one step at a time. The models given
+// with --models then score the last translated word and all proposals in a single decoder step (see
+// Scorer::stepPositions()) and the proposals are accepted as long as they agree with the argmax of
+// these models. The first disagreeing position yields the word of the models, so every round adds
+// at least one word and the translations are those of GreedySearch, except for rare near-ties that
+// the rounding of the multi-position products decides differently. Decoder states of both models
+// are truncated to the accepted positions afterwards. The draft is expected to be the last of the
+// scorers passed to the constructor, see createDraftScorer(). --n-best, --alignment, factored
+// vocabularies and --parallel-ensemble are handed over to GreedySearch.
+class SpeculativeSearch {
+private:
+  Ptr<Options> options_;
+  std::vector<Ptr<Scorer>> scorers_; // the models that are verifying, without the draft
+  Ptr<Scorer> draft_;
+  Ptr<const Vocab> trgVocab_;
+  Ptr<GreedySearch> greedy_; // for the cases handed over to GreedySearch
+
+  // counted over all batches of the process, see logStatistics()
+  static std::atomic<size_t> rounds_;   // verification steps
+  static std::atomic<size_t> proposed_; // words proposed by the draft
+  static std::atomic<size_t> accepted_; // proposed words that were accepted
+
+  // per sentence, filled round by round and turned into a history at the end
+  struct Translation {
+    Words words;
+    std::vector<float> pathScores;
+    bool finished{false};
+  };
+
+  Ptr<History> toHistory(const Translation& translation, size_t sentId) const;
+
+public:
+  SpeculativeSearch(Ptr<Options> options, const std::vector<Ptr<Scorer>>& scorers, const Ptr<const Vocab> trgVocab);
+
+  // true if a draft model is given and the beam size is 1, the translators then add the draft scorer
+  static bool isEnabled(Ptr<Options> options);
+
+  // logs how many of the proposed words have been accepted so far
+  static void logStatistics();
+
+  Histories search(Ptr<ExpressionGraph> graph, Ptr<data::CorpusBatch> batch);
+};
+
+}  // namespace marian
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common/logging.h"
+#include "common/timer.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace marian {
+
+// Wall time of the start-up phases of a translator, logged with --startup-report. Phases that run
+// on every device concurrently are added per device and report the slowest one.
+class StartupReport {
+private:
+  bool enabled_;
+  timer::Timer total_;
+  timer::Timer phase_;
+  std::vector<std::pair<std::string, double>> phases_; // in order of first appearance
+  std::mutex mutex_;
+
+public:
+  StartupReport(bool enabled) : enabled_(enabled) {}
+
+  // Ends a phase that started when the previous one ended, or at construction
+  void phase(const std::string& name) {
+    add(name, phase_.elapsed());
+    phase_.start();
+  }
+
+  // Records a phase measured elsewhere, keeps the maximum if it is added more than once. Thread-safe
+  void add(const std::string& name, double seconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(auto& phase : phases_) {
+      if(phase.first == name) {
+        phase.second = std::max(phase.second, seconds);
+        return;
+      }
+    }
+    phases_.emplace_back(name, seconds);
+  }
+
+  void log() {
+    if(!enabled_)
+      return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(const auto& phase : phases_)
+      LOG(info, "[startup] {}: {:.3f}s", phase.first, phase.second);
+    LOG(info, "[startup] Total: {:.3f}s", total_.elapsed());
+  }
+};
+
+}  // namespace marian
@@ -0,0 +1,68 @@
+#include "translator/translation_cache.h"
+
+#include <sstream>
+
+namespace marian {
+
+TranslationCache::TranslationCache(size_t maxBytes, size_t numShards) {
+  numShards = std::max(numShards, (size_t)1);
+  maxShardBytes_ = maxBytes / numShards;
+  for(size_t i = 0; i < numShards; ++i)
+    shards_.emplace_back(new Shard());
+}
+
+bool TranslationCache::get(const std::string& key, Output& output) {
+  auto& shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(key);
+  if(it == shard.index.end()) {
+    misses_++;
+    return false;
+  }
+  shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+  output = it->second->output;
+  hits_++;
+  return true;
+}
+
+void TranslationCache::put(const std::string& key, const Output& output) {
+  size_t bytes = bytesOf(key, output);
+  if(bytes > maxShardBytes_)
+    return;
+
+  auto& shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(key);
+  if(it != shard.index.end()) { // e.g. the same sentence translated by two concurrent requests
+    shard.bytes -= bytesOf(key, it->second->output);
+    shard.entries.erase(it->second);
+    shard.index.erase(it);
+  }
+
+  shard.entries.push_front({key, output});
+  shard.index[key] = shard.entries.begin();
+  shard.bytes += bytes;
+
+  while(shard.bytes > maxShardBytes_) {
+    const auto& last = shard.entries.back();
+    shard.bytes -= bytesOf(last.key, last.output);
+    shard.index.erase(last.key);
+    shard.entries.pop_back();
+    evictions_++;
+  }
+}
+
+std::string TranslationCache::toString() {
+  size_t entries = 0, bytes = 0;
+  for(auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    entries += shard->entries.size();
+    bytes += shard->bytes;
+  }
+  std::stringstream ss;
+  ss << "hits: " << hits_ << ", misses: " << misses_ << ", evictions: " << evictions_
+     << ", entries: " << entries << ", memory: " << bytes / (1024 * 1024) << " MB";
+  return ss.str();
+}
+
+}  // namespace marian
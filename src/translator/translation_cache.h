@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "common/definitions.h"
+
+namespace marian {
+
+// Bounded least-recently-used cache of printed translations, used by marian-server with --cache-size
+// to answer repeated sentences without decoding them. Keys are built by the caller from everything
+// the output depends on (model, options, source word ids), see TranslateService. The memory budget
+// is split evenly among shards, each with a lock and an LRU list of its own, so that concurrent
+// requests rarely wait for each other. Hits, misses and evictions are counted for the whole cache.
+class TranslationCache {
+public:
+  struct Output {
+    std::string best1;
+    std::string bestn;
+  };
+
+  TranslationCache(size_t maxBytes, size_t numShards);
+
+  // Copies the output cached for key into output and marks it as most recently used, false if the
+  // key is not cached
+  bool get(const std::string& key, Output& output);
+
+  // Inserts or replaces the output for key and evicts the least recently used entries of its shard
+  // until the shard fits into its budget. Outputs larger than the budget of a shard are not cached.
+  void put(const std::string& key, const Output& output);
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+  size_t evictions() const { return evictions_; }
+
+  // one-line summary of the counters, entries and memory in use, for logging
+  std::string toString();
+
+private:
+  struct Entry {
+    std::string key;
+    Output output;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t bytes{0};
+  };
+
+  // approximate memory of an entry: strings plus list node and hash map overhead
+  static size_t bytesOf(const std::string& key, const Output& output) {
+    return 2 * key.size() + output.best1.size() + output.bestn.size() + 128;
+  }
+
+  Shard& shardOf(const std::string& key) { return *shards_[std::hash<std::string>()(key) % shards_.size()]; }
+
+  size_t maxShardBytes_;
+  std::vector<UPtr<Shard>> shards_;
+
+  std::atomic<size_t> hits_{0};
+  std::atomic<size_t> misses_{0};
+  std::atomic<size_t> evictions_{0};
+};
+
+}  // namespace marian
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
 #include <string>
 
 #include "data/batch_generator.h"
@@ -7,22 +11,20 @@
 #include "data/shortlist.h"
 #include "data/text_input.h"
 
-#include "3rd_party/threadpool.h"
-
+#include "translator/decoder_worker_pool.h"
 #include "translator/history.h"
 #include "translator/output_collector.h"
 #include "translator/output_printer.h"
+#include "translator/parallel_ensemble.h"
+#include "translator/speculative_search.h"
 
 #include "models/model_task.h"
 #include "translator/scorers.h"
+#include "translator/startup_report.h"
+#include "translator/translation_cache.h"
 
-// currently for diagnostics only, will try to mmap files ending in *.bin suffix when enabled.
-// @TODO: add this as an actual feature.
-#define MMAP 0
-
-#if MMAP
 #include "3rd_party/mio/mio.hpp"
-#endif
+#include "3rd_party/threadpool.h"
 
 namespace marian {
 
@@ -32,6 +34,7 @@ private:
   Ptr<Options> options_;
   std::vector<Ptr<ExpressionGraph>> graphs_;
   std::vector<std::vector<Ptr<Scorer>>> scorers_;
+  std::vector<Ptr<Search>> searches_; // one per device, reused for all batches
 
   Ptr<data::Corpus> corpus_;
   Ptr<Vocab> trgVocab_;
@@ -39,9 +42,11 @@ private:
 
   size_t numDevices_;
 
-#if MMAP
-  std::vector<mio::mmap_source> mmaps_;
-#endif
+  std::vector<mio::mmap_source> mmaps_; // with --model-mmap, shared by the graphs of all devices
+  Ptr<ThreadPool> lazyLoadingPool_;     // with --lazy-load, converts parameters in the background
+
+  // one decoding thread per device, declared last so that it is shut down before anything it uses
+  UPtr<DecoderWorkerPool> workers_;
 
 public:
   Translate(Ptr<Options> options)
@@ -52,61 +57,102 @@ public:
     options_->set("inference", true,
                   "shuffle", "none");
 
+    StartupReport report(options_->get<bool>("startup-report", false));
+
     corpus_ = New<data::Corpus>(options_, true);
 
     auto vocabs = options_->get<std::vector<std::string>>("vocabs");
     trgVocab_ = New<Vocab>(options_, vocabs.size() - 1);
     trgVocab_->load(vocabs.back());
     auto srcVocab = corpus_->getVocabs()[0];
+    report.phase("Vocabularies and input");
 
-    if(options_->hasAndNotEmpty("shortlist"))
-      shortlistGenerator_ = New<data::LexicalShortlistGenerator>(
+    if(options_->hasAndNotEmpty("shortlist")) {
+      shortlistGenerator_ = data::createShortlistGenerator(
           options_, srcVocab, trgVocab_, 0, 1, vocabs.front() == vocabs.back());
+      report.phase("Shortlist");
+    }
 
     auto devices = Config::getDevices(options_);
     numDevices_ = devices.size();
 
-    ThreadPool threadPool(numDevices_, numDevices_);
     scorers_.resize(numDevices_);
+    searches_.resize(numDevices_);
     graphs_.resize(numDevices_);
 
-#if MMAP
-    auto models = options->get<std::vector<std::string>>("models");
-    for(auto model : models) {
-      marian::filesystem::Path modelPath(model);
-      ABORT_IF(modelPath.extension() != marian::filesystem::Path(".bin"),
-              "Non-binarized models cannot be mmapped");
-      mmaps_.push_back(std::move(mio::mmap_source(model)));
+    if(options_->get<bool>("intgemm-cache", false)) {
+      useReorderedModels(options_);
+      report.phase("Reordered models");
     }
-#endif
-
-    size_t id = 0;
-    for(auto device : devices) {
-      auto task = [&](DeviceId device, size_t id) {
-        auto graph = New<ExpressionGraph>(true);
-        auto prec = options_->get<std::vector<std::string>>("precision", {"float32"});
-        graph->setDefaultElementType(typeFromString(prec[0]));
-        graph->setDevice(device);
-        graph->reserveWorkspaceMB(options_->get<size_t>("workspace"));
-        graphs_[id] = graph;
-
-#if MMAP
-        auto scorers = createScorers(options_, mmaps_);
-#else
-        auto scorers = createScorers(options_);
-#endif
-        for(auto scorer : scorers) {
-          scorer->init(graph);
-          if(shortlistGenerator_)
-            scorer->setShortlistGenerator(shortlistGenerator_);
-        }
+    mmaps_ = mmapModels(options_, devices);
+    if(!mmaps_.empty())
+      report.phase("Model mapping");
+    else if(options_->get<bool>("lazy-load", false))
+      lazyLoadingPool_ = New<ThreadPool>(std::max(std::thread::hardware_concurrency(), 1u));
 
-        scorers_[id] = scorers;
-        graph->forward();
-      };
+    auto createGraph = [&](DeviceId device) {
+      auto graph = New<ExpressionGraph>(true);
+      auto prec = options_->get<std::vector<std::string>>("precision", {"float32"});
+      graph->setDefaultElementType(typeFromString(prec[0]));
+      graph->setDevice(device);
+      graph->setTensorAllocator(options_->get<std::string>("tensor-allocator", "default"));
+      graph->reserveWorkspaceMB(options_->get<size_t>("workspace"));
+      if(lazyLoadingPool_)
+        graph->setLazyLoading(lazyLoadingPool_);
+      return graph;
+    };
 
-      threadPool.enqueue(task, device, id++);
-    }
+    // with --parallel-ensemble every ensemble member gets a graph of its own on the same device
+    bool parallelEnsemble = ParallelEnsemble::isEnabled(options_, devices, trgVocab_);
+
+    bool speculative = SpeculativeSearch::isEnabled(options_);
+    if(options_->hasAndNotEmpty("speculative-draft") && !speculative)
+      LOG(warn, "[speculative] --speculative-draft is only used with --beam-size 1, ignoring it");
+
+    // the graph and scorers of each device are created on the worker thread that is going to use them
+    auto init = [&](size_t id) {
+      auto graph = createGraph(devices[id]);
+      graphs_[id] = graph;
+
+      timer::Timer timer;
+      auto scorers = mmaps_.empty() ? createScorers(options_) : createScorers(options_, mmaps_);
+      for(auto scorer : scorers) {
+        if(parallelEnsemble)
+          scorer->setGraph(createGraph(devices[id]));
+        scorer->init(parallelEnsemble ? scorer->getGraph() : graph);
+        if(shortlistGenerator_)
+          scorer->setShortlistGenerator(shortlistGenerator_);
+      }
+      // the draft model comes last and shares the graph of the search, see SpeculativeSearch
+      if(speculative) {
+        auto draft = createDraftScorer(options_, trgVocab_);
+        draft->init(graph);
+        if(shortlistGenerator_)
+          draft->setShortlistGenerator(shortlistGenerator_);
+        scorers.push_back(draft);
+      }
+      report.add("Model loading", timer.elapsed());
+
+      scorers_[id] = scorers;
+      searches_[id] = New<Search>(options_, scorers, trgVocab_);
+
+      // with lazy loading the parameters are initialized by the first batch, which then waits only
+      // for the conversions that are still running
+      if(!lazyLoadingPool_) {
+        timer.start();
+        if(parallelEnsemble)
+          for(auto scorer : scorers)
+            scorer->getGraph()->forward();
+        else
+          graph->forward();
+        report.add("Parameter initialization", timer.elapsed());
+      }
+    };
+
+    workers_.reset(new DecoderWorkerPool(
+        numDevices_, init, options_->get<std::vector<size_t>>("cpu-affinity", {})));
+    report.phase("Devices");
+    report.log();
 
     if(options_->get<bool>("output-sampling", false)) {
       if(options_->get<size_t>("beam-size") > 1)
@@ -123,8 +169,6 @@ public:
   void run() override {
     data::BatchGenerator<data::Corpus> bg(corpus_, options_);
 
-    ThreadPool threadPool(numDevices_, numDevices_);
-
     size_t batchId = 0;
     auto collector = New<OutputCollector>(options_->get<std::string>("output"));
     auto printer = New<OutputPrinter>(options_, trgVocab_);
@@ -136,16 +180,8 @@ public:
     bool doNbest = options_->get<bool>("n-best");
     for(auto batch : bg) {
       auto task = [=](size_t id) {
-        thread_local Ptr<ExpressionGraph> graph;
-        thread_local std::vector<Ptr<Scorer>> scorers;
-
-        if(!graph) {
-          graph = graphs_[id % numDevices_];
-          scorers = scorers_[id % numDevices_];
-        }
-
-        auto search = New<Search>(options_, scorers, trgVocab_);
-        auto histories = search->search(graph, batch);
+        auto graph = graphs_[id];
+        auto histories = searches_[id]->search(graph, batch);
 
         for(auto history : histories) {
           std::stringstream best1;
@@ -161,7 +197,7 @@ public:
         // progress heartbeat for MS-internal Philly compute cluster
         // otherwise this job may be killed prematurely if no log for 4 hrs
         if (getenv("PHILLY_JOB_ID")   // this environment variable exists when running on the cluster
-            && id % 1000 == 0)  // hard beat once every 1000 batches
+            && batchId % 1000 == 0)  // hard beat once every 1000 batches
         {
           auto progress = 0.f; //fake progress for now
           fprintf(stderr, "PROGRESS: %.2f%%\n", progress);
@@ -169,9 +205,19 @@ public:
         }
       };
 
-      threadPool.enqueue(task, batchId++);
-
+      workers_->enqueue(task);
+      batchId++;
     }
+    workers_->wait();
+
+    LOG(info, "[batching] {} batches, {:.1f}% of padded source positions are tokens",
+        batchId, 100.0 * bg.paddingEfficiency());
+    if(SpeculativeSearch::isEnabled(options_))
+      SpeculativeSearch::logStatistics();
+
+    for(size_t id = 0; id < graphs_.size(); ++id)
+      LOG(debug, "[memory] Tensor allocator of device {}: {}",
+          graphs_[id]->getDeviceId(), graphs_[id]->getAllocatorStats().toString());
   }
 };
 
@@ -181,6 +227,7 @@ private:
   Ptr<Options> options_;
   std::vector<Ptr<ExpressionGraph>> graphs_;
   std::vector<std::vector<Ptr<Scorer>>> scorers_;
+  std::vector<Ptr<Search>> searches_; // one per device, reused for all batches
 
   std::vector<Ptr<Vocab>> srcVocabs_;
   Ptr<Vocab> trgVocab_;
@@ -188,8 +235,45 @@ private:
 
   size_t numDevices_;
 
+  std::vector<mio::mmap_source> mmaps_; // with --model-mmap, shared by the graphs of all devices
+  Ptr<ThreadPool> lazyLoadingPool_;     // with --lazy-load, converts parameters in the background
+
+  // A single call to run(), completed when all of its sentences have been translated
+  struct Request {
+    Ptr<StringCollector> collector;
+    std::atomic<size_t> pending{0}; // number of sentences not translated yet
+    std::promise<void> done;
+  };
+
+  // A sentence waiting to be decoded, remembers the request and the line it came from
+  struct QueuedSentence {
+    std::vector<std::string> fields; // one entry per input stream
+    size_t lineNum;                  // line number within the request
+    Ptr<Request> request;
+    std::string cacheKey;            // with --cache-size, see cacheKey()
+  };
+
+  // Sentences from all concurrent requests are queued here and picked up by the decoding workers.
+  // A worker takes whatever is pending (up to a maxi-batch) at the time it becomes free, so
+  // sentences from different connections are translated in shared batches.
+  std::deque<QueuedSentence> queue_;
+  std::mutex queueMutex_;
+  size_t maxSentences_; // maximum number of sentences taken from the queue at once
+
+  // with --cache-size, printed translations of sentences seen before
+  UPtr<TranslationCache> cache_;
+  size_t cacheContext_{0}; // hash of the models and options, which together with the source words determine the output
+
+  // one decoding thread per device, declared last so that it is shut down before anything it uses
+  UPtr<DecoderWorkerPool> workers_;
+
 public:
-  virtual ~TranslateService() {}
+  virtual ~TranslateService() {
+    if(SpeculativeSearch::isEnabled(options_))
+      SpeculativeSearch::logStatistics();
+    if(cache_)
+      LOG(info, "[cache] {}", cache_->toString());
+  }
 
   TranslateService(Ptr<Options> options)
     : options_(New<Options>(options->clone())) {
@@ -197,6 +281,8 @@ public:
     options_->set("inference", true);
     options_->set("shuffle", "none");
 
+    StartupReport report(options_->get<bool>("startup-report", false));
+
     auto vocabPaths = options_->get<std::vector<std::string>>("vocabs");
     std::vector<int> maxVocabs = options_->get<std::vector<int>>("dim-vocabs");
 
@@ -208,106 +294,250 @@ public:
 
     trgVocab_ = New<Vocab>(options_, vocabPaths.size() - 1);
     trgVocab_->load(vocabPaths.back());
+    report.phase("Vocabularies");
 
     // load lexical shortlist
-    if(options_->hasAndNotEmpty("shortlist"))
-      shortlistGenerator_ = New<data::LexicalShortlistGenerator>(
+    if(options_->hasAndNotEmpty("shortlist")) {
+      shortlistGenerator_ = data::createShortlistGenerator(
           options_, srcVocabs_.front(), trgVocab_, 0, 1, vocabPaths.front() == vocabPaths.back());
+      report.phase("Shortlist");
+    }
 
     // get device IDs
     auto devices = Config::getDevices(options_);
     numDevices_ = devices.size();
 
-    // initialize scorers
-    for(auto device : devices) {
+    if(options_->get<bool>("intgemm-cache", false)) {
+      useReorderedModels(options_);
+      report.phase("Reordered models");
+    }
+    mmaps_ = mmapModels(options_, devices);
+    if(!mmaps_.empty())
+      report.phase("Model mapping");
+    else if(options_->get<bool>("lazy-load", false))
+      lazyLoadingPool_ = New<ThreadPool>(std::max(std::thread::hardware_concurrency(), 1u));
+
+    auto createGraph = [&](DeviceId device) {
       auto graph = New<ExpressionGraph>(true);
 
       auto precison = options_->get<std::vector<std::string>>("precision", {"float32"});
       graph->setDefaultElementType(typeFromString(precison[0])); // only use first type, used for parameter type in graph
       graph->setDevice(device);
+      graph->setTensorAllocator(options_->get<std::string>("tensor-allocator", "default"));
       graph->reserveWorkspaceMB(options_->get<size_t>("workspace"));
-      graphs_.push_back(graph);
+      if(lazyLoadingPool_)
+        graph->setLazyLoading(lazyLoadingPool_);
+      return graph;
+    };
+
+    // with --parallel-ensemble every ensemble member gets a graph of its own on the same device
+    bool parallelEnsemble = ParallelEnsemble::isEnabled(options_, devices, trgVocab_);
+
+    bool speculative = SpeculativeSearch::isEnabled(options_);
+    if(options_->hasAndNotEmpty("speculative-draft") && !speculative)
+      LOG(warn, "[speculative] --speculative-draft is only used with --beam-size 1, ignoring it");
 
-      auto scorers = createScorers(options_);
+    // initialize scorers, the graph and scorers of each device are created on the worker thread
+    // that is going to use them
+    graphs_.resize(numDevices_);
+    scorers_.resize(numDevices_);
+    searches_.resize(numDevices_);
+    auto init = [&](size_t id) {
+      auto graph = createGraph(devices[id]);
+      graphs_[id] = graph;
+
+      timer::Timer timer;
+      auto scorers = mmaps_.empty() ? createScorers(options_) : createScorers(options_, mmaps_);
       for(auto scorer : scorers) {
-        scorer->init(graph);
+        if(parallelEnsemble)
+          scorer->setGraph(createGraph(devices[id]));
+        scorer->init(parallelEnsemble ? scorer->getGraph() : graph);
         if(shortlistGenerator_)
           scorer->setShortlistGenerator(shortlistGenerator_);
       }
-      scorers_.push_back(scorers);
+      // the draft model comes last and shares the graph of the search, see SpeculativeSearch
+      if(speculative) {
+        auto draft = createDraftScorer(options_, trgVocab_);
+        draft->init(graph);
+        if(shortlistGenerator_)
+          draft->setShortlistGenerator(shortlistGenerator_);
+        scorers.push_back(draft);
+      }
+      report.add("Model loading", timer.elapsed());
+      scorers_[id] = scorers;
+      searches_[id] = New<Search>(options_, scorers, trgVocab_);
+    };
+
+    maxSentences_ = options_->get<int>("mini-batch") * options_->get<int>("maxi-batch");
+
+    size_t cacheMB = options_->get<size_t>("cache-size", 0);
+    if(cacheMB > 0) {
+      cache_.reset(new TranslationCache(cacheMB * 1024 * 1024, options_->get<size_t>("cache-shards", 16)));
+      cacheContext_ = std::hash<std::string>()(options_->asYamlString()); // includes the model paths
     }
+
+    workers_.reset(new DecoderWorkerPool(
+        numDevices_, init, options_->get<std::vector<size_t>>("cpu-affinity", {})));
+    report.phase("Devices");
+    report.log();
   }
 
   std::string run(const std::string& input) override {
-    // split tab-separated input into fields if necessary
-    auto inputs = options_->get<bool>("tsv", false)
-                      ? convertTsvToLists(input, options_->get<size_t>("tsv-fields", 1))
-                      : std::vector<std::string>({input});
-    auto corpus_ = New<data::TextInput>(inputs, srcVocabs_, options_);
-    data::BatchGenerator<data::TextInput> batchGenerator(corpus_, options_);
-
-    auto collector = New<StringCollector>(options_->get<bool>("quiet-translation", false));
-    auto printer = New<OutputPrinter>(options_, trgVocab_);
-    size_t batchId = 0;
-
-    batchGenerator.prepare();
-
-    {
-      ThreadPool threadPool_(numDevices_, numDevices_);
-
-      for(auto batch : batchGenerator) {
-        auto task = [=](size_t id) {
-          thread_local Ptr<ExpressionGraph> graph;
-          thread_local std::vector<Ptr<Scorer>> scorers;
-
-          if(!graph) {
-            graph = graphs_[id % numDevices_];
-            scorers = scorers_[id % numDevices_];
-          }
-
-          auto search = New<Search>(options_, scorers, trgVocab_);
-          auto histories = search->search(graph, batch);
-
-          for(auto history : histories) {
-            std::stringstream best1;
-            std::stringstream bestn;
-            printer->print(history, best1, bestn);
-            collector->add((long)history->getLineNum(), best1.str(), bestn.str());
-          }
-        };
-
-        threadPool_.enqueue(task, batchId);
-        batchId++;
+    auto request = New<Request>();
+    request->collector = New<StringCollector>(options_->get<bool>("quiet-translation", false));
+
+    auto sentences = splitInput(input, request);
+    if(sentences.empty())
+      return "";
+
+    // sentences translated before are answered right away, only the others are decoded
+    if(cache_)
+      sentences = lookUpCache(std::move(sentences));
+
+    if(!sentences.empty()) {
+      request->pending = sentences.size();
+      auto done = request->done.get_future();
+      {
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        for(auto& sentence : sentences)
+          queue_.push_back(std::move(sentence));
       }
+
+      // Each task decodes up to maxSentences_ queued sentences, whichever request they belong to.
+      // Enqueuing one task per maxSentences_ new sentences guarantees that the queue is drained.
+      size_t numTasks = (sentences.size() + maxSentences_ - 1) / maxSentences_;
+      for(size_t i = 0; i < numTasks; ++i)
+        workers_->enqueue([this](size_t id) { decodeQueuedSentences(id); });
+      done.wait();
     }
 
-    auto translations = collector->collect(options_->get<bool>("n-best"));
+    auto translations = request->collector->collect(options_->get<bool>("n-best"));
     return utils::join(translations, "\n");
   }
 
 private:
-  // Converts a multi-line input with tab-separated source(s) and target sentences into separate lists
-  // of sentences from source(s) and target sides, e.g.
-  // "src1 \t trg1 \n src2 \t trg2" -> ["src1 \n src2", "trg1 \n trg2"]
-  std::vector<std::string> convertTsvToLists(const std::string& inputText, size_t numFields) {
-    std::vector<std::string> outputFields(numFields);
-
+  // Splits a multi-line input into queued sentences. With --tsv each line is further split into
+  // tab-separated fields for source(s) and target, e.g. "src1 \t trg1 \n src2 \t trg2" yields two
+  // sentences with fields ["src1", "trg1"] and ["src2", "trg2"]
+  std::vector<QueuedSentence> splitInput(const std::string& inputText, Ptr<Request> request) {
+    bool tsv = options_->get<bool>("tsv", false);
+    size_t numFields = tsv ? options_->get<size_t>("tsv-fields", 1) : 1;
+
+    std::vector<QueuedSentence> sentences;
     std::string line;
-    std::vector<std::string> lineFields(numFields);
     std::istringstream inputStream(inputText);
-    bool first = true;
-    while(std::getline(inputStream, line)) {
-      utils::splitTsv(line, lineFields, numFields);
-      for(size_t i = 0; i < numFields; ++i) {
-        if(!first)
-          outputFields[i] += "\n";  // join sentences with a new line sign
-        outputFields[i] += lineFields[i];
+    while(io::getline(inputStream, line)) {
+      QueuedSentence sentence;
+      if(tsv)
+        utils::splitTsv(line, sentence.fields, numFields);
+      else
+        sentence.fields.push_back(line);
+      sentence.lineNum = sentences.size();
+      sentence.request = request;
+      sentences.push_back(std::move(sentence));
+    }
+    return sentences;
+  }
+
+  // The cache key of a sentence: the hash of models and options followed by the length and word ids
+  // of each field as encoded for decoding, so that inputs that only differ in ways the vocabularies
+  // ignore share their entry
+  std::string cacheKey(const QueuedSentence& sentence) const {
+    std::string key((const char*)&cacheContext_, sizeof(cacheContext_));
+    for(size_t i = 0; i < sentence.fields.size(); ++i) {
+      auto words = srcVocabs_[i]->encode(sentence.fields[i], /*addEOS=*/true, /*inference=*/true);
+      uint32_t length = (uint32_t)words.size();
+      key.append((const char*)&length, sizeof(length));
+      for(auto word : words) {
+        auto wordIdx = word.toWordIndex();
+        key.append((const char*)&wordIdx, sizeof(wordIdx));
       }
-      if(first)
-        first = false;
     }
+    return key;
+  }
+
+  // Every line of an n-best list starts with the line number, which is replaced by lineNum. Cached
+  // n-best lists are stored with an empty line number.
+  static std::string renumberNbest(const std::string& bestn, const std::string& lineNum) {
+    std::string renumbered;
+    for(size_t start = 0; start < bestn.size();) {
+      size_t end = bestn.find('\n', start);
+      end = end == std::string::npos ? bestn.size() : end + 1;
+      size_t sep = bestn.find(" ||| ", start);
+      if(sep < end)
+        renumbered += lineNum + bestn.substr(sep, end - sep);
+      else
+        renumbered += bestn.substr(start, end - start);
+      start = end;
+    }
+    return renumbered;
+  }
+
+  // Adds the cached translations of the given sentences to their request and returns the others,
+  // which remember their cache key for decodeQueuedSentences()
+  std::vector<QueuedSentence> lookUpCache(std::vector<QueuedSentence>&& sentences) {
+    std::vector<QueuedSentence> misses;
+    TranslationCache::Output output;
+    for(auto& sentence : sentences) {
+      sentence.cacheKey = cacheKey(sentence);
+      if(cache_->get(sentence.cacheKey, output)) {
+        auto bestn = renumberNbest(output.bestn, std::to_string(sentence.lineNum));
+        sentence.request->collector->add((long)sentence.lineNum, output.best1, bestn);
+      } else {
+        misses.push_back(std::move(sentence));
+      }
+    }
+    // toString() would lock all shards, only the counts of this batch are logged per request
+    LOG(debug, "[cache] {} of {} sentences found in the cache", sentences.size() - misses.size(), sentences.size());
+    return misses;
+  }
 
-    return outputFields;
+  // Translates the sentences currently at the front of the queue with the graph and scorers of
+  // worker 'id'. Returns immediately if other workers have already taken all of them.
+  void decodeQueuedSentences(size_t id) {
+    std::vector<QueuedSentence> sentences;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex_);
+      while(!queue_.empty() && sentences.size() < maxSentences_) {
+        sentences.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+    }
+    if(sentences.empty())
+      return;
+
+    auto graph = graphs_[id];
+    auto search = searches_[id];
+    auto printer = New<OutputPrinter>(options_, trgVocab_);
+
+    // join the collected sentences into one text per input stream; the line number within this
+    // merged input is the index into 'sentences'
+    std::vector<std::string> inputs(sentences.front().fields.size());
+    for(size_t i = 0; i < sentences.size(); ++i)
+      for(size_t j = 0; j < inputs.size(); ++j)
+        inputs[j] += (i > 0 ? "\n" : "") + sentences[i].fields[j];
+
+    auto corpus = New<data::TextInput>(inputs, srcVocabs_, options_);
+    data::BatchGenerator<data::TextInput> batchGenerator(corpus, options_, nullptr, /*runAsync=*/false);
+    batchGenerator.prepare();
+
+    for(auto batch : batchGenerator) {
+      auto histories = search->search(graph, batch);
+
+      for(auto history : histories) {
+        auto& sentence = sentences[history->getLineNum()];
+        history->setLineNum(sentence.lineNum); // n-best lists are numbered per request
+
+        std::stringstream best1;
+        std::stringstream bestn;
+        printer->print(history, best1, bestn);
+        sentence.request->collector->add((long)sentence.lineNum, best1.str(), bestn.str());
+        if(cache_)
+          cache_->put(sentence.cacheKey, {best1.str(), renumberNbest(bestn.str(), "")});
+        if(--sentence.request->pending == 0)
+          sentence.request->done.set_value();
+      }
+    }
   }
 };
 }  // namespace marian